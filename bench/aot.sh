@@ -0,0 +1,42 @@
+#!/bin/sh
+# hsh-lang interpreter vs `hsh-lang --compile` on the same script: N runs
+# of a script with FNS fn definitions and one call to an empty fn, so
+# the numbers are startup (parse/compile or cache load) plus exec.
+# usage: bench/aot.sh [hsh-lang-binary] [runs] [fns]
+HSH_LANG=${1:-./bin/hsh-lang}
+N=${2:-200}
+FNS=${3:-500}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+script="$dir/bench.hsl"
+
+i=0
+while [ $i -lt "$FNS" ]; do
+    echo "fn step$i() { check$i() )( recover$i() & report$i() )( retry$i() }"
+    i=$((i + 1))
+done > "$script"
+printf 'fn done() { }\ndone()\n' >> "$script"
+
+"$HSH_LANG" --compile "$script" -o "$dir/bench" || exit 1
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    i=0
+    while [ $i -lt "$N" ]; do
+        "$@" >/dev/null 2>&1
+        i=$((i + 1))
+    done
+    t1=$(now)
+    us=$(( (t1 - t0) / 1000 / N ))
+    printf '%-26s %6d us/run\n' "$label" "$us"
+}
+
+run "hsh-lang (no cache)" sh -c "rm -f '$dir/.bench.hsl.hslc'; \"$HSH_LANG\" '$script'"
+run "sh + rm (baseline)"  sh -c "rm -f '$dir/.bench.hsl.hslc'"
+"$HSH_LANG" "$script" >/dev/null 2>&1   # warm the .hslc cache
+run "hsh-lang (cached)"   "$HSH_LANG" "$script"
+run "compiled"            "$dir/bench"
@@ -0,0 +1,45 @@
+#!/bin/sh
+# File concatenation: hsh's in-process cat (copy_file_range to a file)
+# against /bin/cat, for one large copy and for 300 small ones, where the
+# saved fork + exec of cat dominates.
+# usage: bench/cat.sh [hsh-binary] [size, e.g. 1G] [dir]
+HSH=${1:-./bin/hsh}
+SIZE=${2:-1G}
+DIR=${3:-${TMPDIR:-/tmp}}
+
+IN="$DIR/hsh-bench-cat.in"
+OUT="$DIR/hsh-bench-cat.out"
+SMALL="$DIR/hsh-bench-cat.small"
+head -c "$SIZE" /dev/urandom > "$IN"
+head -c 4096 /dev/urandom > "$SMALL"
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    "$@" >/dev/null
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-16s %7d ms\n' "$label" "$ms"
+}
+
+small() {
+    i=0
+    while [ $i -lt 300 ]; do
+        "$@"
+        i=$((i + 1))
+    done
+}
+
+# warm the page cache first
+"$HSH" -c "cat $IN $IN > $OUT"
+
+run "hsh cat"       "$HSH" -c "cat $IN $IN > $OUT"
+run "hsh /bin/cat"  "$HSH" -c "/bin/cat $IN $IN > $OUT"
+rm -f "$OUT"    # truncating the big output would be timed otherwise
+"$HSH" -c "/bin/cat $SMALL > $OUT"
+run "300x hsh cat"  small "$HSH" -c "cat $SMALL $SMALL > $OUT"
+run "300x /bin/cat" small "$HSH" -c "/bin/cat $SMALL $SMALL > $OUT"
+
+rm -f "$IN" "$OUT" "$SMALL"
@@ -0,0 +1,61 @@
+#!/bin/sh
+# fs cp -r / fs sync (walk threads, copy_file_range for big files,
+# io_uring batches for small ones) against cp -r and, if installed,
+# rsync -a. The tree: WIDTH x WIDTH directories of FILES 4K files, plus
+# BIG 64M files. Copies go next to the tree, on the same disk.
+# usage: bench/cp.sh [hsh-binary] [width] [files] [big] [dir]
+HSH=${1:-./bin/hsh}
+WIDTH=${2:-20}
+FILES=${3:-50}
+BIG=${4:-4}
+DIR=${5:-${TMPDIR:-/tmp}}/hsh-bench-cp
+SRC=$DIR/src
+
+if [ ! -d "$SRC" ]; then
+    echo "building $SRC ($((WIDTH * WIDTH * FILES)) small, $BIG big files)..." >&2
+    mkdir -p "$SRC"
+    head -c 4096 /dev/urandom > "$DIR/small"
+    a=0
+    while [ $a -lt "$WIDTH" ]; do
+        b=0
+        while [ $b -lt "$WIDTH" ]; do
+            mkdir -p "$SRC/d$a/e$b"
+            (cd "$SRC/d$a/e$b" && seq 1 "$FILES" | sed 's/^/f/' |
+                xargs -n 64 sh -c 'for f; do cp "$0" "$f"; done' "$DIR/small")
+            b=$((b + 1))
+        done
+        a=$((a + 1))
+    done
+    i=0
+    while [ $i -lt "$BIG" ]; do
+        head -c 64M /dev/urandom > "$SRC/big$i"
+        i=$((i + 1))
+    done
+fi
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    sync
+    t0=$(now)
+    "$@" >/dev/null
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-22s %7d ms\n' "$label" "$ms"
+}
+
+rm -rf "$DIR/out"
+run "cp -r"                cp -r "$SRC" "$DIR/out"
+rm -rf "$DIR/out"
+run "fs cp -r -j 1"        "$HSH" -c "fs cp -q -j 1 -r $SRC $DIR/out"
+rm -rf "$DIR/out"
+run "fs cp -r"             "$HSH" -c "fs cp -q -r $SRC $DIR/out"
+run "fs sync (unchanged)"  "$HSH" -c "fs sync -q $SRC $DIR/out"
+if command -v rsync >/dev/null; then
+    rm -rf "$DIR/out"
+    run "rsync -a"             rsync -a "$SRC/" "$DIR/out/"
+    run "rsync -a (unchanged)" rsync -a "$SRC/" "$DIR/out/"
+fi
+rm -rf "$DIR/out"
+echo "(tree kept in $DIR; rm -rf it when done)"
@@ -0,0 +1,42 @@
+#!/bin/sh
+# fs du (parallel getdents64 + statx walk) against du -s on a synthetic
+# tree of WIDTH x WIDTH directories with FILES small files each. Both run
+# on a warm cache; as root, set COLD=1 to drop caches before each run.
+# usage: bench/du.sh [hsh-binary] [width] [files] [dir]
+HSH=${1:-./bin/hsh}
+WIDTH=${2:-50}
+FILES=${3:-40}
+DIR=${4:-${TMPDIR:-/tmp}}/hsh-bench-du
+
+if [ ! -d "$DIR" ]; then
+    echo "building $DIR ($((WIDTH * WIDTH * FILES)) files)..." >&2
+    a=0
+    while [ $a -lt "$WIDTH" ]; do
+        b=0
+        while [ $b -lt "$WIDTH" ]; do
+            mkdir -p "$DIR/d$a/e$b"
+            (cd "$DIR/d$a/e$b" && seq 1 "$FILES" | sed 's/^/f/' | xargs touch)
+            echo x > "$DIR/d$a/e$b/f1"
+            b=$((b + 1))
+        done
+        a=$((a + 1))
+    done
+fi
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    [ -n "$COLD" ] && sync && echo 3 > /proc/sys/vm/drop_caches
+    t0=$(now)
+    "$@" >/dev/null
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-16s %7d ms\n' "$label" "$ms"
+}
+
+du -s "$DIR" >/dev/null
+run "du -s"        du -s "$DIR"
+run "fs du -j 1"   "$HSH" -c "fs du -j 1 $DIR"
+run "fs du"        "$HSH" -c "fs du $DIR"
+echo "(tree kept in $DIR; rm -rf it when done)"
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Fan-out throughput: SIZE bytes to two consumers, hsh's `|+` (tee/splice,
+# no userspace copy) against bash's `tee >(...)`.
+# usage: bench/fanout.sh [hsh-binary] [size, e.g. 4G]
+HSH=${1:-./bin/hsh}
+SIZE=${2:-4G}
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    "$@" >/dev/null
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-16s %7d ms\n' "$label" "$ms"
+}
+
+run "hsh |+"      "$HSH" -c "head -c $SIZE /dev/zero |+ wc -c |+ wc -c"
+run "hsh |+ 1M"   "$HSH" -c "pipesz 1M head -c $SIZE /dev/zero |+ wc -c |+ wc -c"
+if command -v bash >/dev/null 2>&1; then
+    run "bash tee"    bash -c "head -c $SIZE /dev/zero | tee >(wc -c) | wc -c"
+fi
@@ -0,0 +1,29 @@
+#!/bin/sh
+# fs find (parallel walk, compiled glob with a literal prefilter) against
+# find -name on the tree bench/du.sh builds; run that first.
+# usage: bench/find.sh [hsh-binary] [dir]
+HSH=${1:-./bin/hsh}
+DIR=${2:-${TMPDIR:-/tmp}}/hsh-bench-du
+
+if [ ! -d "$DIR" ]; then
+    echo "$DIR missing; run bench/du.sh first" >&2
+    exit 1
+fi
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    "$@" >/dev/null
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-20s %7d ms\n' "$label" "$ms"
+}
+
+find "$DIR" >/dev/null
+run "find -name f1*"      find "$DIR" -name 'f1*'
+run "fs find -j 1 f1*"    "$HSH" -c "fs find -a -j 1 $DIR f1*"
+run "fs find f1*"         "$HSH" -c "fs find -a $DIR f1*"
+run "find -regex"         find "$DIR" -regextype egrep -regex '.*/f[0-9]+7$'
+run "fs find -r"          "$HSH" -c "fs find -a -r $DIR f[0-9]+7\$"
@@ -0,0 +1,47 @@
+#!/bin/sh
+# Wildcard expansion (getdents64, per-line directory cache, streamed **)
+# against bash globstar on the tree bench/du.sh builds; run that first.
+# The expanded words go to a builtin that ignores them, so only the
+# expansion is timed; hsh's peak RSS is read from /proc after it.
+# usage: bench/glob.sh [hsh-binary] [dir]
+HSH=${1:-./bin/hsh}
+DIR=${2:-${TMPDIR:-/tmp}}/hsh-bench-du
+
+if [ ! -d "$DIR" ]; then
+    echo "$DIR missing; run bench/du.sh first" >&2
+    exit 1
+fi
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    "$@" >/dev/null 2>&1
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-24s %7d ms\n' "$label" "$ms"
+}
+
+peak() {
+    label=$1; shift
+    kb=$("$HSH" -c "pipestatus $* 2> /dev/null () cat /proc/self/status" |
+         awk '/^VmHWM/ { print $2 }')
+    printf '%-24s %7d kB\n' "$label" "$kb"
+}
+
+cd "$DIR" || exit 1
+find . >/dev/null
+n=$(bash -O globstar -c 'a=(**); echo ${#a[@]}')
+echo "** matches $n paths"
+
+run "bash d*/e1*/f1*"         bash -c ': d*/e1*/f1*'
+run "hsh d*/e1*/f1*"          "$HSH" -c 'pipestatus d*/e1*/f1*'
+run "bash globstar **/f1*"    bash -O globstar -c ': **/f1*'
+run "hsh **/f1*"              "$HSH" -c 'pipestatus **/f1*'
+run "bash globstar **"        bash -O globstar -c ': **'
+run "hsh **"                  "$HSH" -c 'pipestatus **'
+
+peak "hsh peak, no glob"      x
+peak "hsh peak, **/f1*"       '**/f1*'
+peak "hsh peak, **"           '**'
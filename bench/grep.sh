@@ -0,0 +1,51 @@
+#!/bin/sh
+# fs grep (thread pool, mmap, SIMD substring scan) against grep -r on a
+# synthetic log tree of DIRS x FILES files of LINES lines each. Warm
+# cache; the first run of each is discarded.
+# usage: bench/grep.sh [hsh-binary] [dirs] [files] [lines] [dir]
+HSH=${1:-./bin/hsh}
+DIRS=${2:-20}
+FILES=${3:-20}
+LINES=${4:-20000}
+DIR=${5:-${TMPDIR:-/tmp}}/hsh-bench-grep
+
+if [ ! -d "$DIR" ]; then
+    echo "building $DIR ($((DIRS * FILES)) files)..." >&2
+    mkdir -p "$DIR/d0"
+    seq 1 "$LINES" | awk '{ printf "2024-05-%02d 12:%02d:%02d INFO worker-%d request %d served in %d ms\n", $1 % 28 + 1, $1 % 60, $1 % 60, $1 % 16, $1, $1 % 977 }
+                          $1 % 5000 == 0 { print "2024-05-01 12:00:00 ERROR upstream timeout id=" $1 }' > "$DIR/d0/f0.log"
+    d=0
+    while [ $d -lt "$DIRS" ]; do
+        mkdir -p "$DIR/d$d"
+        f=0
+        while [ $f -lt "$FILES" ]; do
+            [ -f "$DIR/d$d/f$f.log" ] || cp "$DIR/d0/f0.log" "$DIR/d$d/f$f.log"
+            f=$((f + 1))
+        done
+        d=$((d + 1))
+    done
+fi
+
+# not /dev/null: GNU grep stops at the first match when it sees that
+OUT=$DIR.out
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    "$@" >"$OUT"
+    t0=$(now)
+    "$@" >"$OUT"
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-20s %7d ms\n' "$label" "$ms"
+}
+
+run "grep -r ERROR"       grep -r ERROR "$DIR"
+run "fs grep -j 1 ERROR"  "$HSH" -c "fs grep -j 1 ERROR $DIR"
+run "fs grep ERROR"       "$HSH" -c "fs grep ERROR $DIR"
+run "grep -rc served"     grep -rc served "$DIR"
+run "fs grep -c served"   "$HSH" -c "fs grep -c served $DIR"
+run "grep -rli error"     grep -rli error "$DIR"
+run "fs grep -l -i error" "$HSH" -c "fs grep -l -i error $DIR"
+rm -f "$OUT"
+echo "(tree kept in $DIR; rm -rf it when done)"
@@ -0,0 +1,71 @@
+/* Tree walker vs bytecode VM on a long hsh-lang chain.
+ * usage: bench/lang_chain [calls] [reps]
+ * f0..f63 are registered as no-op natives, so this measures dispatch only.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lang.h"
+
+static int noop(char **args) {
+    (void)args;
+    return 1;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    int calls = argc > 1 ? atoi(argv[1]) : 10000;
+    int reps  = argc > 2 ? atoi(argv[2]) : 20;
+
+    /* f0() )( f1() )( ... with 64 distinct names */
+    char *src = malloc((size_t)calls * 16 + 1);
+    char *p = src;
+    for (int i = 0; i < calls; i++)
+        p += sprintf(p, "%sf%d()", i ? " )( " : "", i % 64);
+
+    for (int i = 0; i < 64; i++) {
+        char name[8];
+        snprintf(name, sizeof(name), "f%d", i);
+        hsh_lang_register_native(name, noop, NULL);
+    }
+
+    hsh_arena *arena = hsh_arena_new();
+    double t0 = now();
+    hsh_node *n = hsh_lang_parse_stmt(arena, src);
+    double t1 = now();
+    hsh_prog *prog = hsh_lang_compile(n);
+    double t2 = now();
+    if (!n || !prog) {
+        fprintf(stderr, "parse/compile failed\n");
+        return 1;
+    }
+
+    double t3 = now();
+    for (int r = 0; r < reps; r++)
+        hsh_lang_eval(n);
+    double t4 = now();
+    for (int r = 0; r < reps; r++)
+        hsh_lang_run(prog);
+    double t5 = now();
+
+    printf("%d calls, %d reps\n", calls, reps);
+    printf("  parse        %8.3f ms\n", (t1 - t0) * 1e3);
+    printf("  compile      %8.3f ms (%u insns, %u names)\n",
+           (t2 - t1) * 1e3, prog->len, prog->nnames);
+    printf("  tree walker  %8.3f ms/run\n", (t4 - t3) * 1e3 / reps);
+    printf("  bytecode VM  %8.3f ms/run\n", (t5 - t4) * 1e3 / reps);
+
+    hsh_prog_free(prog);
+    double t6 = now();
+    hsh_arena_free(arena);
+    printf("  free AST     %8.3f ms\n", (now() - t6) * 1e3);
+    free(src);
+    return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Pipeline throughput: SIZE bytes through `cat` stages, with the default
+# pipe buffer and with larger F_SETPIPE_SZ sizes (pipesz).
+# usage: bench/pipe.sh [hsh-binary] [size, e.g. 4G] [stages]
+HSH=${1:-./bin/hsh}
+SIZE=${2:-4G}
+STAGES=${3:-4}
+
+chain="head -c $SIZE /dev/zero"
+i=0
+while [ $i -lt "$STAGES" ]; do
+    chain="$chain | cat"
+    i=$((i + 1))
+done
+chain="$chain | wc -c"
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    "$@" >/dev/null
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-16s %7d ms\n' "$label" "$ms"
+}
+
+run "default"   "$HSH" -c "$chain"
+for sz in 256K 1M; do
+    run "pipesz $sz" "$HSH" -c "pipesz $sz $chain"
+done
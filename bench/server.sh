@@ -0,0 +1,33 @@
+#!/bin/sh
+# hsh-client round trip against a warm `hsh --server` vs cold starts.
+# usage: bench/server.sh [bin-dir] [runs]
+BIN=${1:-./bin}
+N=${2:-1000}
+
+tmp=$(mktemp -d)
+trap 'kill $srv 2>/dev/null; rm -rf "$tmp"' EXIT
+sock=$tmp/hsh.sock
+echo "true" > "$tmp/script.hsh"
+
+"$BIN/hsh" --server "$sock" 2>/dev/null &
+srv=$!
+while [ ! -S "$sock" ]; do sleep 0.01; done
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    i=0
+    while [ $i -lt "$N" ]; do
+        "$@" >/dev/null 2>&1
+        i=$((i + 1))
+    done
+    t1=$(now)
+    printf '%-26s %6d us/run\n' "$label" $(( (t1 - t0) / 1000 / N ))
+}
+
+run "hsh script (cold)"        "$BIN/hsh" "$tmp/script.hsh"
+run "hsh -c true (cold)"       "$BIN/hsh" -c true
+run "hsh-client script (warm)" "$BIN/hsh-client" -S "$sock" "$tmp/script.hsh"
+run "hsh-client -c true (warm)" "$BIN/hsh-client" -S "$sock" -c true
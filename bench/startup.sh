@@ -0,0 +1,29 @@
+#!/bin/sh
+# Startup cost of non-interactive hsh: N runs of script mode and of -c.
+# usage: bench/startup.sh [hsh-binary] [runs]
+HSH=${1:-./bin/hsh}
+N=${2:-1000}
+
+script=$(mktemp)
+trap 'rm -f "$script"' EXIT
+echo "true" > "$script"
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    i=0
+    while [ $i -lt "$N" ]; do
+        "$@" >/dev/null 2>&1
+        i=$((i + 1))
+    done
+    t1=$(now)
+    us=$(( (t1 - t0) / 1000 / N ))
+    printf '%-22s %6d us/run\n' "$label" "$us"
+}
+
+run "hsh script"  "$HSH" "$script"
+run "hsh -c true" "$HSH" -c true
+command -v bash >/dev/null && run "bash -c true" bash -c true
+command -v dash >/dev/null && run "dash -c true" dash -c true
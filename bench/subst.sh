@@ -0,0 +1,40 @@
+#!/bin/sh
+# $(...) in a loop: N substitutions of an external command and of a
+# builtin. hsh runs builtins in-process and execs externals straight from
+# one fork; bash forks a subshell for each.
+# usage: bench/subst.sh [hsh-binary] [count]
+HSH=${1:-./bin/hsh}
+N=${2:-500}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+i=0
+while [ $i -lt "$N" ]; do
+    echo "let X = \$(uname)"
+    i=$((i + 1))
+done > "$dir/ext.hsh"
+sed 's/^let X = /X=/' "$dir/ext.hsh" > "$dir/ext.sh"
+
+i=0
+while [ $i -lt "$N" ]; do
+    echo "let X = \$(pipestatus)"
+    i=$((i + 1))
+done > "$dir/builtin.hsh"
+sed 's/^let X = \$(pipestatus)/X=$(echo 0)/' "$dir/builtin.hsh" > "$dir/builtin.sh"
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    "$@" >/dev/null 2>&1
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-26s %7d ms\n' "$label" "$ms"
+}
+
+run "hsh \$(uname) x$N"       "$HSH" "$dir/ext.hsh"
+run "bash \$(uname) x$N"      bash "$dir/ext.sh"
+run "hsh \$(pipestatus) x$N"  "$HSH" "$dir/builtin.hsh"
+run "bash \$(echo 0) x$N"     bash "$dir/builtin.sh"
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Variable-heavy scripts: N exports then M spawns, and a loop that keeps
+# changing an exported variable between spawns. hsh patches one environ
+# slot per change; the spawns hand the live array to execve as is.
+# usage: bench/var.sh [hsh-binary] [vars] [spawns]
+HSH=${1:-./bin/hsh}
+N=${2:-2000}
+M=${3:-200}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+i=0
+while [ $i -lt "$N" ]; do
+    echo "export V$i=value$i"
+    i=$((i + 1))
+done > "$dir/exports"
+
+i=0
+while [ $i -lt "$M" ]; do
+    echo "export STEP=$i"
+    echo "/bin/true \$STEP"
+    i=$((i + 1))
+done > "$dir/spawns"
+
+cat "$dir/exports" > "$dir/big"
+cat "$dir/spawns" >> "$dir/big"
+
+now() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    t0=$(now)
+    "$@" >/dev/null 2>&1
+    t1=$(now)
+    ms=$(( (t1 - t0) / 1000000 ))
+    printf '%-28s %7d ms\n' "$label" "$ms"
+}
+
+run "hsh $N exports"             "$HSH" "$dir/exports"
+run "bash $N exports"            bash "$dir/exports"
+run "hsh $M spawns"              "$HSH" "$dir/spawns"
+run "bash $M spawns"             bash "$dir/spawns"
+run "hsh $N exports, $M spawns"  "$HSH" "$dir/big"
+run "bash $N exports, $M spawns" bash "$dir/big"
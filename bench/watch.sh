@@ -0,0 +1,53 @@
+#!/bin/sh
+# fs watch (inotify, blocked in poll) against a polling loop (find -newer
+# every second) on the tree bench/du.sh builds: CPU used while nothing
+# changes, and the time from a change to the command running.
+# usage: bench/watch.sh [hsh-binary] [idle-seconds] [dir]
+HSH=${1:-./bin/hsh}
+SECS=${2:-10}
+DIR=${3:-${TMPDIR:-/tmp}}/hsh-bench-du
+
+if [ ! -d "$DIR" ]; then
+    echo "$DIR missing; run bench/du.sh first" >&2
+    exit 1
+fi
+
+T=$(mktemp -d)
+printf '#!/bin/sh\ndate +%%s%%N >> %s/hits\n' "$T" > "$T/hit"
+chmod +x "$T/hit"
+
+now() { date +%s%N; }
+# utime + stime of pid and its reaped children, in clock ticks
+cpu() { awk '{ print $14 + $15 + $16 + $17 }' "/proc/$1/stat"; }
+
+measure() {
+    label=$1; pid=$2
+    sleep 1                     # setup: watches added, first find run
+    c0=$(cpu "$pid")
+    sleep "$SECS"
+    c1=$(cpu "$pid")
+    : > "$T/hits"
+    t0=$(now)
+    touch "$DIR/d0/e0/f1"
+    while [ ! -s "$T/hits" ]; do sleep 0.01; done
+    ms=$(( ($(head -n 1 "$T/hits") - t0) / 1000000 ))
+    kill "$pid"
+    wait "$pid" 2>/dev/null
+    printf '%-14s %4d ticks idle in %ss, reacts in %5d ms\n' "$label" \
+           $((c1 - c0)) "$SECS" "$ms"
+}
+
+"$HSH" -c "fs watch -a -d 20 $DIR -- $T/hit" &
+measure "fs watch" $!
+
+(
+    touch "$T/stamp"
+    while sleep 1; do
+        if [ -n "$(find "$DIR" -newer "$T/stamp" | head -n 1)" ]; then
+            touch "$T/stamp"
+            "$T/hit"
+        fi
+    done
+) &
+measure "find; sleep 1" $!
+rm -rf "$T"
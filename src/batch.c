@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "batch.h"
+#include "parser.h"
+#include "builtins.h"
+
+#define HSH_BATCH_BUF (256 * 1024)
+
+
+struct hsh_batch {
+    int  jobs;
+    int  running;
+    long commands;
+    long failed;
+    int  last_status;
+    int  stop;
+    char *(*expand)(const char *line);
+};
+
+static double hsh_batch_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void hsh_batch_account(struct hsh_batch *b, int status) {
+    b->last_status = status;
+    if (status != 0)
+        b->failed++;
+}
+
+/* reap one worker (block) or all finished ones (nohang) */
+static int hsh_batch_reap(struct hsh_batch *b, int nohang) {
+    int status;
+    pid_t pid = waitpid(-1, &status, nohang ? WNOHANG : 0);
+    if (pid <= 0)
+        return 0;
+    b->running--;
+    hsh_batch_account(b, WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+    return 1;
+}
+
+/* builtins whose effect must be visible to later lines (not pipeline-safe
+ * in builtins.def); a one-off `pipesz SIZE a | b` pipeline waits too,
+ * which is harmless */
+static int hsh_batch_is_barrier(const char *line) {
+    char first[64];
+    if (sscanf(line, " %63s", first) != 1)
+        return 0;
+    const struct hsh_builtin *b = hsh_builtin_find(first);
+    return b && !(b->flags & HSH_BUILTIN_PIPE_SAFE);
+}
+
+static void hsh_batch_line(struct hsh_batch *b, char *line) {
+    char *p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '#' || *p == '\0')
+        return;
+
+    char *expanded = b->expand ? b->expand(p) : NULL;
+    char *exec_line = expanded ? expanded : p;
+    int status = 0;
+
+    b->commands++;
+
+    if (b->jobs > 1 && !hsh_batch_is_barrier(exec_line)) {
+        while (b->running >= b->jobs)
+            hsh_batch_reap(b, 0);
+
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            hsh_exec_line(exec_line, &status);
+            fflush(NULL);
+            _exit(status & 0xff);
+        }
+        if (pid < 0) {
+            perror("hsh: fork");
+            hsh_batch_account(b, 1);
+        } else {
+            b->running++;
+        }
+        free(expanded);
+        while (b->running > 0 && hsh_batch_reap(b, 1))
+            ;
+        return;
+    }
+
+    /* serial line, or a barrier in jobs mode */
+    while (b->running > 0)
+        hsh_batch_reap(b, 0);
+
+    if (hsh_run_line(exec_line, &status) == 0)
+        b->stop = 1;
+    hsh_batch_account(b, status);
+    free(expanded);
+}
+
+int hsh_run_batch(int fd, int jobs, char *(*expand)(const char *line)) {
+    struct hsh_batch b;
+    size_t cap = HSH_BATCH_BUF;
+    size_t len = 0;
+    char *buf = malloc(cap + 1);
+
+    if (!buf) {
+        perror("hsh: malloc");
+        return 1;
+    }
+
+    /* commands must not eat the command stream: move it off fd 0 and
+     * give everything the batch runs /dev/null as stdin */
+    int moved = fd == STDIN_FILENO;
+    if (moved) {
+        int dn = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        fd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 3);
+        if (dn < 0 || fd < 0 || dup2(dn, STDIN_FILENO) < 0) {
+            perror("hsh: batch stdin");
+            free(buf);
+            return 1;
+        }
+        close(dn);
+    }
+
+    memset(&b, 0, sizeof(b));
+    b.jobs = jobs > 0 ? jobs : 1;
+    b.expand = expand;
+
+    double t0 = hsh_batch_now();
+    int eof = 0;
+
+    while (!eof && !b.stop) {
+        /* a single line longer than the buffer: grow it */
+        if (len == cap) {
+            char *tmp = realloc(buf, cap * 2 + 1);
+            if (!tmp) {
+                perror("hsh: realloc");
+                break;
+            }
+            buf = tmp;
+            cap *= 2;
+        }
+
+        ssize_t n = read(fd, buf + len, cap - len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("hsh: read");
+            break;
+        }
+        if (n == 0) {
+            eof = 1;
+            if (len == 0)
+                break;
+            buf[len++] = '\n';   /* last line without newline */
+        } else {
+            len += (size_t)n;
+        }
+
+        /* run every complete line in place */
+        char *start = buf;
+        char *end = buf + len;
+        char *nl;
+        while (!b.stop && (nl = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+            *nl = '\0';
+            if (nl > start && nl[-1] == '\r')
+                nl[-1] = '\0';
+            hsh_batch_line(&b, start);
+            start = nl + 1;
+        }
+
+        len = (size_t)(end - start);
+        if (len > 0 && start != buf)
+            memmove(buf, start, len);
+    }
+
+    while (b.running > 0)
+        hsh_batch_reap(&b, 0);
+
+    double t1 = hsh_batch_now();
+    free(buf);
+    if (moved)
+        close(fd);
+
+    fprintf(stderr, "hsh: batch: %ld commands, %ld failed, %.3fs",
+            b.commands, b.failed, t1 - t0);
+    if (b.jobs > 1)
+        fprintf(stderr, " (%d jobs)", b.jobs);
+    fprintf(stderr, "\n");
+
+    return b.failed ? 1 : 0;
+}
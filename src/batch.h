@@ -0,0 +1,19 @@
+#ifndef HSH_BATCH_H
+#define HSH_BATCH_H
+
+/* hsh - / hsh --batch [--jobs N]
+ *
+ * Execute a command stream from fd, one command per line, using large
+ * buffered reads; lines are run in place, without copying. With jobs > 1
+ * up to jobs lines run concurrently in forked workers; lines that change
+ * shell state (cd, exit) wait for all running lines first.
+ *
+ * If fd is stdin, it is moved to another descriptor and the commands
+ * get /dev/null as stdin, so they cannot consume the command stream.
+ *
+ * expand (may be NULL) returns a malloc'd alias expansion or NULL.
+ * A summary goes to stderr. Returns 0 if every command succeeded, else 1.
+ */
+int hsh_run_batch(int fd, int jobs, char *(*expand)(const char *line));
+
+#endif
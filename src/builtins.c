@@ -0,0 +1,719 @@
+/*
+ * HorizonShell - simple hybrid shell
+ * Copyright (c) 2026
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "builtins.h"
+#include "parser.h"
+#include "copy.h"
+#include "fs.h"
+#include "var.h"
+#include "builtin_table.h"
+
+/* ----- the builtin table: builtins.def, hashed by gen_builtins ----- */
+
+static const struct hsh_builtin hsh_builtins[] = {
+#define HSH_BUILTIN(name, fn, flags, usage, help, details) \
+    { name, fn, flags, usage, help, details },
+#define HSH_HELP_TOPIC(name, details)
+#include "builtins.def"
+#undef HSH_BUILTIN
+#undef HSH_HELP_TOPIC
+};
+
+/* help for commands handled outside the table (plain cat) */
+static const struct {
+    const char *name;
+    const char *details;
+} hsh_help_topics[] = {
+#define HSH_BUILTIN(name, fn, flags, usage, help, details)
+#define HSH_HELP_TOPIC(name, details) { name, details },
+#include "builtins.def"
+#undef HSH_BUILTIN
+#undef HSH_HELP_TOPIC
+};
+
+_Static_assert(sizeof(hsh_builtins) / sizeof(hsh_builtins[0]) == HSH_BUILTIN_COUNT,
+               "builtin_table.h is out of date with builtins.def");
+
+const struct hsh_builtin *hsh_builtin_find(const char *name) {
+    unsigned h = hsh_builtin_hash(name, HSH_BUILTIN_SEED) & (HSH_BUILTIN_SLOTS - 1);
+    int i = hsh_builtin_slot[h];
+    if (i < 0 || strcmp(hsh_builtins[i].name, name) != 0)
+        return NULL;
+    return &hsh_builtins[i];
+}
+
+const struct hsh_builtin *hsh_builtin_at(int i) {
+    return i >= 0 && i < HSH_BUILTIN_COUNT ? &hsh_builtins[i] : NULL;
+}
+
+/* system(cmd), builtin style: 1 if it ran and exited 0 */
+static int hsh_system(const char *cmd) {
+    int st = system(cmd);
+    return st != -1 && WIFEXITED(st) && WEXITSTATUS(st) == 0;
+}
+
+int hsh_builtin_cd(char **args) {
+    char *target = NULL;
+
+    if (args[1] == NULL || strcmp(args[1], "~") == 0) {
+        /* cd or cd ~ -> HOME */
+        target = getenv("HOME");
+        if (!target) {
+            fprintf(stderr, "cd: HOME not set\n");
+            return 0;
+        }
+    } else if (args[1][0] == '~') {
+        /* handle things like ~/foo */
+        char *home = getenv("HOME");
+        if (!home) {
+            fprintf(stderr, "cd: HOME not set\n");
+            return 0;
+        }
+        size_t len = strlen(home) + strlen(args[1]);
+        char *buf = malloc(len);
+        if (!buf) {
+            perror("cd");
+            return 0;
+        }
+        snprintf(buf, len, "%s%s", home, args[1] + 1);
+        int rc = chdir(buf);
+        free(buf);
+        if (rc != 0) {
+            perror("cd");
+            return 0;
+        }
+        return 1;
+    } else {
+        target = args[1];
+    }
+
+    if (chdir(target) != 0) {
+        perror("cd");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+int hsh_builtin_help(char **args) {
+    if (args[1] == NULL) {
+        printf("%s %s\n", HSH_NAME, HSH_VERSION);
+        printf("A hybrid interactive shell with system-aware status bar and extended commands.\n\n");
+
+        printf("Builtins:\n");
+        for (const struct hsh_builtin *b = hsh_builtins;
+             b < hsh_builtins + HSH_BUILTIN_COUNT; b++)
+            printf("  %-18s - %s\n", b->usage, b->help);
+        printf("  cat [file...]      - concatenate files, copied in-kernel when possible\n");
+        printf("  cmd |+ a |+ b      - fan out: a and b each read all of cmd's output\n");
+        printf("  cmd < in > out     - redirections: < > >> 2> 2>> 2>&1 (separate words)\n");
+        printf("  ls *.c src/**/*.h  - wildcards: * ? [a-z] and ** for any depth, sorted\n\n");
+
+        printf("System commands:\n");
+        printf("  sys info           - system info (OS, kernel, host, uptime)\n");
+        printf("  sys resources      - CPU/RAM/disk summary\n");
+        printf("  sys config         - open HorizonShell config in your editor\n\n");
+
+        printf("Filesystem commands:\n");
+        printf("  fs tree [path]     - directory tree view (uses tree or fs find)\n");
+        printf("  fs ls [path]       - colored ls wrapper\n");
+        printf("  fs du [path]       - disk usage and heaviest directories (parallel)\n");
+        printf("  fs find [root] [glob] - parallel find, honors .gitignore\n");
+        printf("  fs grep <pattern> [path] - parallel content search\n");
+        printf("  fs cp -r <src> <dst> - parallel copy (copy_file_range, io_uring)\n");
+        printf("  fs sync <src> <dst>  - copy only what changed (size, mtime)\n");
+        printf("  fs watch <path> -- <cmd> - run cmd after each burst of changes\n\n");
+
+        printf("Network commands:\n");
+        printf("  net ip             - show IP addresses\n");
+        printf("  net ping <host>    - ping host with sane defaults\n\n");
+
+        printf("Process commands:\n");
+        printf("  ps top             - show top processes by CPU\n");
+        printf("  ps find <pattern>  - list processes matching pattern\n\n");
+
+        printf("Scripting helpers:\n");
+        printf("  $(cmd)             - cmd's output, split into words\n");
+        printf("  hsh script.hsh     - run script file line by line\n\n");
+
+        printf("Usage:\n");
+        printf("  <external-command> [args...]    - runs like a normal shell (ls, cat, etc.)\n");
+        printf("  <namespace> <verb> [args...]    - HorizonShell extended syntax (sys, fs, net, ps)\n");
+
+        return 1;
+    }
+
+    const struct hsh_builtin *b = hsh_builtin_find(args[1]);
+    if (b && b->details) {
+        fputs(b->details, stdout);
+        return 1;
+    }
+    if (b) {
+        printf("%s: %s\n", b->name, b->help);
+        printf("  %s\n", b->usage);
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(hsh_help_topics) / sizeof(hsh_help_topics[0]); i++) {
+        if (strcmp(args[1], hsh_help_topics[i].name) == 0) {
+            fputs(hsh_help_topics[i].details, stdout);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "help: no builtin '%s'\n", args[1]);
+    return 0;
+}
+
+
+int hsh_builtin_sys(char **args) {
+    char *home = getenv("HOME");
+    if (!home) {
+        fprintf(stderr, "sys: HOME not set\n");
+        return 0;
+    }
+
+    char confpath[512];
+    snprintf(confpath, sizeof(confpath), "%s/.config/hsh/config", home);
+
+    if (args[1] == NULL || strcmp(args[1], "info") == 0) {
+        printf("=== System info ===\n");
+        system("uname -a");
+        system("echo");
+        system("echo User: $USER");
+        system("echo Host: $(hostname)");
+        system("echo");
+        system("uptime");
+        return 1;
+    }
+
+    if (strcmp(args[1], "resources") == 0) {
+        printf("=== CPU / Memory / Disk ===\n");
+        system("echo CPU: && lscpu | head -n 5");
+        system("echo");
+        system("echo Memory: && free -h");
+        system("echo");
+        system("echo Disk: && df -h");
+        return 1;
+    }
+
+    if (strcmp(args[1], "config") == 0) {
+        char *env_editor = getenv("EDITOR");
+        char editor[64] = {0};
+
+        printf("=== Edit HorizonShell config ===\n");
+        printf("Config file: %s\n", confpath);
+        if (env_editor && env_editor[0] != '\0') {
+            printf("Detected $EDITOR = %s\n", env_editor);
+        }
+
+        printf("Choose editor:\n");
+        if (env_editor && env_editor[0] != '\0')
+            printf("  1) Use $EDITOR (%s)\n", env_editor);
+        else
+            printf("  1) nano\n");
+        printf("  2) nano\n");
+        printf("  3) vim\n");
+        printf("  4) code (VS Code CLI)\n");
+        printf("Select [1-4] (default 1): ");
+
+        int choice = 1;
+        char buf[32];
+        if (fgets(buf, sizeof(buf), stdin)) {
+            int v;
+            if (sscanf(buf, "%d", &v) == 1 && v >= 1 && v <= 4)
+                choice = v;
+        }
+
+        if (choice == 1) {
+            if (env_editor && env_editor[0] != '\0') {
+                strncpy(editor, env_editor, sizeof(editor) - 1);
+            } else {
+                strncpy(editor, "nano", sizeof(editor) - 1);
+            }
+        } else if (choice == 2) {
+            strncpy(editor, "nano", sizeof(editor) - 1);
+        } else if (choice == 3) {
+            strncpy(editor, "vim", sizeof(editor) - 1);
+        } else if (choice == 4) {
+            strncpy(editor, "code", sizeof(editor) - 1);
+        }
+
+        if (editor[0] == '\0') {
+            fprintf(stderr, "sys config: no editor selected\n");
+            return 0;
+        }
+
+        char cmd[600];
+        snprintf(cmd, sizeof(cmd), "%s %s", editor, confpath);
+        printf("Opening config with: %s\n", cmd);
+        if (!hsh_system(cmd)) {
+            fprintf(stderr, "sys config: %s failed\n", editor);
+            return 0;
+        }
+        printf("Done editing. Changes take effect next time you start hsh (or after reload).\n");
+        return 1;
+    }
+
+    fprintf(stderr, "sys: unknown subcommand '%s'\n", args[1]);
+    return 0;
+}
+
+
+/* 1 if name is an executable in $PATH */
+static int hsh_fs_have(const char *name) {
+    const char *path = getenv("PATH");
+    char buf[1024];
+
+    while (path && *path) {
+        const char *end = strchr(path, ':');
+        size_t n = end ? (size_t)(end - path) : strlen(path);
+        if (n > 0 && snprintf(buf, sizeof(buf), "%.*s/%s", (int)n, path, name)
+                     < (int)sizeof(buf) &&
+            access(buf, X_OK) == 0)
+            return 1;
+        path = end ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+int hsh_builtin_fs(char **args) {
+    if (args[1] == NULL || strcmp(args[1], "tree") == 0) {
+        const char *path = ".";
+        if (args[1] && args[2])
+            path = args[2];
+
+        if (hsh_fs_have("tree")) {
+            char cmd[512];
+            snprintf(cmd, sizeof(cmd), "tree -C %s", path);
+            return hsh_system(cmd);
+        }
+
+        char *find[] = { "fs", "find", "-d", "3", (char *)path, NULL };
+        printf("tree not found, using fs find\n%s\n", path);
+        return hsh_fs_find(find);
+    }
+
+    if (strcmp(args[1], "ls") == 0) {
+        const char *path = ".";
+        if (args[2])
+            path = args[2];
+
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd), "ls --color=auto -al %s", path);
+        return hsh_system(cmd);
+    }
+
+    if (strcmp(args[1], "du") == 0)
+        return hsh_fs_du(args);
+
+    if (strcmp(args[1], "find") == 0)
+        return hsh_fs_find(args);
+
+    if (strcmp(args[1], "grep") == 0)
+        return hsh_fs_grep(args);
+
+    if (strcmp(args[1], "cp") == 0)
+        return hsh_fs_cp(args);
+
+    if (strcmp(args[1], "sync") == 0)
+        return hsh_fs_sync(args);
+
+    if (strcmp(args[1], "watch") == 0)
+        return hsh_fs_watch(args);
+
+    fprintf(stderr, "fs: unknown subcommand '%s'\n", args[1]);
+    return 0;
+}
+
+
+int hsh_builtin_net(char **args) {
+    if (args[1] == NULL || strcmp(args[1], "ip") == 0) {
+        printf("=== IP addresses ===\n");
+        return hsh_system("command -v ip >/dev/null 2>&1 && ip addr show || ifconfig");
+    }
+
+    if (strcmp(args[1], "ping") == 0) {
+        if (!args[2]) {
+            fprintf(stderr, "net: usage: net ping <host>\n");
+            return 0;
+        }
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd), "ping -c 4 %s", args[2]);
+        return hsh_system(cmd);
+    }
+
+    fprintf(stderr, "net: unknown subcommand '%s'\n", args[1]);
+    return 0;
+}
+
+
+int hsh_builtin_ps(char **args) {
+    if (args[1] == NULL || strcmp(args[1], "top") == 0) {
+        printf("=== Top processes (CPU) ===\n");
+        return hsh_system("ps -eo pid,ppid,cmd,%mem,%cpu --sort=-%cpu | head -n 15");
+    }
+
+    if (strcmp(args[1], "find") == 0) {
+        if (!args[2]) {
+            fprintf(stderr, "ps: usage: ps find <pattern>\n");
+            return 0;
+        }
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd),
+                 "ps aux | grep -i -- '%s' | grep -v grep", args[2]);
+        return hsh_system(cmd);
+    }
+
+    fprintf(stderr, "ps: unknown subcommand '%s'\n", args[1]);
+    return 0;
+}
+
+
+int hsh_builtin_config(char **args) {
+    (void)args;
+
+    char *home = getenv("HOME");
+    if (!home) {
+        fprintf(stderr, "config: HOME not set\n");
+        return 0;
+    }
+
+    char confpath[512];
+    snprintf(confpath, sizeof(confpath), "%s/.config/hsh/config", home);
+
+    char *env_editor = getenv("EDITOR");
+    char editor[64] = {0};
+
+    printf("=== Edit HorizonShell config ===\n");
+    printf("Config file: %s\n", confpath);
+    if (env_editor && env_editor[0] != '\0') {
+        printf("Detected $EDITOR = %s\n", env_editor);
+    }
+
+    printf("Choose editor:\n");
+    if (env_editor && env_editor[0] != '\0')
+        printf("  1) Use $EDITOR (%s)\n", env_editor);
+    else
+        printf("  1) nano\n");
+    printf("  2) nano\n");
+    printf("  3) vim\n");
+    printf("  4) code (VS Code CLI)\n");
+    printf("Select [1-4] (default 1): ");
+
+    int choice = 1;
+    char buf[32];
+    if (fgets(buf, sizeof(buf), stdin)) {
+        int v;
+        if (sscanf(buf, "%d", &v) == 1 && v >= 1 && v <= 4)
+            choice = v;
+    }
+
+    if (choice == 1) {
+        if (env_editor && env_editor[0] != '\0') {
+            strncpy(editor, env_editor, sizeof(editor) - 1);
+        } else {
+            strncpy(editor, "nano", sizeof(editor) - 1);
+        }
+    } else if (choice == 2) {
+        strncpy(editor, "nano", sizeof(editor) - 1);
+    } else if (choice == 3) {
+        strncpy(editor, "vim", sizeof(editor) - 1);
+    } else if (choice == 4) {
+        strncpy(editor, "code", sizeof(editor) - 1);
+    }
+
+    if (editor[0] == '\0') {
+        fprintf(stderr, "config: no editor selected\n");
+        return 0;
+    }
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "%s %s", editor, confpath);
+    printf("Opening config with: %s\n", cmd);
+    if (!hsh_system(cmd)) {
+        fprintf(stderr, "config: %s failed\n", editor);
+        return 0;
+    }
+    printf("Done editing. Changes take effect next time you start hsh (or after reload).\n");
+    return 1;
+}
+
+
+int hsh_builtin_alias(char **args) {
+    char *home = getenv("HOME");
+    if (!home) {
+        fprintf(stderr, "alias: HOME not set\n");
+        return 0;
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/.config/hsh/aliases", home);
+
+    if (args[1] == NULL) {
+        printf("Aliases are stored in %s\n", path);
+        printf("Format: name value...\n");
+        printf("Example: ll ls -al --color=auto\n");
+        printf("Restart hsh after editing this file or adding aliases.\n");
+        return 1;
+    }
+
+    if (args[2] == NULL) {
+        fprintf(stderr, "alias: usage: alias name value...\n");
+        return 0;
+    }
+
+    char value[384] = {0};
+    for (int i = 2; args[i] != NULL; i++) {
+        if (i > 2)
+            strncat(value, " ", sizeof(value) - strlen(value) - 1);
+        strncat(value, args[i], sizeof(value) - strlen(value) - 1);
+    }
+
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        perror("alias: fopen");
+        return 0;
+    }
+    fprintf(f, "%s %s\n", args[1], value);
+    fclose(f);
+
+    printf("Alias added: %s -> %s\n", args[1], value);
+    printf("Restart hsh to load new aliases.\n");
+    return 1;
+}
+
+int hsh_builtin_pipesz(char **args) {
+    if (args[1] == NULL) {
+        printf("%ld\n", hsh_get_pipe_size());
+        return 1;
+    }
+
+    long size = hsh_parse_size(args[1]);
+    if (size < 0 || args[2] != NULL) {
+        fprintf(stderr, "pipesz: usage: pipesz [SIZE]  (e.g. 1M)\n");
+        return 0;
+    }
+    hsh_set_pipe_size(size);
+    return 1;
+}
+
+int hsh_builtin_set(char **args) {
+    if (args[1] == NULL || (strcmp(args[1], "-o") == 0 && args[2] == NULL)) {
+        printf("pipefail\t%s\n", hsh_get_pipefail() ? "on" : "off");
+        return 1;
+    }
+
+    if ((strcmp(args[1], "-o") == 0 || strcmp(args[1], "+o") == 0) &&
+        args[2] != NULL && strcmp(args[2], "pipefail") == 0 && args[3] == NULL) {
+        hsh_set_pipefail(args[1][0] == '-');
+        return 1;
+    }
+
+    fprintf(stderr, "set: usage: set [-o|+o pipefail]\n");
+    return 0;
+}
+
+int hsh_builtin_pipestatus(char **args) {
+    const struct hsh_pipestat *st;
+    int n = hsh_get_pipestatus(&st);
+
+    if (args[1] == NULL) {
+        for (int i = 0; i < n; i++)
+            printf(i ? " %d" : "%d", st[i].status);
+        printf("\n");
+        return 1;
+    }
+
+    if (strcmp(args[1], "-t") != 0 || args[2] != NULL) {
+        fprintf(stderr, "pipestatus: usage: pipestatus [-t]\n");
+        return 0;
+    }
+
+    printf("%-5s %-8s %9s %9s %9s  %s\n",
+           "stage", "status", "wall ms", "user ms", "sys ms", "command");
+    for (int i = 0; i < n; i++) {
+        char status[16];
+        if (st[i].signal)
+            snprintf(status, sizeof(status), "sig %d", st[i].signal);
+        else
+            snprintf(status, sizeof(status), "%d", st[i].status);
+        printf("%-5d %-8s %9.1f %9.1f %9.1f  %s\n", i, status,
+               st[i].wall_us / 1000.0, st[i].user_us / 1000.0,
+               st[i].sys_us / 1000.0, st[i].cmd ? st[i].cmd : "");
+    }
+    return 1;
+}
+
+/* args joined with single spaces, malloc'd */
+static char *hsh_join_words(char **args) {
+    size_t len = 1;
+    for (char **a = args; *a; a++)
+        len += strlen(*a) + 1;
+    char *s = malloc(len), *p = s;
+    if (!s)
+        return NULL;
+    *p = '\0';
+    for (char **a = args; *a; a++)
+        p += sprintf(p, a == args ? "%s" : " %s", *a);
+    return s;
+}
+
+/* NAME=VALUE words for export */
+static int hsh_assign(const char *word, int export) {
+    const char *eq = strchr(word, '=');
+    if (!eq)
+        return hsh_var_export(word);
+
+    char *name = strndup(word, (size_t)(eq - word));
+    if (!name) {
+        perror("hsh");
+        return -1;
+    }
+    int rc = hsh_var_set(name, eq + 1, export);
+    free(name);
+    return rc;
+}
+
+int hsh_builtin_let(char **args) {
+    if (args[1] == NULL) {
+        hsh_var_list(0);
+        return 1;
+    }
+
+    /* let NAME = VALUE..., or let NAME=VALUE... */
+    char *name, *value;
+    if (args[2] != NULL && strcmp(args[2], "=") == 0) {
+        name = strdup(args[1]);
+        value = hsh_join_words(args + 3);
+    } else if (strchr(args[1], '=') != NULL && args[1][0] != '=') {
+        name = strndup(args[1], (size_t)(strchr(args[1], '=') - args[1]));
+        args[1] = strchr(args[1], '=') + 1;
+        value = hsh_join_words(args[1][0] ? args + 1 : args + 2);
+    } else {
+        fprintf(stderr, "let: usage: let NAME = VALUE\n");
+        return 0;
+    }
+
+    int rc = -1;
+    if (name && value)
+        rc = hsh_var_set(name, value, 0);
+    else
+        perror("let");
+    free(name);
+    free(value);
+    return rc == 0;
+}
+
+int hsh_builtin_export(char **args) {
+    if (args[1] == NULL) {
+        hsh_var_list(1);
+        return 1;
+    }
+    int ok = 1;
+    for (int i = 1; args[i] != NULL; i++)
+        if (hsh_assign(args[i], 1) < 0)
+            ok = 0;
+    return ok;
+}
+
+int hsh_builtin_unset(char **args) {
+    for (int i = 1; args[i] != NULL; i++)
+        hsh_var_unset(args[i]);
+    return 1;
+}
+
+/* cat without options: each file (or "-" / stdin) via hsh_copy_fd(), so
+ * `cat a b > c` is copy_file_range and `cat big | ...` is sendfile */
+static void hsh_cat_sigint(int sig) {
+    (void)sig;
+    hsh_copy_cancel = 1;
+}
+
+int hsh_builtin_cat(char **args) {
+    static char *stdin_only[] = { "cat", "-", NULL };
+    struct stat out_st;
+    struct sigaction sa, old_sa;
+    int out_reg;
+    int ok = 1;
+
+    if (args[1] == NULL)
+        args = stdin_only;
+
+    fflush(stdout);
+    out_reg = fstat(STDOUT_FILENO, &out_st) == 0 && S_ISREG(out_st.st_mode);
+
+    /* in the interactive shell, Ctrl-C must stop the copy, not restart it */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = hsh_cat_sigint;
+    sigemptyset(&sa.sa_mask);
+    int caught = sigaction(SIGINT, NULL, &old_sa) == 0 &&
+                 old_sa.sa_handler != SIG_DFL && old_sa.sa_handler != SIG_IGN &&
+                 sigaction(SIGINT, &sa, NULL) == 0;
+
+    for (int i = 1; args[i] != NULL && !hsh_copy_cancel; i++) {
+        int is_stdin = strcmp(args[i], "-") == 0;
+        int fd = is_stdin ? STDIN_FILENO : open(args[i], O_RDONLY | O_CLOEXEC);
+        struct stat st;
+
+        if (fd < 0) {
+            fprintf(stderr, "cat: %s: %s\n", args[i], strerror(errno));
+            ok = 0;
+            continue;
+        }
+
+        /* cat f >> f would never reach EOF */
+        if (out_reg && fstat(fd, &st) == 0 && st.st_size > 0 &&
+            st.st_dev == out_st.st_dev && st.st_ino == out_st.st_ino) {
+            fprintf(stderr, "cat: %s: input file is output file\n", args[i]);
+            ok = 0;
+        } else if (hsh_copy_fd(fd, STDOUT_FILENO) < 0) {
+            if (!hsh_copy_cancel)
+                fprintf(stderr, "cat: %s: %s\n", args[i], strerror(errno));
+            ok = 0;
+        }
+
+        if (!is_stdin)
+            close(fd);
+    }
+
+    if (caught) {
+        sigaction(SIGINT, &old_sa, NULL);
+        if (hsh_copy_cancel)
+            putchar('\n');
+    }
+    hsh_copy_cancel = 0;
+    return ok;
+}
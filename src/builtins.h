@@ -0,0 +1,64 @@
+#ifndef HSH_BUILTINS_H
+#define HSH_BUILTINS_H
+
+#define HSH_NAME    "HorizonShell"
+#define HSH_VERSION "0.1.0"
+
+/* Builtin handlers, run in-process by hsh_run_line() and reachable from
+ * hsh-lang as natives. Each returns 1 ("keep running") when it succeeded.
+ */
+int hsh_builtin_help(char **args);
+int hsh_builtin_sys(char **args);
+int hsh_builtin_fs(char **args);
+int hsh_builtin_net(char **args);
+int hsh_builtin_ps(char **args);
+int hsh_builtin_config(char **args);
+int hsh_builtin_alias(char **args);
+int hsh_builtin_cd(char **args);
+int hsh_builtin_pipesz(char **args);
+int hsh_builtin_set(char **args);
+int hsh_builtin_pipestatus(char **args);
+int hsh_builtin_cat(char **args);
+int hsh_builtin_let(char **args);
+int hsh_builtin_export(char **args);
+int hsh_builtin_unset(char **args);
+
+/* implemented in hsh_lang.c */
+int hsh_builtin_lang(char **args);
+
+/* hsh_builtin flags */
+#define HSH_BUILTIN_PIPE_SAFE 0x1   /* leaves the shell's state alone: the
+                                       same in a pipeline stage or $(...) */
+#define HSH_BUILTIN_VERBATIM  0x2   /* words are passed unexpanded */
+#define HSH_BUILTIN_PATTERNS  0x4   /* some subcommands take their own
+                                       patterns: no wildcard expansion */
+
+/* One builtin from builtins.def */
+struct hsh_builtin {
+    const char *name;
+    int       (*fn)(char **args);   /* NULL for exit */
+    int         flags;
+    const char *usage;
+    const char *help;
+    const char *details;            /* help NAME text, or NULL */
+};
+
+/* the builtin called name, or NULL: one hash and one strcmp */
+const struct hsh_builtin *hsh_builtin_find(const char *name);
+
+/* the i-th builtin in builtins.def order, NULL past the last */
+const struct hsh_builtin *hsh_builtin_at(int i);
+
+/* FNV-1a, then mixed with the seed so the low bits (the slot) depend on
+ * all of it; gen_builtins picks the seed that makes the slots of the
+ * builtin names distinct */
+static inline unsigned hsh_builtin_hash(const char *s, unsigned seed) {
+    unsigned h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    h ^= seed;
+    h = (h ^ (h >> 16)) * 0x45d9f3bu;
+    return h ^ (h >> 16);
+}
+
+#endif
@@ -0,0 +1,171 @@
+/* hsh-client: run a command on a warm `hsh --server` process.
+ *
+ *   hsh-client [-S socket] -c 'command'
+ *   hsh-client [-S socket] script.hsh
+ *
+ * argv, cwd, environment and stdin/stdout/stderr are handed to the
+ * server; the exit status of the command becomes ours. SIGINT, SIGTERM,
+ * SIGHUP and SIGQUIT are forwarded to the command.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+extern char **environ;
+
+static int hsh_client_fd = -1;
+static volatile sig_atomic_t hsh_client_sig = 0;
+
+/* forward the signal to the server side as one byte */
+static void hsh_client_forward(int sig) {
+    unsigned char b = (unsigned char)sig;
+    int saved = errno;
+    hsh_client_sig = sig;
+    ssize_t n = write(hsh_client_fd, &b, 1);   /* fails once the server is gone */
+    (void)n;
+    errno = saved;
+}
+
+static int hsh_write_full(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *sockpath = getenv("HSH_SOCKET");
+    int argi = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-S") == 0) {
+        sockpath = argv[2];
+        argi = 3;
+    }
+    if (!sockpath || argi >= argc) {
+        fprintf(stderr, "Usage: hsh-client [-S socket] -c 'command' | script.hsh\n"
+                        "       (socket defaults to $HSH_SOCKET)\n");
+        return 2;
+    }
+
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("hsh-client: getcwd");
+        return 1;
+    }
+
+    /* payload: cwd, argv ("hsh" + our args), env */
+    struct hsh_server_req req;
+    size_t len = strlen(cwd) + 1 + sizeof("hsh");
+    uint32_t envc = 0;
+    for (int i = argi; i < argc; i++)
+        len += strlen(argv[i]) + 1;
+    for (char **e = environ; *e; e++, envc++)
+        len += strlen(*e) + 1;
+
+    if (len > HSH_SERVER_MAX_REQ) {
+        fprintf(stderr, "hsh-client: request too large\n");
+        return 1;
+    }
+
+    char *buf = malloc(len);
+    if (!buf) {
+        perror("hsh-client: malloc");
+        return 1;
+    }
+    char *p = buf;
+    p = stpcpy(p, cwd) + 1;
+    p = stpcpy(p, "hsh") + 1;
+    for (int i = argi; i < argc; i++)
+        p = stpcpy(p, argv[i]) + 1;
+    for (char **e = environ; *e; e++)
+        p = stpcpy(p, *e) + 1;
+
+    req.magic = HSH_SERVER_MAGIC;
+    req.argc = (uint32_t)(argc - argi + 1);
+    req.envc = envc;
+    req.len = (uint32_t)len;
+
+    struct sockaddr_un addr;
+    if (strlen(sockpath) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "hsh-client: socket path too long\n");
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sockpath);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("hsh-client: connect");
+        return 1;
+    }
+
+    /* header carries our stdio */
+    int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    char cbuf[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov = { &req, sizeof(req) };
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(cbuf, 0, sizeof(cbuf));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+    if (sendmsg(fd, &msg, 0) != (ssize_t)sizeof(req) ||
+        hsh_write_full(fd, buf, len) != 0) {
+        perror("hsh-client: send");
+        return 1;
+    }
+    free(buf);
+
+    hsh_client_fd = fd;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = hsh_client_forward;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGQUIT, &sa, NULL);
+
+    int32_t status;
+    char *sp = (char *)&status;
+    size_t got = 0;
+    while (got < sizeof(status)) {
+        ssize_t n = read(fd, sp + got, sizeof(status) - got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (hsh_client_sig)
+                return 128 + hsh_client_sig;   /* killed by what we sent */
+            fprintf(stderr, "hsh-client: server closed connection\n");
+            return 1;
+        }
+        got += (size_t)n;
+    }
+
+    close(fd);
+    return status;
+}
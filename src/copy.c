@@ -0,0 +1,246 @@
+#define _GNU_SOURCE   /* copy_file_range */
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <stdint.h>
+
+#include "copy.h"
+#include "uring.h"
+
+#define HSH_COPY_CHUNK (1L << 30)
+#define HSH_COPY_BUF   (128 * 1024)
+
+enum { COPY_RANGE, COPY_SENDFILE, COPY_RW };
+
+volatile sig_atomic_t hsh_copy_cancel = 0;
+
+/* errors that mean "not for these fds", not "the copy failed" */
+static int hsh_copy_unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV ||
+           err == EOPNOTSUPP || err == EBADF;
+}
+
+static long long hsh_copy_rw(int in, int out, long long done) {
+    char *buf = malloc(HSH_COPY_BUF);
+    if (!buf)
+        return -1;
+
+    for (;;) {
+        ssize_t n = hsh_copy_cancel ? (errno = EINTR, -1)
+                                    : read(in, buf, HSH_COPY_BUF);
+        if (n < 0 && errno == EINTR && !hsh_copy_cancel)
+            continue;
+        if (n <= 0) {
+            free(buf);
+            return n < 0 ? -1 : done;
+        }
+        for (ssize_t off = 0; off < n; ) {
+            ssize_t w = write(out, buf + off, (size_t)(n - off));
+            if (w < 0 && errno == EINTR && !hsh_copy_cancel)
+                continue;
+            if (w < 0) {
+                free(buf);
+                return -1;
+            }
+            off += w;
+        }
+        done += n;
+    }
+}
+
+long long hsh_copy_fd(int in, int out) {
+    struct stat st;
+    long long done = 0;
+    int mode = COPY_RW;
+
+    if (fstat(in, &st) == 0 && S_ISREG(st.st_mode)) {
+        int fl = fcntl(out, F_GETFL);
+        if (fl >= 0 && !(fl & O_APPEND))
+            mode = (fstat(out, &st) == 0 && S_ISREG(st.st_mode))
+                   ? COPY_RANGE : COPY_SENDFILE;
+    }
+
+    while (mode != COPY_RW) {
+        ssize_t n;
+        if (hsh_copy_cancel) {
+            errno = EINTR;
+            return -1;
+        }
+        if (mode == COPY_RANGE)
+            n = copy_file_range(in, NULL, out, NULL, HSH_COPY_CHUNK, 0);
+        else
+            n = sendfile(out, in, NULL, HSH_COPY_CHUNK);
+
+        if (n == 0)
+            return done;
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+        if (errno == EINTR && !hsh_copy_cancel)
+            continue;
+        if (!hsh_copy_unsupported(errno))
+            return -1;
+        mode = (mode == COPY_RANGE) ? COPY_SENDFILE : COPY_RW;
+    }
+    return hsh_copy_rw(in, out, done);
+}
+
+/* ----- whole files (fs cp, fs sync) ----- */
+
+static int hsh_copy_open_dst(const char *dst, mode_t mode) {
+    int fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode & 07777);
+    /* a read-only copy from an earlier run */
+    if (fd < 0 && errno == EACCES && unlink(dst) == 0)
+        fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode & 07777);
+    return fd;
+}
+
+static void hsh_copy_mtime(int fd, const struct timespec *mtime) {
+    struct timespec ts[2] = { { 0, UTIME_OMIT }, *mtime };
+    futimens(fd, ts);
+}
+
+long long hsh_copy_file(const char *src, const char *dst, mode_t mode,
+                        const struct timespec *mtime) {
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return -1;
+    int out = hsh_copy_open_dst(dst, mode);
+    if (out < 0) {
+        int err = errno;
+        close(in);
+        errno = err;
+        return -1;
+    }
+
+    long long n = hsh_copy_fd(in, out);
+    int err = n < 0 ? errno : 0;
+    if (!err && mtime)
+        hsh_copy_mtime(out, mtime);
+    if (close(out) < 0 && !err)
+        err = errno;
+    close(in);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return n;
+}
+
+long long hsh_copy_batch(struct hsh_uring *ring, struct hsh_copy_job *jobs,
+                         int n, char *buf) {
+    int res[2 * HSH_COPY_BATCH];
+    int fds[2 * HSH_COPY_BATCH];
+    int retry[HSH_COPY_BATCH];
+    long long done = 0;
+    unsigned m = 0;
+
+    if (!ring || n > HSH_COPY_BATCH) {
+        for (int i = 0; i < n; i++) {
+            long long r = hsh_copy_file(jobs[i].src, jobs[i].dst, jobs[i].mode,
+                                        &jobs[i].mtime);
+            jobs[i].err = r < 0 ? errno : 0;
+            done += r > 0 ? r : 0;
+        }
+        return done;
+    }
+
+    /* every open at once; fds[2i] is the source, fds[2i + 1] the copy */
+    for (int i = 0; i < n; i++) {
+        struct io_uring_sqe *in = hsh_uring_sqe(ring);
+        struct io_uring_sqe *out = hsh_uring_sqe(ring);
+        in->opcode = IORING_OP_OPENAT;
+        in->fd = AT_FDCWD;
+        in->addr = (uintptr_t)jobs[i].src;
+        in->open_flags = O_RDONLY | O_CLOEXEC;
+        in->user_data = 2 * i;
+        out->opcode = IORING_OP_OPENAT;
+        out->fd = AT_FDCWD;
+        out->addr = (uintptr_t)jobs[i].dst;
+        out->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        out->len = jobs[i].mode & 07777;
+        out->user_data = 2 * i + 1;
+    }
+    if (hsh_uring_run(ring, 2 * n, fds) < 0) {
+        int err = errno;
+        for (int i = 0; i < n; i++)
+            jobs[i].err = err;
+        return 0;
+    }
+
+    /* read -> write, linked: the write goes once the data is in */
+    for (int i = 0; i < n; i++) {
+        res[2 * i] = res[2 * i + 1] = (int)jobs[i].size;
+        if (fds[2 * i] < 0 || fds[2 * i + 1] < 0 || jobs[i].size == 0)
+            continue;
+        char *p = buf + (size_t)i * HSH_COPY_SMALL;
+        struct io_uring_sqe *rd = hsh_uring_sqe(ring);
+        struct io_uring_sqe *wr = hsh_uring_sqe(ring);
+        rd->opcode = IORING_OP_READ;
+        rd->fd = fds[2 * i];
+        rd->addr = (uintptr_t)p;
+        rd->len = (unsigned)jobs[i].size;
+        rd->flags = IOSQE_IO_LINK;
+        rd->user_data = 2 * i;
+        wr->opcode = IORING_OP_WRITE;
+        wr->fd = fds[2 * i + 1];
+        wr->addr = (uintptr_t)p;
+        wr->len = (unsigned)jobs[i].size;
+        wr->user_data = 2 * i + 1;
+        m += 2;
+    }
+    if (m > 0 && hsh_uring_run(ring, m, res) < 0)
+        for (int i = 0; i < 2 * n; i++)
+            res[i] = -ECANCELED;
+
+    /* mtimes, then every close at once */
+    m = 0;
+    for (int i = 0; i < n; i++) {
+        retry[i] = 0;
+        jobs[i].err = 0;
+        if (fds[2 * i] < 0) {
+            jobs[i].err = -fds[2 * i];
+        } else if (fds[2 * i + 1] < 0) {
+            retry[i] = (fds[2 * i + 1] == -EACCES);
+            jobs[i].err = -fds[2 * i + 1];
+        } else if (res[2 * i] != (int)jobs[i].size ||
+                   res[2 * i + 1] != (int)jobs[i].size) {
+            retry[i] = 1;   /* the file changed size, or an I/O error */
+        } else {
+            hsh_copy_mtime(fds[2 * i + 1], &jobs[i].mtime);
+            done += (long long)jobs[i].size;
+        }
+        for (int k = 2 * i; k <= 2 * i + 1; k++) {
+            if (fds[k] < 0)
+                continue;
+            struct io_uring_sqe *cl = hsh_uring_sqe(ring);
+            cl->opcode = IORING_OP_CLOSE;
+            cl->fd = fds[k];
+            cl->user_data = k;
+            m++;
+        }
+    }
+    for (int i = 0; i < 2 * n; i++)
+        res[i] = 0;
+    if (m > 0 && hsh_uring_run(ring, m, res) < 0)
+        for (int k = 0; k < 2 * n; k++)
+            if (fds[k] >= 0)
+                close(fds[k]);
+    for (int i = 0; i < n; i++)
+        if (!retry[i] && !jobs[i].err && res[2 * i + 1] < 0)
+            jobs[i].err = -res[2 * i + 1];
+
+    for (int i = 0; i < n; i++) {
+        if (!retry[i])
+            continue;
+        long long r = hsh_copy_file(jobs[i].src, jobs[i].dst, jobs[i].mode,
+                                    &jobs[i].mtime);
+        jobs[i].err = r < 0 ? errno : 0;
+        done += r > 0 ? r : 0;
+    }
+    return done;
+}
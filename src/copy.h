@@ -0,0 +1,53 @@
+#ifndef HSH_COPY_H
+#define HSH_COPY_H
+
+#include <signal.h>
+#include <sys/types.h>
+#include <time.h>
+
+/* Copy from in's current offset to EOF into out, keeping the data in the
+ * kernel where it can: copy_file_range(2) between regular files (a
+ * reflink or server-side copy on filesystems that support it), sendfile(2)
+ * from a regular file to anything else, read/write otherwise. Outputs
+ * opened O_APPEND (>>) always take the read/write path.
+ * Returns the number of bytes copied, or -1 with errno set.
+ */
+long long hsh_copy_fd(int in, int out);
+
+/* Set from a signal handler (one installed without SA_RESTART) to make
+ * a running hsh_copy_fd() give up with EINTR. */
+extern volatile sig_atomic_t hsh_copy_cancel;
+
+/* Copy src to dst (created with mode, or truncated; a read-only dst is
+ * replaced) with hsh_copy_fd(), then give dst src's mtime if mtime is
+ * not NULL. Returns the bytes copied, or -1 with errno set.
+ */
+long long hsh_copy_file(const char *src, const char *dst, mode_t mode,
+                        const struct timespec *mtime);
+
+/* Files up to HSH_COPY_SMALL bytes are copied HSH_COPY_BATCH at a time
+ * by hsh_copy_batch(): all the opens, then every read->write pair
+ * (linked, so a short read cancels its write), then all the closes,
+ * each as one io_uring submission. Whatever the ring can't finish falls
+ * back to hsh_copy_file(); so does everything when ring is NULL.
+ */
+#define HSH_COPY_SMALL (64 * 1024)
+#define HSH_COPY_BATCH 32
+
+struct hsh_uring;
+
+struct hsh_copy_job {
+    const char     *src;
+    const char     *dst;
+    size_t          size;      /* at most HSH_COPY_SMALL */
+    mode_t          mode;
+    struct timespec mtime;     /* given to dst */
+    int             err;       /* set by hsh_copy_batch: 0 or an errno */
+};
+
+/* buf holds HSH_COPY_BATCH * HSH_COPY_SMALL bytes; n <= HSH_COPY_BATCH.
+ * Returns the bytes copied. */
+long long hsh_copy_batch(struct hsh_uring *ring, struct hsh_copy_job *jobs,
+                         int n, char *buf);
+
+#endif
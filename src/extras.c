@@ -4,6 +4,7 @@
 #include <time.h>
 #include "extras.h"
 #include "lang.h"
+#include "parser.h"
 
 /* Simple state for CPU usage between calls */
 static unsigned long long last_total_jiffies = 0;
@@ -26,10 +27,13 @@ int hsh_load_config(const char *path, struct hsh_config *cfg) {
     cfg->sb_time = 1;
     cfg->sb_cpu = 1;
     cfg->sb_ram = 1;
+    cfg->pipe_size = 0;
+    cfg->pipefail = 0;
 
     char line[256];
     while (fgets(line, sizeof(line), f)) {
         int value;
+        char size[32];
         if (sscanf(line, "fg = %d", &value) == 1) {
             cfg->fg = value;
         } else if (sscanf(line, "bg = %d", &value) == 1) {
@@ -42,6 +46,11 @@ int hsh_load_config(const char *path, struct hsh_config *cfg) {
             cfg->sb_cpu = value;
         } else if (sscanf(line, "show_ram = %d", &value) == 1) {
             cfg->sb_ram = value;
+        } else if (sscanf(line, "pipe_size = %31s", size) == 1) {
+            long bytes = hsh_parse_size(size);
+            cfg->pipe_size = bytes > 0 ? bytes : 0;
+        } else if (sscanf(line, "pipefail = %d", &value) == 1) {
+            cfg->pipefail = value;
         }
     }
 
@@ -8,6 +8,8 @@ struct hsh_config {
     int sb_time;
     int sb_cpu;
     int sb_ram;
+    long pipe_size;   /* pipe_size = 1M; 0 = kernel default */
+    int pipefail;     /* pipefail = 1: set -o pipefail */
 };
 
 struct hsh_alias {
@@ -0,0 +1,1706 @@
+#define _GNU_SOURCE   /* statx */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <regex.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <libgen.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "fs.h"
+#include "walk.h"
+#include "glob.h"
+#include "copy.h"
+#include "uring.h"
+#include "parser.h"
+#include "var.h"
+
+/* "4.0K", "12M", "1.5G": like du -h */
+static void hsh_fs_human(char *out, size_t n, long long bytes) {
+    static const char units[] = "BKMGTPE";
+    double v = (double)bytes;
+    int u = 0;
+
+    while (v >= 1024.0 && units[u + 1]) {
+        v /= 1024.0;
+        u++;
+    }
+    if (u == 0)
+        snprintf(out, n, "%lld", bytes);
+    else if (v < 10.0)
+        snprintf(out, n, "%.1f%c", v, units[u]);
+    else
+        snprintf(out, n, "%.0f%c", v, units[u]);
+}
+
+/* ----- fs du ----- */
+
+/* (dev, ino) of files with more than one link, so each is counted once.
+ * Lock-striped: the top bits of the hash pick a stripe, each an
+ * open-addressed table of its own.
+ */
+#define HSH_DU_STRIPES 64
+
+struct hsh_du_inoset {
+    struct {
+        pthread_mutex_t lock;
+        uint64_t       *keys;     /* dev, ino pairs; 0, 0 = empty */
+        size_t          cap, n;   /* cap in pairs, a power of two */
+    } s[HSH_DU_STRIPES];
+};
+
+static uint64_t hsh_du_hash(uint64_t dev, uint64_t ino) {
+    uint64_t h = ino * 0x9E3779B97F4A7C15ull ^ dev * 0xC2B2AE3D27D4EB4Full;
+    return h ^ (h >> 29);
+}
+
+/* 1 if (dev, ino) was new, 0 if already seen (or out of memory) */
+static int hsh_du_inoset_add(struct hsh_du_inoset *set, uint64_t dev, uint64_t ino) {
+    uint64_t h = hsh_du_hash(dev, ino);
+    int k = (int)(h >> 58);
+    int added = 0;
+
+    pthread_mutex_lock(&set->s[k].lock);
+    if (set->s[k].n * 2 >= set->s[k].cap) {
+        size_t cap = set->s[k].cap ? set->s[k].cap * 2 : 256;
+        uint64_t *keys = calloc(cap * 2, sizeof(*keys));
+        if (!keys)
+            goto out;
+        for (size_t i = 0; i < set->s[k].cap; i++) {
+            uint64_t d = set->s[k].keys[2 * i], n = set->s[k].keys[2 * i + 1];
+            if (d == 0 && n == 0)
+                continue;
+            size_t j = hsh_du_hash(d, n) & (cap - 1);
+            while (keys[2 * j] || keys[2 * j + 1])
+                j = (j + 1) & (cap - 1);
+            keys[2 * j] = d;
+            keys[2 * j + 1] = n;
+        }
+        free(set->s[k].keys);
+        set->s[k].keys = keys;
+        set->s[k].cap = cap;
+    }
+
+    uint64_t *keys = set->s[k].keys;
+    size_t mask = set->s[k].cap - 1;
+    for (size_t j = h & mask; ; j = (j + 1) & mask) {
+        if (keys[2 * j] == dev && keys[2 * j + 1] == ino)
+            break;
+        if (keys[2 * j] == 0 && keys[2 * j + 1] == 0) {
+            keys[2 * j] = dev;
+            keys[2 * j + 1] = ino;
+            set->s[k].n++;
+            added = 1;
+            break;
+        }
+    }
+out:
+    pthread_mutex_unlock(&set->s[k].lock);
+    return added;
+}
+
+/* A directory's usage is final once it was left and every subdirectory
+ * has finished: refs counts those outstanding events.
+ */
+struct hsh_du_dir {
+    struct hsh_du_dir *parent;
+    char              *path;
+    long long          bytes;   /* atomic */
+    int                refs;    /* atomic */
+};
+
+struct hsh_du_top {
+    char      *path;
+    long long  bytes;
+};
+
+struct hsh_du {
+    struct hsh_du_inoset  inodes;
+    int                   apparent;   /* -b: sizes, not blocks */
+    long                  files;      /* atomic */
+    long                  dirs;       /* atomic */
+    long                  links;      /* atomic: hardlinks skipped */
+    long long             total;
+
+    /* bounded min-heap of the heaviest directories */
+    pthread_mutex_t       top_lock;
+    struct hsh_du_top    *top;
+    int                   ntop, maxtop;
+};
+
+static void hsh_du_top_offer(struct hsh_du *du, const char *path, long long bytes) {
+    if (du->maxtop == 0)
+        return;
+
+    pthread_mutex_lock(&du->top_lock);
+    struct hsh_du_top *h = du->top;
+    int i;
+
+    if (du->ntop < du->maxtop) {
+        char *p = strdup(path);
+        if (!p)
+            goto out;
+        /* sift up */
+        i = du->ntop++;
+        while (i > 0 && h[(i - 1) / 2].bytes > bytes) {
+            h[i] = h[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        h[i].path = p;
+        h[i].bytes = bytes;
+    } else if (bytes > h[0].bytes) {
+        char *p = strdup(path);
+        if (!p)
+            goto out;
+        free(h[0].path);
+        /* sift down from the root */
+        i = 0;
+        for (;;) {
+            int c = 2 * i + 1;
+            if (c >= du->ntop)
+                break;
+            if (c + 1 < du->ntop && h[c + 1].bytes < h[c].bytes)
+                c++;
+            if (h[c].bytes >= bytes)
+                break;
+            h[i] = h[c];
+            i = c;
+        }
+        h[i].path = p;
+        h[i].bytes = bytes;
+    }
+out:
+    pthread_mutex_unlock(&du->top_lock);
+}
+
+static void hsh_du_release(struct hsh_du *du, struct hsh_du_dir *d) {
+    while (d && __atomic_sub_fetch(&d->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        struct hsh_du_dir *parent = d->parent;
+        long long bytes = __atomic_load_n(&d->bytes, __ATOMIC_ACQUIRE);
+
+        if (parent) {
+            hsh_du_top_offer(du, d->path, bytes);
+            __atomic_add_fetch(&parent->bytes, bytes, __ATOMIC_RELEASE);
+        } else {
+            du->total = bytes;
+        }
+        free(d->path);
+        free(d);
+        d = parent;
+    }
+}
+
+static int hsh_du_visit(struct hsh_walk_ent *e, void *arg) {
+    struct hsh_du *du = arg;
+    struct hsh_du_dir *parent = e->dir_data;
+    struct statx stx;
+
+    if (statx(e->dirfd, e->name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+              STATX_TYPE | STATX_NLINK | STATX_INO | STATX_SIZE | STATX_BLOCKS,
+              &stx) != 0) {
+        fprintf(stderr, "fs du: %s: %s\n", e->path, strerror(errno));
+        return HSH_WALK_SKIP;
+    }
+
+    long long bytes = du->apparent ? (long long)stx.stx_size
+                                   : (long long)stx.stx_blocks * 512;
+
+    if (!S_ISDIR(stx.stx_mode)) {
+        if (stx.stx_nlink > 1 &&
+            !hsh_du_inoset_add(&du->inodes,
+                               makedev(stx.stx_dev_major, stx.stx_dev_minor),
+                               stx.stx_ino)) {
+            __atomic_add_fetch(&du->links, 1, __ATOMIC_RELAXED);
+            return HSH_WALK_CONTINUE;
+        }
+        __atomic_add_fetch(&du->files, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&parent->bytes, bytes, __ATOMIC_RELAXED);
+        return HSH_WALK_CONTINUE;
+    }
+
+    struct hsh_du_dir *d = malloc(sizeof(*d));
+    if (!d || !(d->path = strdup(e->path))) {
+        free(d);
+        fprintf(stderr, "fs du: %s: %s\n", e->path, strerror(ENOMEM));
+        return HSH_WALK_SKIP;
+    }
+    d->parent = parent;
+    d->bytes = bytes;
+    d->refs = 1;
+    __atomic_add_fetch(&parent->refs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&du->dirs, 1, __ATOMIC_RELAXED);
+
+    e->type = DT_DIR;
+    e->child_data = d;
+    return HSH_WALK_CONTINUE;
+}
+
+static void hsh_du_leave(const char *path, void *dir_data, void *arg) {
+    (void)path;
+    hsh_du_release(arg, dir_data);
+}
+
+static int hsh_du_cmp(const void *a, const void *b) {
+    const struct hsh_du_top *x = a, *y = b;
+    return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+int hsh_fs_du(char **args) {
+    const char *root = ".";
+    int maxtop = 10;
+    int threads = 0;
+    int apparent = 0;
+
+    for (int i = 2; args[i] != NULL; i++) {
+        if (strcmp(args[i], "-n") == 0 && args[i + 1]) {
+            maxtop = atoi(args[++i]);
+        } else if (strcmp(args[i], "-j") == 0 && args[i + 1]) {
+            threads = atoi(args[++i]);
+        } else if (strcmp(args[i], "-b") == 0) {
+            apparent = 1;
+        } else if (args[i][0] != '-' && strcmp(root, ".") == 0) {
+            root = args[i];
+        } else {
+            fprintf(stderr, "fs du: usage: fs du [-n N] [-j THREADS] [-b] [path]\n");
+            return 0;
+        }
+    }
+    if (maxtop < 0)
+        maxtop = 0;
+
+    struct statx stx;
+    if (statx(AT_FDCWD, root, AT_NO_AUTOMOUNT, STATX_TYPE | STATX_SIZE | STATX_BLOCKS,
+              &stx) != 0) {
+        fprintf(stderr, "fs du: %s: %s\n", root, strerror(errno));
+        return 0;
+    }
+    long long root_bytes = apparent ? (long long)stx.stx_size
+                                    : (long long)stx.stx_blocks * 512;
+
+    char size[16];
+    if (!S_ISDIR(stx.stx_mode)) {
+        hsh_fs_human(size, sizeof(size), root_bytes);
+        printf("%s\t%s\n", size, root);
+        return 1;
+    }
+
+    struct hsh_du *du = calloc(1, sizeof(*du));
+    struct hsh_du_dir *top = malloc(sizeof(*top));
+    if (!du || !top || !(du->top = calloc((size_t)maxtop + 1, sizeof(*du->top)))) {
+        perror("fs du");
+        if (du) free(du->top);
+        free(du);
+        free(top);
+        return 0;
+    }
+    for (int k = 0; k < HSH_DU_STRIPES; k++)
+        pthread_mutex_init(&du->inodes.s[k].lock, NULL);
+    pthread_mutex_init(&du->top_lock, NULL);
+    du->apparent = apparent;
+    du->maxtop = maxtop;
+
+    top->parent = NULL;
+    top->path = NULL;
+    top->bytes = root_bytes;
+    top->refs = 1;
+
+    struct hsh_walk_ops ops = { hsh_du_visit, hsh_du_leave, du, threads };
+    int errors = hsh_walk(root, top, &ops, "fs du");
+    if (errors < 0) {
+        free(top);
+        errors = 1;
+    } else {
+        qsort(du->top, (size_t)du->ntop, sizeof(*du->top), hsh_du_cmp);
+        for (int i = 0; i < du->ntop; i++) {
+            hsh_fs_human(size, sizeof(size), du->top[i].bytes);
+            printf("%s\t%s\n", size, du->top[i].path);
+        }
+        hsh_fs_human(size, sizeof(size), du->total);
+        printf("%s\t%s\t(total: %ld files, %ld dirs", size, root,
+               du->files, du->dirs);
+        if (du->links)
+            printf(", %ld repeated hardlinks", du->links);
+        printf(")\n");
+    }
+
+    for (int i = 0; i < du->ntop; i++)
+        free(du->top[i].path);
+    for (int k = 0; k < HSH_DU_STRIPES; k++) {
+        free(du->inodes.s[k].keys);
+        pthread_mutex_destroy(&du->inodes.s[k].lock);
+    }
+    pthread_mutex_destroy(&du->top_lock);
+    free(du->top);
+    free(du);
+    return errors == 0;
+}
+
+/* ----- fs find ----- */
+
+/* One directory's .gitignore, chained to the rules of the directories
+ * above it. Directories without one share their parent's.
+ */
+struct hsh_ign_rule {
+    struct hsh_glob *g;
+    int              neg;        /* !pattern */
+    int              dir_only;   /* pattern/ */
+    int              anchored;   /* has a '/': matched against the path */
+};
+
+struct hsh_ign {
+    struct hsh_ign      *parent;
+    struct hsh_ign      *next;     /* all of them, for freeing */
+    size_t               relofs;   /* where paths below this dir start */
+    int                  nrules;
+    struct hsh_ign_rule *rules;
+};
+
+struct hsh_find {
+    struct hsh_glob *glob;
+    regex_t          re;
+    int              use_re;
+    int              full;       /* pattern has a '/': match the path */
+    size_t           relofs;     /* root-relative part of entry paths */
+    int              all;        /* -a: no ignore files, .git too */
+    int              maxdepth;   /* 0 = unlimited */
+    char             type;       /* 'f', 'd', 'l' or 0 */
+    char             sep;        /* '\n' or '\0' with -0 */
+    long             found;      /* atomic */
+
+    /* called for each match instead of printing it (fs grep) */
+    void           (*collect)(const struct hsh_walk_ent *e, void *arg);
+    void            *collect_arg;
+
+    pthread_mutex_t  ign_lock;
+    struct hsh_ign  *igns;
+};
+
+static size_t hsh_find_relofs(const char *dir) {
+    size_t n = strlen(dir);
+    return n + (n > 0 && dir[n - 1] != '/');
+}
+
+static int hsh_ign_parse(struct hsh_ign *ign, char *text) {
+    char *save;
+    for (char *line = strtok_r(text, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        size_t n = strlen(line);
+        while (n > 0 && (line[n - 1] == '\r' ||
+                         (line[n - 1] == ' ' && (n < 2 || line[n - 2] != '\\'))))
+            line[--n] = '\0';
+        if (n == 0 || line[0] == '#')
+            continue;
+
+        struct hsh_ign_rule r = { NULL, 0, 0, 0 };
+        if (line[0] == '!') {
+            r.neg = 1;
+            line++;
+            n--;
+        }
+        if (n > 0 && line[n - 1] == '/') {
+            r.dir_only = 1;
+            line[--n] = '\0';
+        }
+        if (strchr(line, '/')) {
+            r.anchored = 1;
+            if (line[0] == '/')
+                line++;
+        }
+        if (*line == '\0' || !(r.g = hsh_glob_compile(line, HSH_GLOB_PATHNAME)))
+            continue;
+
+        struct hsh_ign_rule *rules = realloc(ign->rules,
+                                             (size_t)(ign->nrules + 1) * sizeof(*rules));
+        if (!rules) {
+            hsh_glob_free(r.g);
+            return -1;
+        }
+        ign->rules = rules;
+        ign->rules[ign->nrules++] = r;
+    }
+    return 0;
+}
+
+/* dir/.gitignore (dir relative to dirfd) on top of parent, or parent
+ * itself when there is none */
+static struct hsh_ign *hsh_ign_load(struct hsh_find *f, int dirfd, const char *dir,
+                                    const char *path, struct hsh_ign *parent) {
+    char rel[4096];
+    if (snprintf(rel, sizeof(rel), "%s/.gitignore", dir) >= (int)sizeof(rel))
+        return parent;
+
+    int fd = openat(dirfd, rel, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0)
+        return parent;
+
+    struct stat st;
+    char *text = NULL;
+    struct hsh_ign *ign = NULL;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        (text = malloc((size_t)st.st_size + 1)) &&
+        (ign = calloc(1, sizeof(*ign)))) {
+        ssize_t got = read(fd, text, (size_t)st.st_size);
+        text[got > 0 ? got : 0] = '\0';
+        ign->parent = parent;
+        ign->relofs = hsh_find_relofs(path);
+        hsh_ign_parse(ign, text);
+    }
+    close(fd);
+    free(text);
+
+    if (!ign)
+        return parent;
+    if (ign->nrules == 0) {
+        free(ign->rules);
+        free(ign);
+        return parent;
+    }
+    pthread_mutex_lock(&f->ign_lock);
+    ign->next = f->igns;
+    f->igns = ign;
+    pthread_mutex_unlock(&f->ign_lock);
+    return ign;
+}
+
+/* deepest .gitignore first, last rule first: the first match decides */
+static int hsh_ign_match(const struct hsh_ign *ign, const struct hsh_walk_ent *e,
+                         int is_dir) {
+    size_t namelen = strlen(e->name);
+
+    for (; ign; ign = ign->parent) {
+        const char *rel = e->path + ign->relofs;
+        size_t rellen = e->pathlen - ign->relofs;
+
+        for (int i = ign->nrules - 1; i >= 0; i--) {
+            const struct hsh_ign_rule *r = &ign->rules[i];
+            if (r->dir_only && !is_dir)
+                continue;
+            if (r->anchored ? hsh_glob_match(r->g, rel, rellen)
+                            : hsh_glob_match(r->g, e->name, namelen))
+                return !r->neg;
+        }
+    }
+    return 0;
+}
+
+static int hsh_find_visit(struct hsh_walk_ent *e, void *arg) {
+    struct hsh_find *f = arg;
+    int is_dir = (e->type == DT_DIR);
+
+    if (!f->all) {
+        if (is_dir && strcmp(e->name, ".git") == 0)
+            return HSH_WALK_SKIP;
+        if (hsh_ign_match(e->dir_data, e, is_dir))
+            return HSH_WALK_SKIP;
+    }
+
+    int want = 1;
+    if (f->type == 'f')
+        want = (e->type == DT_REG);
+    else if (f->type == 'd')
+        want = is_dir;
+    else if (f->type == 'l')
+        want = (e->type == DT_LNK);
+
+    if (want && (f->glob || f->use_re)) {
+        const char *s = f->full ? e->path + f->relofs : e->name;
+        size_t n = f->full ? e->pathlen - f->relofs : strlen(e->name);
+        want = f->use_re ? regexec(&f->re, s, 0, NULL, 0) == 0
+                         : hsh_glob_match(f->glob, s, n);
+    }
+
+    /* a directory's .gitignore first: collect() may want it */
+    int descend = is_dir && !(f->maxdepth && e->depth >= f->maxdepth);
+    if (descend && !f->all)
+        e->child_data = hsh_ign_load(f, e->dirfd, e->name, e->path, e->dir_data);
+
+    if (want && f->collect) {
+        f->collect(e, f->collect_arg);
+        __atomic_add_fetch(&f->found, 1, __ATOMIC_RELAXED);
+    } else if (want) {
+        /* one locked fwrite per entry: lines from threads never mix */
+        char buf[4096];
+        if (e->pathlen < sizeof(buf)) {
+            memcpy(buf, e->path, e->pathlen);
+            buf[e->pathlen] = f->sep;
+            fwrite(buf, 1, e->pathlen + 1, stdout);
+        } else {
+            flockfile(stdout);
+            fwrite(e->path, 1, e->pathlen, stdout);
+            putc_unlocked(f->sep, stdout);
+            funlockfile(stdout);
+        }
+        __atomic_add_fetch(&f->found, 1, __ATOMIC_RELAXED);
+    }
+    return (is_dir && !descend) ? HSH_WALK_SKIP : HSH_WALK_CONTINUE;
+}
+
+/* f's .gitignore chain lives from hsh_find_begin() to hsh_find_end();
+ * fs watch walks new directories in between */
+static void hsh_find_begin(struct hsh_find *f, const char *root) {
+    f->relofs = hsh_find_relofs(root);
+    pthread_mutex_init(&f->ign_lock, NULL);
+}
+
+static void hsh_find_end(struct hsh_find *f) {
+    while (f->igns) {
+        struct hsh_ign *next = f->igns->next;
+        for (int i = 0; i < f->igns->nrules; i++)
+            hsh_glob_free(f->igns->rules[i].g);
+        free(f->igns->rules);
+        free(f->igns);
+        f->igns = next;
+    }
+    pthread_mutex_destroy(&f->ign_lock);
+}
+
+/* the rules for dir itself: its .gitignore on top of parent's */
+static struct hsh_ign *hsh_find_top(struct hsh_find *f, const char *dir,
+                                    struct hsh_ign *parent) {
+    return f->all ? NULL : hsh_ign_load(f, AT_FDCWD, dir, dir, parent);
+}
+
+/* walk root with f's filters, .gitignore chain included */
+static int hsh_find_walk(struct hsh_find *f, const char *root, int threads,
+                         const char *prefix) {
+    hsh_find_begin(f, root);
+    struct hsh_walk_ops ops = { hsh_find_visit, NULL, f, threads };
+    int errors = hsh_walk(root, hsh_find_top(f, root, NULL), &ops, prefix);
+    hsh_find_end(f);
+    return errors;
+}
+
+int hsh_fs_find(char **args) {
+    const char *root = NULL;
+    const char *pattern = NULL;
+    int threads = 0;
+    struct hsh_find f;
+
+    memset(&f, 0, sizeof(f));
+    f.sep = '\n';
+
+    for (int i = 2; args[i] != NULL; i++) {
+        if (strcmp(args[i], "-0") == 0) {
+            f.sep = '\0';
+        } else if (strcmp(args[i], "-a") == 0) {
+            f.all = 1;
+        } else if (strcmp(args[i], "-r") == 0) {
+            f.use_re = 1;
+        } else if (strcmp(args[i], "-d") == 0 && args[i + 1]) {
+            f.maxdepth = atoi(args[++i]);
+        } else if (strcmp(args[i], "-j") == 0 && args[i + 1]) {
+            threads = atoi(args[++i]);
+        } else if (strcmp(args[i], "-t") == 0 && args[i + 1] &&
+                   strchr("fdl", args[i + 1][0]) && args[i + 1][1] == '\0') {
+            f.type = args[++i][0];
+        } else if (args[i][0] != '-' && !root) {
+            root = args[i];
+        } else if (args[i][0] != '-' && !pattern) {
+            pattern = args[i];
+        } else {
+            fprintf(stderr, "fs find: usage: fs find [-0] [-a] [-r] [-t f|d|l] "
+                            "[-d DEPTH] [-j THREADS] [root] [pattern]\n");
+            return 0;
+        }
+    }
+    if (!root)
+        root = ".";
+
+    if (pattern) {
+        f.full = strchr(pattern, '/') != NULL;
+        if (f.use_re) {
+            int rc = regcomp(&f.re, pattern, REG_EXTENDED | REG_NOSUB);
+            if (rc != 0) {
+                char msg[128];
+                regerror(rc, &f.re, msg, sizeof(msg));
+                fprintf(stderr, "fs find: %s: %s\n", pattern, msg);
+                return 0;
+            }
+        } else if (!(f.glob = hsh_glob_compile(pattern, HSH_GLOB_PATHNAME))) {
+            fprintf(stderr, "fs find: %s: bad pattern\n", pattern);
+            return 0;
+        }
+    } else {
+        f.use_re = 0;
+    }
+    fflush(stdout);
+    int errors = hsh_find_walk(&f, root, threads, "fs find");
+    fflush(stdout);
+
+    hsh_glob_free(f.glob);
+    if (f.use_re)
+        regfree(&f.re);
+    return errors == 0;
+}
+
+/* ----- fs grep ----- */
+
+#define HSH_GREP_MMAP   (256 * 1024)   /* smaller files are read() */
+#define HSH_GREP_BINARY 8192           /* NUL in this much: binary */
+
+struct hsh_grep_out {
+    char  *p;
+    size_t n, cap;
+};
+
+/* one file; its output is printed once every file before it was */
+struct hsh_grep_file {
+    char  *path;
+    char  *out;
+    size_t outlen;
+    int    done;
+};
+
+struct hsh_grep_list {
+    char  **paths;
+    size_t  n, cap;
+};
+
+struct hsh_grep {
+    const char           *lit;
+    size_t                litlen;
+    regex_t               re;
+    int                   use_re;
+    int                   icase;      /* -i on a literal */
+    int                   count;      /* -c */
+    int                   list;       /* -l */
+    int                   lineno;     /* -n */
+    int                   prefix;     /* print "path:" (not for a lone file) */
+
+    struct hsh_grep_list  lists[HSH_WALK_MAX_THREADS];   /* per walk worker */
+    struct hsh_grep_file *files;
+    size_t                nfiles;
+    size_t                next_file;  /* atomic */
+    size_t                next_print; /* under lock */
+    pthread_mutex_t       lock;
+    long                  matched;    /* atomic: files with a match */
+    int                   errors;     /* atomic */
+};
+
+static int hsh_grep_put(struct hsh_grep_out *o, const char *s, size_t n) {
+    if (o->n + n > o->cap) {
+        size_t cap = o->cap ? o->cap : 4096;
+        while (cap < o->n + n)
+            cap *= 2;
+        char *p = realloc(o->p, cap);
+        if (!p)
+            return -1;
+        o->p = p;
+        o->cap = cap;
+    }
+    memcpy(o->p + o->n, s, n);
+    o->n += n;
+    return 0;
+}
+
+static void hsh_grep_collect(const struct hsh_walk_ent *e, void *arg) {
+    struct hsh_grep *gr = arg;
+    struct hsh_grep_list *l = &gr->lists[e->worker];
+
+    if (l->n == l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : 256;
+        char **paths = realloc(l->paths, cap * sizeof(*paths));
+        if (!paths) {
+            __atomic_add_fetch(&gr->errors, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        l->paths = paths;
+        l->cap = cap;
+    }
+    if ((l->paths[l->n] = strdup(e->path)))
+        l->n++;
+}
+
+/* first match in p[0..n): offset of its start, or -1 */
+static long hsh_grep_next(struct hsh_grep *gr, const char *p, size_t n) {
+    if (!gr->use_re) {
+        const char *m = gr->icase ? hsh_memcasemem(p, n, gr->lit, gr->litlen)
+                                  : hsh_memmem(p, n, gr->lit, gr->litlen);
+        return m ? m - p : -1;
+    }
+    regmatch_t rm[1];
+    rm[0].rm_so = 0;
+    rm[0].rm_eo = (regoff_t)n;
+    if (regexec(&gr->re, p, 1, rm, REG_STARTEND) != 0)
+        return -1;
+    return rm[0].rm_so;
+}
+
+static void hsh_grep_buf(struct hsh_grep *gr, const char *path,
+                         const char *data, size_t n, struct hsh_grep_out *o) {
+    int binary = memchr(data, '\0', n < HSH_GREP_BINARY ? n : HSH_GREP_BINARY) != NULL;
+    size_t pathlen = strlen(path);
+    const char *end = data + n;
+    const char *p = data;
+    const char *counted = data;   /* lines before here are in line */
+    long line = 1;
+    long count = 0;
+
+    while (p < end) {
+        long off = hsh_grep_next(gr, p, (size_t)(end - p));
+        if (off < 0)
+            break;
+        const char *m = p + off;
+        const char *bol = memrchr(p, '\n', (size_t)off);
+        bol = bol ? bol + 1 : p;
+        const char *eol = memchr(m, '\n', (size_t)(end - m));
+        if (!eol)
+            eol = end;
+
+        count++;
+        if (gr->list || (binary && !gr->count))
+            break;
+        if (!gr->count) {
+            char num[24];
+            if (gr->prefix) {
+                hsh_grep_put(o, path, pathlen);
+                hsh_grep_put(o, ":", 1);
+            }
+            if (gr->lineno) {
+                for (const char *q = counted;
+                     (q = memchr(q, '\n', (size_t)(bol - q))); q++)
+                    line++;
+                counted = bol;
+                hsh_grep_put(o, num, (size_t)snprintf(num, sizeof(num), "%ld:", line));
+            }
+            hsh_grep_put(o, bol, (size_t)(eol - bol));
+            hsh_grep_put(o, "\n", 1);
+        }
+        p = eol + 1;
+    }
+
+    if (count == 0)
+        return;
+    __atomic_add_fetch(&gr->matched, 1, __ATOMIC_RELAXED);
+    if (gr->count) {
+        char num[24];
+        if (gr->prefix) {
+            hsh_grep_put(o, path, pathlen);
+            hsh_grep_put(o, ":", 1);
+        }
+        hsh_grep_put(o, num, (size_t)snprintf(num, sizeof(num), "%ld\n", count));
+    } else if (gr->list) {
+        hsh_grep_put(o, path, pathlen);
+        hsh_grep_put(o, "\n", 1);
+    } else if (binary) {
+        hsh_grep_put(o, path, pathlen);
+        hsh_grep_put(o, ": binary file matches\n", 22);
+    }
+}
+
+/* big files are mapped; small ones go through the worker's buffer */
+static void hsh_grep_file(struct hsh_grep *gr, const char *path,
+                          struct hsh_grep_out *o, char **buf, size_t *bufcap) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "fs grep: %s: %s\n", path, strerror(errno));
+        __atomic_add_fetch(&gr->errors, 1, __ATOMIC_RELAXED);
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    size_t size = (size_t)st.st_size;
+
+    if (size >= HSH_GREP_MMAP) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "fs grep: %s: %s\n", path, strerror(errno));
+            __atomic_add_fetch(&gr->errors, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+        hsh_grep_buf(gr, path, map, size, o);
+        munmap(map, size);
+        return;
+    }
+
+    if (size + 1 > *bufcap) {
+        char *p = realloc(*buf, size + 1);
+        if (!p) {
+            close(fd);
+            __atomic_add_fetch(&gr->errors, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        *buf = p;
+        *bufcap = size + 1;
+    }
+    size_t got = 0;
+    while (got < size) {
+        ssize_t r = read(fd, *buf + got, size - got);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+        got += (size_t)r;
+    }
+    close(fd);
+    hsh_grep_buf(gr, path, *buf, got, o);
+}
+
+static void *hsh_grep_worker(void *arg) {
+    struct hsh_grep *gr = arg;
+    struct hsh_grep_out o = { NULL, 0, 0 };
+    char *buf = NULL;
+    size_t bufcap = 0;
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(&gr->next_file, 1, __ATOMIC_RELAXED);
+        if (i >= gr->nfiles)
+            break;
+
+        struct hsh_grep_file *f = &gr->files[i];
+        o.n = 0;
+        hsh_grep_file(gr, f->path, &o, &buf, &bufcap);
+
+        /* hand the output over, then print whatever is next in order */
+        pthread_mutex_lock(&gr->lock);
+        if (o.n > 0) {
+            f->out = o.p;
+            f->outlen = o.n;
+            o.p = NULL;
+            o.cap = 0;
+        }
+        f->done = 1;
+        while (gr->next_print < gr->nfiles && gr->files[gr->next_print].done) {
+            struct hsh_grep_file *pf = &gr->files[gr->next_print++];
+            if (pf->outlen)
+                fwrite(pf->out, 1, pf->outlen, stdout);
+            free(pf->out);
+            pf->out = NULL;
+        }
+        pthread_mutex_unlock(&gr->lock);
+    }
+    free(o.p);
+    free(buf);
+    return NULL;
+}
+
+static int hsh_grep_cmp(const void *a, const void *b) {
+    return strcmp(((const struct hsh_grep_file *)a)->path,
+                  ((const struct hsh_grep_file *)b)->path);
+}
+
+int hsh_fs_grep(char **args) {
+    const char *pattern = NULL;
+    const char *root = NULL;
+    int icase = 0;
+    int threads = 0;
+    struct hsh_find f;
+    struct hsh_grep *gr = calloc(1, sizeof(*gr));
+
+    if (!gr) {
+        perror("fs grep");
+        return 0;
+    }
+    memset(&f, 0, sizeof(f));
+    for (int i = 2; args[i] != NULL; i++) {
+        if (strcmp(args[i], "-i") == 0) {
+            icase = 1;
+        } else if (strcmp(args[i], "-r") == 0) {
+            gr->use_re = 1;
+        } else if (strcmp(args[i], "-n") == 0) {
+            gr->lineno = 1;
+        } else if (strcmp(args[i], "-c") == 0) {
+            gr->count = 1;
+        } else if (strcmp(args[i], "-l") == 0) {
+            gr->list = 1;
+        } else if (strcmp(args[i], "-a") == 0) {
+            f.all = 1;
+        } else if (strcmp(args[i], "-j") == 0 && args[i + 1]) {
+            threads = atoi(args[++i]);
+        } else if (!pattern && strcmp(args[i], "--") == 0 && args[i + 1]) {
+            pattern = args[++i];
+        } else if (!pattern && args[i][0] != '-') {
+            pattern = args[i];
+        } else if (pattern && !root && args[i][0] != '-') {
+            root = args[i];
+        } else {
+            pattern = NULL;
+            break;
+        }
+    }
+    if (!pattern || !*pattern) {
+        fprintf(stderr, "fs grep: usage: fs grep [-i] [-r] [-n] [-c] [-l] [-a] "
+                        "[-j THREADS] pattern [path]\n");
+        free(gr);
+        return 0;
+    }
+    if (!root)
+        root = ".";
+
+    /* -i on a literal folds ASCII case in the scan itself */
+    gr->icase = icase && !gr->use_re;
+    if (gr->use_re) {
+        int rc = regcomp(&gr->re, pattern,
+                         REG_EXTENDED | REG_NEWLINE | (icase ? REG_ICASE : 0));
+        if (rc != 0) {
+            char msg[128];
+            regerror(rc, &gr->re, msg, sizeof(msg));
+            fprintf(stderr, "fs grep: %s: %s\n", pattern, msg);
+            free(gr);
+            return 0;
+        }
+    }
+    gr->lit = pattern;
+    gr->litlen = strlen(pattern);
+    pthread_mutex_init(&gr->lock, NULL);
+
+    struct stat st;
+    if (stat(root, &st) != 0) {
+        fprintf(stderr, "fs grep: %s: %s\n", root, strerror(errno));
+        gr->errors++;
+    } else if (!S_ISDIR(st.st_mode)) {
+        gr->files = calloc(1, sizeof(*gr->files));
+        if (gr->files && (gr->files[0].path = strdup(root)))
+            gr->nfiles = 1;
+    } else {
+        f.type = 'f';
+        f.collect = hsh_grep_collect;
+        f.collect_arg = gr;
+        if (hsh_find_walk(&f, root, threads, "fs grep") != 0)
+            gr->errors++;
+
+        size_t total = 0;
+        for (int k = 0; k < HSH_WALK_MAX_THREADS; k++)
+            total += gr->lists[k].n;
+        gr->files = calloc(total ? total : 1, sizeof(*gr->files));
+        for (int k = 0; k < HSH_WALK_MAX_THREADS; k++) {
+            for (size_t j = 0; j < gr->lists[k].n; j++) {
+                if (gr->files)
+                    gr->files[gr->nfiles++].path = gr->lists[k].paths[j];
+                else
+                    free(gr->lists[k].paths[j]);
+            }
+            free(gr->lists[k].paths);
+        }
+        qsort(gr->files, gr->nfiles, sizeof(*gr->files), hsh_grep_cmp);
+        gr->prefix = 1;
+    }
+
+    /* the caller searches too */
+    int nthreads = threads > 0 ? threads : hsh_walk_threads();
+    if (nthreads > HSH_WALK_MAX_THREADS)
+        nthreads = HSH_WALK_MAX_THREADS;
+    if ((size_t)nthreads > gr->nfiles)
+        nthreads = gr->nfiles > 0 ? (int)gr->nfiles : 1;
+
+    fflush(stdout);
+    pthread_t tids[HSH_WALK_MAX_THREADS];
+    int started = 1;
+    for (; started < nthreads; started++)
+        if (pthread_create(&tids[started], NULL, hsh_grep_worker, gr) != 0)
+            break;
+    hsh_grep_worker(gr);
+    for (int k = 1; k < started; k++)
+        pthread_join(tids[k], NULL);
+    fflush(stdout);
+
+    for (size_t k = 0; k < gr->nfiles; k++)
+        free(gr->files[k].path);
+    free(gr->files);
+    if (gr->use_re)
+        regfree(&gr->re);
+    pthread_mutex_destroy(&gr->lock);
+
+    int ok = gr->matched > 0;
+    free(gr);
+    return ok;
+}
+
+/* ----- fs cp, fs sync ----- */
+
+/* per walk worker: its ring and the small files waiting for a batch */
+struct hsh_cp_worker {
+    struct hsh_uring   *ring;
+    int                 no_ring;
+    char               *buf;
+    int                 n;
+    struct hsh_copy_job jobs[HSH_COPY_BATCH];
+};
+
+struct hsh_cp {
+    const char          *dst;
+    size_t               relofs;
+    int                  sync;     /* skip files whose size and mtime match */
+    const char          *prefix;   /* "fs cp" or "fs sync" */
+
+    struct hsh_cp_worker w[HSH_WALK_MAX_THREADS];
+    long                 files;    /* atomic */
+    long                 skipped;  /* atomic */
+    long long            bytes;    /* atomic */
+    int                  errors;   /* atomic */
+
+    int                  done;     /* under lock: ends the progress thread */
+    pthread_mutex_t      lock;
+    pthread_cond_t       cond;
+};
+
+static void hsh_cp_error(struct hsh_cp *cp, const char *path, int err) {
+    fprintf(stderr, "%s: %s: %s\n", cp->prefix, path, strerror(err));
+    __atomic_add_fetch(&cp->errors, 1, __ATOMIC_RELAXED);
+}
+
+static void hsh_cp_flush(struct hsh_cp *cp, struct hsh_cp_worker *w) {
+    if (w->n == 0)
+        return;
+    long long n = hsh_copy_batch(w->ring, w->jobs, w->n, w->buf);
+    for (int i = 0; i < w->n; i++) {
+        if (w->jobs[i].err)
+            hsh_cp_error(cp, w->jobs[i].src, w->jobs[i].err);
+        else
+            __atomic_add_fetch(&cp->files, 1, __ATOMIC_RELAXED);
+        free((char *)w->jobs[i].src);
+        free((char *)w->jobs[i].dst);
+    }
+    __atomic_add_fetch(&cp->bytes, n, __ATOMIC_RELAXED);
+    w->n = 0;
+}
+
+/* small files wait for a batch; a worker without ring or buffer copies
+ * them one by one, like the big ones */
+static void hsh_cp_small(struct hsh_cp *cp, struct hsh_cp_worker *w,
+                         const char *src, const char *dst,
+                         const struct statx *stx) {
+    if (!w->buf && !w->no_ring) {
+        w->ring = hsh_uring_open(2 * HSH_COPY_BATCH);
+        w->buf = malloc((size_t)HSH_COPY_BATCH * HSH_COPY_SMALL);
+        w->no_ring = !w->ring || !w->buf;
+    }
+
+    struct hsh_copy_job *j = &w->jobs[w->n];
+    j->src = strdup(src);
+    j->dst = strdup(dst);
+    j->size = (size_t)stx->stx_size;
+    j->mode = stx->stx_mode;
+    j->mtime.tv_sec = stx->stx_mtime.tv_sec;
+    j->mtime.tv_nsec = stx->stx_mtime.tv_nsec;
+    if (!j->src || !j->dst) {
+        free((char *)j->src);
+        free((char *)j->dst);
+        hsh_cp_error(cp, src, ENOMEM);
+        return;
+    }
+    w->n++;
+    if (w->n == HSH_COPY_BATCH || w->no_ring)
+        hsh_cp_flush(cp, w);
+}
+
+static void hsh_cp_link(struct hsh_cp *cp, struct hsh_walk_ent *e, const char *dst) {
+    char target[4096], old[4096];
+    ssize_t n = readlinkat(e->dirfd, e->name, target, sizeof(target) - 1);
+    if (n < 0) {
+        hsh_cp_error(cp, e->path, errno);
+        return;
+    }
+    target[n] = '\0';
+
+    if (cp->sync) {
+        ssize_t m = readlink(dst, old, sizeof(old) - 1);
+        if (m == n && memcmp(old, target, (size_t)n) == 0) {
+            __atomic_add_fetch(&cp->skipped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    if (symlink(target, dst) < 0 &&
+        (errno != EEXIST || unlink(dst) < 0 || symlink(target, dst) < 0)) {
+        hsh_cp_error(cp, dst, errno);
+        return;
+    }
+    __atomic_add_fetch(&cp->files, 1, __ATOMIC_RELAXED);
+}
+
+static int hsh_cp_visit(struct hsh_walk_ent *e, void *arg) {
+    struct hsh_cp *cp = arg;
+    const char *rel = e->path + cp->relofs;
+    char dst[4096];
+
+    if (snprintf(dst, sizeof(dst), "%s/%s", cp->dst, rel) >= (int)sizeof(dst)) {
+        hsh_cp_error(cp, e->path, ENAMETOOLONG);
+        return HSH_WALK_SKIP;
+    }
+
+    if (e->type == DT_DIR) {
+        /* before any of its entries: they are visited once it's read */
+        if (mkdir(dst, 0777) < 0 && errno != EEXIST) {
+            hsh_cp_error(cp, dst, errno);
+            return HSH_WALK_SKIP;
+        }
+        return HSH_WALK_CONTINUE;
+    }
+    if (e->type == DT_LNK) {
+        hsh_cp_link(cp, e, dst);
+        return HSH_WALK_CONTINUE;
+    }
+    if (e->type != DT_REG) {
+        fprintf(stderr, "%s: %s: not a regular file, skipped\n", cp->prefix, e->path);
+        return HSH_WALK_CONTINUE;
+    }
+
+    struct statx stx, old;
+    if (statx(e->dirfd, e->name, AT_SYMLINK_NOFOLLOW,
+              STATX_MODE | STATX_SIZE | STATX_MTIME, &stx) != 0) {
+        hsh_cp_error(cp, e->path, errno);
+        return HSH_WALK_CONTINUE;
+    }
+    if (cp->sync &&
+        statx(AT_FDCWD, dst, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_SIZE | STATX_MTIME,
+              &old) == 0 &&
+        S_ISREG(old.stx_mode) && old.stx_size == stx.stx_size &&
+        old.stx_mtime.tv_sec == stx.stx_mtime.tv_sec &&
+        old.stx_mtime.tv_nsec == stx.stx_mtime.tv_nsec) {
+        __atomic_add_fetch(&cp->skipped, 1, __ATOMIC_RELAXED);
+        return HSH_WALK_CONTINUE;
+    }
+
+    if (stx.stx_size <= HSH_COPY_SMALL) {
+        hsh_cp_small(cp, &cp->w[e->worker], e->path, dst, &stx);
+        return HSH_WALK_CONTINUE;
+    }
+
+    /* big files: copy_file_range right here, on this walk thread */
+    struct timespec mtime = { stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec };
+    long long n = hsh_copy_file(e->path, dst, stx.stx_mode, &mtime);
+    if (n < 0) {
+        hsh_cp_error(cp, e->path, errno);
+        return HSH_WALK_CONTINUE;
+    }
+    __atomic_add_fetch(&cp->files, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cp->bytes, n, __ATOMIC_RELAXED);
+    return HSH_WALK_CONTINUE;
+}
+
+static double hsh_cp_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* a status line on a terminal's stderr: totals, and the rate over the
+ * last couple of seconds (an exponential average of 250 ms samples) */
+static void *hsh_cp_progress(void *arg) {
+    struct hsh_cp *cp = arg;
+    double start = hsh_cp_now(), last = start, rate = 0;
+    long long last_bytes = 0;
+    char total[16], speed[16];
+
+    pthread_mutex_lock(&cp->lock);
+    while (!cp->done) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 250000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&cp->cond, &cp->lock, &ts);
+        if (cp->done)
+            break;
+
+        double now = hsh_cp_now();
+        long long bytes = __atomic_load_n(&cp->bytes, __ATOMIC_RELAXED);
+        double sample = (double)(bytes - last_bytes) / (now - last);
+        rate = (last == start) ? sample : 0.8 * rate + 0.2 * sample;
+        last = now;
+        last_bytes = bytes;
+
+        hsh_fs_human(total, sizeof(total), bytes);
+        hsh_fs_human(speed, sizeof(speed), (long long)rate);
+        fprintf(stderr, "\r%s: %ld files, %s, %s/s", cp->prefix,
+                __atomic_load_n(&cp->files, __ATOMIC_RELAXED), total, speed);
+        if (cp->sync)
+            fprintf(stderr, ", %ld unchanged",
+                    __atomic_load_n(&cp->skipped, __ATOMIC_RELAXED));
+        fputs("   ", stderr);
+    }
+    pthread_mutex_unlock(&cp->lock);
+
+    double secs = hsh_cp_now() - start;
+    hsh_fs_human(total, sizeof(total), cp->bytes);
+    hsh_fs_human(speed, sizeof(speed), (long long)((double)cp->bytes / (secs > 0 ? secs : 1)));
+    fprintf(stderr, "\r%s: %ld files, %s in %.1fs (%s/s)", cp->prefix,
+            cp->files, total, secs, speed);
+    if (cp->sync)
+        fprintf(stderr, ", %ld unchanged", cp->skipped);
+    fputs("   \n", stderr);
+    return NULL;
+}
+
+/* fs cp [-r] [-q] [-j N] src dst; fs sync [-q] [-j N] src dst */
+static int hsh_fs_copy(char **args, int sync) {
+    const char *prefix = sync ? "fs sync" : "fs cp";
+    const char *src = NULL, *dst = NULL;
+    int recursive = sync, quiet = 0, threads = 0;
+
+    for (int i = 2; args[i] != NULL; i++) {
+        if (!sync && strcmp(args[i], "-r") == 0) {
+            recursive = 1;
+        } else if (strcmp(args[i], "-q") == 0) {
+            quiet = 1;
+        } else if (strcmp(args[i], "-j") == 0 && args[i + 1]) {
+            threads = atoi(args[++i]);
+        } else if (args[i][0] != '-' && !src) {
+            src = args[i];
+        } else if (args[i][0] != '-' && !dst) {
+            dst = args[i];
+        } else {
+            src = NULL;
+            break;
+        }
+    }
+    if (!src || !dst) {
+        if (sync)
+            fprintf(stderr, "fs sync: usage: fs sync [-q] [-j THREADS] src dst\n");
+        else
+            fprintf(stderr, "fs cp: usage: fs cp [-r] [-q] [-j THREADS] src dst\n");
+        return 0;
+    }
+
+    struct stat st, dst_st;
+    if (stat(src, &st) != 0) {
+        fprintf(stderr, "%s: %s: %s\n", prefix, src, strerror(errno));
+        return 0;
+    }
+    int dst_dir = stat(dst, &dst_st) == 0 && S_ISDIR(dst_st.st_mode);
+
+    /* like cp: into an existing directory, under src's name (fs sync
+     * always makes dst itself the copy) */
+    char into[4096];
+    if (dst_dir && !sync) {
+        char *tmp = strdup(src);
+        if (!tmp) {
+            perror(prefix);
+            return 0;
+        }
+        size_t n = strlen(tmp);
+        while (n > 1 && tmp[n - 1] == '/')
+            tmp[--n] = '\0';
+        snprintf(into, sizeof(into), "%s/%s", dst, basename(tmp));
+        free(tmp);
+        dst = into;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        struct timespec mtime = st.st_mtim;
+        if (hsh_copy_file(src, dst, st.st_mode, &mtime) < 0) {
+            fprintf(stderr, "%s: %s: %s\n", prefix, dst, strerror(errno));
+            return 0;
+        }
+        return 1;
+    }
+    if (!recursive) {
+        fprintf(stderr, "fs cp: %s: is a directory (use -r)\n", src);
+        return 0;
+    }
+    if (mkdir(dst, 0777) < 0 && errno != EEXIST) {
+        fprintf(stderr, "%s: %s: %s\n", prefix, dst, strerror(errno));
+        return 0;
+    }
+
+    /* a copy inside its own source would be walked as it grows */
+    char *rsrc = realpath(src, NULL), *rdst = realpath(dst, NULL);
+    int inside = rsrc && rdst && strncmp(rdst, rsrc, strlen(rsrc)) == 0 &&
+                 (rdst[strlen(rsrc)] == '/' || rdst[strlen(rsrc)] == '\0' ||
+                  strcmp(rsrc, "/") == 0);
+    free(rsrc);
+    free(rdst);
+    if (inside) {
+        fprintf(stderr, "%s: can't copy %s into itself (%s)\n", prefix, src, dst);
+        return 0;
+    }
+
+    struct hsh_cp *cp = calloc(1, sizeof(*cp));
+    if (!cp) {
+        perror(prefix);
+        return 0;
+    }
+    cp->dst = dst;
+    cp->relofs = hsh_find_relofs(src);
+    cp->sync = sync;
+    cp->prefix = prefix;
+    pthread_mutex_init(&cp->lock, NULL);
+    pthread_cond_init(&cp->cond, NULL);
+
+    pthread_t progress;
+    int show = !quiet && isatty(STDERR_FILENO) &&
+               pthread_create(&progress, NULL, hsh_cp_progress, cp) == 0;
+
+    struct hsh_walk_ops ops = { hsh_cp_visit, NULL, cp, threads };
+    int errors = hsh_walk(src, NULL, &ops, prefix);
+    if (errors < 0)
+        errors = 1;
+
+    /* what's left in each worker's batch, then the rings */
+    for (int k = 0; k < HSH_WALK_MAX_THREADS; k++) {
+        hsh_cp_flush(cp, &cp->w[k]);
+        hsh_uring_close(cp->w[k].ring);
+        free(cp->w[k].buf);
+    }
+
+    if (show) {
+        pthread_mutex_lock(&cp->lock);
+        cp->done = 1;
+        pthread_cond_signal(&cp->cond);
+        pthread_mutex_unlock(&cp->lock);
+        pthread_join(progress, NULL);
+    }
+    errors += cp->errors;
+    pthread_mutex_destroy(&cp->lock);
+    pthread_cond_destroy(&cp->cond);
+    free(cp);
+    return errors == 0;
+}
+
+int hsh_fs_cp(char **args) {
+    return hsh_fs_copy(args, 0);
+}
+
+int hsh_fs_sync(char **args) {
+    return hsh_fs_copy(args, 1);
+}
+
+/* ----- fs watch ----- */
+
+#define HSH_WATCH_MASK (IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | \
+                        IN_MOVED_FROM | IN_MOVED_TO | IN_DONT_FOLLOW | IN_ONLYDIR)
+
+/* one watched directory, indexed by its watch descriptor */
+struct hsh_watch_dir {
+    char           *path;      /* NULL: free slot */
+    struct hsh_ign *ign;       /* its .gitignore chain, for its entries */
+};
+
+struct hsh_watch {
+    int                   fd;         /* inotify */
+    struct hsh_find       f;          /* which directories and names count */
+    pthread_mutex_t       lock;       /* dirs, added from walk threads */
+    struct hsh_watch_dir *dirs;
+    int                   cap;
+    int                   nwatched;
+    int                   full;       /* out of watches: said so once */
+
+    char                **changed;    /* this burst's paths */
+    size_t                nchanged, capchanged;
+};
+
+static volatile sig_atomic_t hsh_watch_stop = 0;
+
+static void hsh_watch_sigint(int sig) {
+    (void)sig;
+    hsh_watch_stop = 1;
+}
+
+static void hsh_watch_add(struct hsh_watch *w, const char *path, struct hsh_ign *ign) {
+    int wd = inotify_add_watch(w->fd, path, HSH_WATCH_MASK);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            if (!__atomic_exchange_n(&w->full, 1, __ATOMIC_RELAXED))
+                fprintf(stderr, "fs watch: out of inotify watches "
+                                "(/proc/sys/fs/inotify/max_user_watches)\n");
+        } else if (errno != ENOENT) {
+            fprintf(stderr, "fs watch: %s: %s\n", path, strerror(errno));
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    if (wd >= w->cap) {
+        int cap = w->cap ? w->cap : 64;
+        while (cap <= wd)
+            cap *= 2;
+        struct hsh_watch_dir *dirs = realloc(w->dirs, (size_t)cap * sizeof(*dirs));
+        if (!dirs) {
+            pthread_mutex_unlock(&w->lock);
+            inotify_rm_watch(w->fd, wd);
+            return;
+        }
+        memset(dirs + w->cap, 0, (size_t)(cap - w->cap) * sizeof(*dirs));
+        w->dirs = dirs;
+        w->cap = cap;
+    }
+    if (w->dirs[wd].path)
+        free(w->dirs[wd].path);    /* same directory, seen again */
+    else
+        w->nwatched++;
+    w->dirs[wd].path = strdup(path);
+    w->dirs[wd].ign = ign;
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void hsh_watch_collect(const struct hsh_walk_ent *e, void *arg) {
+    hsh_watch_add(arg, e->path, e->child_data);
+}
+
+/* dir and every directory below it that fs find would enter */
+static void hsh_watch_tree(struct hsh_watch *w, const char *dir, struct hsh_ign *parent) {
+    struct hsh_ign *ign = hsh_find_top(&w->f, dir, parent);
+    hsh_watch_add(w, dir, ign);
+
+    struct hsh_walk_ops ops = { hsh_find_visit, NULL, &w->f, 0 };
+    hsh_walk(dir, ign, &ops, "fs watch");
+}
+
+static void hsh_watch_note(struct hsh_watch *w, const char *path) {
+    if (w->nchanged == w->capchanged) {
+        size_t cap = w->capchanged ? w->capchanged * 2 : 64;
+        char **p = realloc(w->changed, cap * sizeof(*p));
+        if (!p)
+            return;
+        w->changed = p;
+        w->capchanged = cap;
+    }
+    if ((w->changed[w->nchanged] = strdup(path)))
+        w->nchanged++;
+}
+
+/* a directory moved away: its watches (and those below it) now point
+ * at the old paths; its new name, if watched, gets fresh ones */
+static void hsh_watch_forget(struct hsh_watch *w, const char *path) {
+    size_t n = strlen(path);
+    for (int wd = 0; wd < w->cap; wd++) {
+        const char *p = w->dirs[wd].path;
+        if (p && strncmp(p, path, n) == 0 && (p[n] == '\0' || p[n] == '/'))
+            inotify_rm_watch(w->fd, wd);    /* IN_IGNORED frees the slot */
+    }
+}
+
+static void hsh_watch_event(struct hsh_watch *w, const struct inotify_event *ev) {
+    if (ev->mask & IN_Q_OVERFLOW) {
+        fprintf(stderr, "fs watch: event queue overflowed, changes were lost\n");
+        return;
+    }
+    if (ev->wd < 0 || ev->wd >= w->cap || !w->dirs[ev->wd].path)
+        return;
+
+    struct hsh_watch_dir *d = &w->dirs[ev->wd];
+    if (ev->mask & IN_IGNORED) {
+        free(d->path);
+        d->path = NULL;
+        w->nwatched--;
+        return;
+    }
+    if (ev->len == 0)
+        return;
+
+    char path[4096];
+    int len = snprintf(path, sizeof(path), "%s/%s", d->path, ev->name);
+    if (len < 0 || len >= (int)sizeof(path))
+        return;
+
+    int is_dir = (ev->mask & IN_ISDIR) != 0;
+    if (!w->f.all) {
+        struct hsh_walk_ent e;
+        memset(&e, 0, sizeof(e));
+        e.name = ev->name;
+        e.path = path;
+        e.pathlen = (size_t)len;
+        if ((is_dir && strcmp(ev->name, ".git") == 0) ||
+            hsh_ign_match(d->ign, &e, is_dir))
+            return;
+    }
+
+    if (is_dir && (ev->mask & IN_MOVED_FROM))
+        hsh_watch_forget(w, path);
+    if (is_dir && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+        hsh_watch_tree(w, path, d->ign);
+    hsh_watch_note(w, path);
+}
+
+/* everything queued right now; 0 once the queue is empty, -1 on error */
+static int hsh_watch_drain(struct hsh_watch *w) {
+    char buf[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t n = read(w->fd, buf, sizeof(buf));
+        if (n < 0)
+            return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            hsh_watch_event(w, ev);
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+}
+
+static int hsh_watch_cmp(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* fs watch [-a] [-1] [-d MS] [path] [-- command ...] */
+int hsh_fs_watch(char **args) {
+    const char *root = NULL;
+    char **cmd = NULL;
+    int debounce = 200, once = 0;
+    struct hsh_watch w;
+
+    memset(&w, 0, sizeof(w));
+    for (int i = 2; args[i] != NULL; i++) {
+        if (strcmp(args[i], "--") == 0) {
+            cmd = &args[i + 1];
+            break;
+        } else if (strcmp(args[i], "-a") == 0) {
+            w.f.all = 1;
+        } else if (strcmp(args[i], "-1") == 0) {
+            once = 1;
+        } else if (strcmp(args[i], "-d") == 0 && args[i + 1]) {
+            debounce = atoi(args[++i]);
+        } else if (args[i][0] != '-' && !root) {
+            root = args[i];
+        } else {
+            fprintf(stderr, "fs watch: usage: fs watch [-a] [-1] [-d MS] "
+                            "[path] [-- command ...]\n");
+            return 0;
+        }
+    }
+    if (!root)
+        root = ".";
+    if (cmd && !cmd[0])
+        cmd = NULL;
+    if (debounce < 0)
+        debounce = 0;
+
+    struct stat st;
+    if (stat(root, &st) != 0) {
+        fprintf(stderr, "fs watch: %s: %s\n", root, strerror(errno));
+        return 0;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "fs watch: %s: not a directory\n", root);
+        return 0;
+    }
+
+    w.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w.fd < 0) {
+        perror("fs watch: inotify_init1");
+        return 0;
+    }
+    w.f.type = 'd';
+    w.f.collect = hsh_watch_collect;
+    w.f.collect_arg = &w;
+    pthread_mutex_init(&w.lock, NULL);
+    hsh_find_begin(&w.f, root);
+    hsh_watch_tree(&w, root, NULL);
+
+    /* Ctrl-C ends the watch (not the shell, nor a script) */
+    struct sigaction sa, old_sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = hsh_watch_sigint;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_sa);
+    hsh_watch_stop = 0;
+
+    int ok = w.nwatched > 0;
+    if (!ok)
+        fprintf(stderr, "fs watch: %s: nothing to watch\n", root);
+
+    while (ok && !hsh_watch_stop && w.nwatched > 0) {
+        struct pollfd pfd = { w.fd, POLLIN, 0 };
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("fs watch: poll");
+            ok = 0;
+            break;
+        }
+
+        /* a burst ends after debounce ms without events */
+        do {
+            if (hsh_watch_drain(&w) < 0) {
+                perror("fs watch: read");
+                ok = 0;
+                break;
+            }
+        } while (!hsh_watch_stop && poll(&pfd, 1, debounce) > 0);
+        if (!ok || hsh_watch_stop || w.nchanged == 0)
+            continue;
+
+        /* each path once, in order */
+        qsort(w.changed, w.nchanged, sizeof(*w.changed), hsh_watch_cmp);
+        size_t n = 0, total = 0;
+        for (size_t i = 0; i < w.nchanged; i++) {
+            if (n > 0 && strcmp(w.changed[n - 1], w.changed[i]) == 0) {
+                free(w.changed[i]);
+                continue;
+            }
+            w.changed[n++] = w.changed[i];
+            total += strlen(w.changed[i]) + 1;
+        }
+        w.nchanged = n;
+
+        if (!cmd) {
+            for (size_t i = 0; i < n; i++)
+                printf("%s\n", w.changed[i]);
+            fflush(stdout);
+        } else {
+            /* HSH_CHANGED has the paths one per line; a "{}" word in the
+             * command becomes the paths themselves */
+            size_t cmdlen = 1;
+            for (char **a = cmd; *a; a++)
+                cmdlen += strlen(*a) + 1 + (strcmp(*a, "{}") == 0 ? total : 0);
+            char *list = malloc(total + 1);
+            char *line = malloc(cmdlen);
+            if (!list || !line) {
+                free(list);
+                free(line);
+                perror("fs watch");
+                ok = 0;
+                break;
+            }
+            char *p = list;
+            for (size_t i = 0; i < n; i++)
+                p += sprintf(p, i ? "\n%s" : "%s", w.changed[i]);
+            hsh_var_set("HSH_CHANGED", list, 1);
+
+            p = line;
+            for (char **a = cmd; *a; a++) {
+                if (strcmp(*a, "{}") != 0) {
+                    p += sprintf(p, "%s ", *a);
+                    continue;
+                }
+                for (size_t i = 0; i < n; i++)
+                    p += sprintf(p, "%s ", w.changed[i]);
+            }
+            *p = '\0';
+
+            int status = 0;
+            int keep = hsh_run_line(line, &status);
+            free(line);
+            free(list);
+            if (!keep)
+                hsh_watch_stop = 1;
+            if (once)
+                ok = (status == 0);
+        }
+
+        for (size_t i = 0; i < w.nchanged; i++)
+            free(w.changed[i]);
+        w.nchanged = 0;
+        if (once)
+            break;
+    }
+
+    sigaction(SIGINT, &old_sa, NULL);
+    hsh_var_unset("HSH_CHANGED");
+    for (size_t i = 0; i < w.nchanged; i++)
+        free(w.changed[i]);
+    free(w.changed);
+    for (int wd = 0; wd < w.cap; wd++)
+        free(w.dirs[wd].path);
+    free(w.dirs);
+    close(w.fd);
+    hsh_find_end(&w.f);
+    pthread_mutex_destroy(&w.lock);
+    return ok;
+}
@@ -0,0 +1,53 @@
+#ifndef HSH_FS_H
+#define HSH_FS_H
+
+/* Native `fs` subcommands, run by hsh_builtin_fs(). args[0] is "fs",
+ * args[1] the subcommand. Each returns 1 ("keep running") when it
+ * succeeded, 0 otherwise, like the builtins.
+ */
+
+/* fs du [-n N] [-j THREADS] [-b] [path]: total disk usage of path and
+ * its N heaviest directories, from a parallel walk (walk.h) */
+int hsh_fs_du(char **args);
+
+/* fs find [-0] [-a] [-r] [-t f|d|l] [-d DEPTH] [-j THREADS] [root] [pattern]:
+ * paths below root whose name (whole root-relative path if pattern has
+ * a '/') matches the glob, or the extended regex with -r. .gitignore
+ * files and .git are honored unless -a. Results are printed as found,
+ * NUL-terminated with -0.
+ */
+int hsh_fs_find(char **args);
+
+/* fs grep [-i] [-r] [-n] [-c] [-l] [-a] [-j THREADS] pattern [path]:
+ * lines containing pattern (an extended regex with -r) in the files
+ * fs find would list, searched by a thread pool and printed in path
+ * order. -c counts and -l lists matching files instead. Fails (status
+ * 1) when nothing matched.
+ */
+int hsh_fs_grep(char **args);
+
+/* fs cp [-r] [-q] [-j THREADS] src dst: copy a file, or with -r a tree,
+ * like cp -r (into dst/src's name if dst is a directory). The walk's
+ * threads copy as they go: big files with copy_file_range, small ones in
+ * io_uring batches (copy.h). Copies keep their source's mtime, so a later
+ * fs sync can tell them unchanged. Progress goes to a terminal's stderr
+ * unless -q.
+ */
+int hsh_fs_cp(char **args);
+
+/* fs sync [-q] [-j THREADS] src dst: make dst a copy of the tree src,
+ * skipping files whose size and mtime already match. Nothing in dst is
+ * deleted.
+ */
+int hsh_fs_sync(char **args);
+
+/* fs watch [-a] [-1] [-d MS] [path] [-- command ...]: watch path and the
+ * directories below it that fs find would enter (inotify), and after
+ * each burst of changes (quiet for MS, default 200) run command through
+ * hsh_run_line(), with the changed paths in $HSH_CHANGED (one per line)
+ * and in place of a "{}" word. Without a command the paths are printed.
+ * Runs until Ctrl-C; -1 stops after the first burst.
+ */
+int hsh_fs_watch(char **args);
+
+#endif
@@ -0,0 +1,57 @@
+/* Build-time generator: a perfect hash over the names in builtins.def.
+ * Prints builtin_table.h, a seed for hsh_builtin_hash() and the slot map
+ * from hash to builtins.def index, found by trying seeds until no two
+ * names share a slot.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "builtins.h"
+
+static const char *names[] = {
+#define HSH_BUILTIN(name, fn, flags, usage, help, details) name,
+#define HSH_HELP_TOPIC(name, details)
+#include "builtins.def"
+#undef HSH_BUILTIN
+#undef HSH_HELP_TOPIC
+};
+
+#define COUNT ((int)(sizeof(names) / sizeof(names[0])))
+
+int main(void) {
+    int slots = 1;
+    while (slots < 2 * COUNT)
+        slots *= 2;
+
+    for (;;) {
+        for (unsigned seed = 0; seed < 1000000; seed++) {
+            signed char map[1024];
+            int ok = 1;
+            memset(map, -1, sizeof(map));
+            for (int i = 0; i < COUNT && ok; i++) {
+                unsigned s = hsh_builtin_hash(names[i], seed) & (unsigned)(slots - 1);
+                if (map[s] >= 0)
+                    ok = 0;
+                map[s] = (signed char)i;
+            }
+            if (!ok)
+                continue;
+
+            printf("/* generated by gen_builtins from builtins.def; do not edit */\n\n");
+            printf("#define HSH_BUILTIN_COUNT %d\n", COUNT);
+            printf("#define HSH_BUILTIN_SLOTS %d\n", slots);
+            printf("#define HSH_BUILTIN_SEED  %uu\n\n", seed);
+            printf("/* hsh_builtin_hash(name) & (SLOTS - 1) -> index, -1 if free */\n");
+            printf("static const signed char hsh_builtin_slot[HSH_BUILTIN_SLOTS] = {");
+            for (int s = 0; s < slots; s++)
+                printf("%s%d%s", s % 16 ? " " : "\n    ", map[s], s + 1 < slots ? "," : "");
+            printf("\n};\n");
+            return 0;
+        }
+        slots *= 2;
+        if (slots > 1024 || COUNT > 127) {
+            fprintf(stderr, "gen_builtins: no perfect hash found\n");
+            return 1;
+        }
+    }
+}
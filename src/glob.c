@@ -0,0 +1,753 @@
+#define _GNU_SOURCE   /* memmem */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
+#include "glob.h"
+
+enum { G_LIT, G_ANY, G_CLASS, G_STAR, G_DSTAR, G_DSTAR_SLASH };
+
+struct hsh_glob_op {
+    unsigned char op;
+    unsigned char c;      /* G_LIT */
+    uint16_t      cls;    /* G_CLASS: index into classes */
+};
+
+struct hsh_glob {
+    int                 flags;
+    int                 nops;
+    struct hsh_glob_op *ops;
+    uint8_t           (*classes)[32];   /* 256-bit sets, negation folded in */
+    char               *lit;            /* longest literal run, prefilter */
+    size_t              litlen;
+};
+
+int hsh_glob_has_magic(const char *pat) {
+    for (const char *p = pat; *p; p++) {
+        if (*p == '\\' && p[1])
+            p++;
+        else if (*p == '*' || *p == '?' || *p == '[')
+            return 1;
+    }
+    return 0;
+}
+
+static unsigned char hsh_lower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+static unsigned char hsh_upper(unsigned char c) {
+    return (c >= 'a' && c <= 'z') ? (unsigned char)(c - 32) : c;
+}
+
+static int hsh_lit_eq(const char *a, const char *lit, size_t m, int fold) {
+    if (!fold)
+        return memcmp(a, lit, m) == 0;
+    for (size_t k = 0; k < m; k++)
+        if (hsh_lower((unsigned char)a[k]) != hsh_lower((unsigned char)lit[k]))
+            return 0;
+    return 1;
+}
+
+/* Both scans test the first and last byte of lit (either case with fold)
+ * at 16 or 32 offsets at once; only candidates where both agree get a
+ * full compare. They return how far they got, and *hit on a match. */
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("avx2")))
+static size_t hsh_scan_avx2(const char *h, size_t n, const char *lit, size_t m,
+                            int fold, const char **hit) {
+    unsigned char f = (unsigned char)lit[0], l = (unsigned char)lit[m - 1];
+    const __m256i f1 = _mm256_set1_epi8((char)(fold ? hsh_lower(f) : f));
+    const __m256i f2 = _mm256_set1_epi8((char)(fold ? hsh_upper(f) : f));
+    const __m256i l1 = _mm256_set1_epi8((char)(fold ? hsh_lower(l) : l));
+    const __m256i l2 = _mm256_set1_epi8((char)(fold ? hsh_upper(l) : l));
+    size_t i = 0;
+
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(h + i + m - 1));
+        __m256i ea = _mm256_or_si256(_mm256_cmpeq_epi8(a, f1), _mm256_cmpeq_epi8(a, f2));
+        __m256i eb = _mm256_or_si256(_mm256_cmpeq_epi8(b, l1), _mm256_cmpeq_epi8(b, l2));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(ea, eb));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (hsh_lit_eq(h + i + bit, lit, m, fold)) {
+                *hit = h + i + bit;
+                return i;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return i;
+}
+#endif
+
+#ifdef __SSE2__
+static size_t hsh_scan_sse2(const char *h, size_t n, const char *lit, size_t m,
+                            int fold, const char **hit) {
+    unsigned char f = (unsigned char)lit[0], l = (unsigned char)lit[m - 1];
+    const __m128i f1 = _mm_set1_epi8((char)(fold ? hsh_lower(f) : f));
+    const __m128i f2 = _mm_set1_epi8((char)(fold ? hsh_upper(f) : f));
+    const __m128i l1 = _mm_set1_epi8((char)(fold ? hsh_lower(l) : l));
+    const __m128i l2 = _mm_set1_epi8((char)(fold ? hsh_upper(l) : l));
+    size_t i = 0;
+
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(h + i + m - 1));
+        __m128i ea = _mm_or_si128(_mm_cmpeq_epi8(a, f1), _mm_cmpeq_epi8(a, f2));
+        __m128i eb = _mm_or_si128(_mm_cmpeq_epi8(b, l1), _mm_cmpeq_epi8(b, l2));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(ea, eb));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (hsh_lit_eq(h + i + bit, lit, m, fold)) {
+                *hit = h + i + bit;
+                return i;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return i;
+}
+#endif
+
+static const char *hsh_memmem_any(const char *h, size_t n, const char *lit,
+                                  size_t m, int fold) {
+    if (m == 0)
+        return h;
+    if (n < m)
+        return NULL;
+    if (m == 1 && (!fold || hsh_lower((unsigned char)lit[0]) ==
+                            hsh_upper((unsigned char)lit[0])))
+        return memchr(h, lit[0], n);
+
+    const char *hit = NULL;
+    size_t i = 0;
+#if defined(__x86_64__) && defined(__GNUC__)
+    static int avx2 = -1;   /* atomic: fs grep threads share it */
+    int have = __atomic_load_n(&avx2, __ATOMIC_RELAXED);
+    if (have < 0) {
+        have = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&avx2, have, __ATOMIC_RELAXED);
+    }
+    if (have)
+        i = hsh_scan_avx2(h, n, lit, m, fold, &hit);
+#endif
+#ifdef __SSE2__
+    if (!hit)
+        i += hsh_scan_sse2(h + i, n - i, lit, m, fold, &hit);
+#endif
+    if (hit)
+        return hit;
+    if (!fold)
+        return memmem(h + i, n - i, lit, m);
+    for (; i + m <= n; i++)
+        if (hsh_lit_eq(h + i, lit, m, 1))
+            return h + i;
+    return NULL;
+}
+
+const char *hsh_memmem(const char *h, size_t n, const char *lit, size_t m) {
+    return hsh_memmem_any(h, n, lit, m, 0);
+}
+
+const char *hsh_memcasemem(const char *h, size_t n, const char *lit, size_t m) {
+    return hsh_memmem_any(h, n, lit, m, 1);
+}
+
+/* class body at p (just past '['); returns the end, NULL if unterminated */
+static const char *hsh_glob_class(const char *p, uint8_t set[32]) {
+    int neg = (*p == '!' || *p == '^');
+    if (neg)
+        p++;
+
+    memset(set, 0, 32);
+    int first = 1;
+    while (*p && (*p != ']' || first)) {
+        unsigned char lo = (unsigned char)*p;
+        if (lo == '\\' && p[1])
+            lo = (unsigned char)*++p;
+        unsigned char hi = lo;
+        if (p[1] == '-' && p[2] && p[2] != ']') {
+            p += 2;
+            if (*p == '\\' && p[1])
+                p++;
+            hi = (unsigned char)*p;
+        }
+        for (unsigned c = lo; c <= hi; c++)
+            set[c >> 3] |= (uint8_t)(1u << (c & 7));
+        p++;
+        first = 0;
+    }
+    if (*p != ']')
+        return NULL;
+    if (neg)
+        for (int i = 0; i < 32; i++)
+            set[i] = (uint8_t)~set[i];
+    return p + 1;
+}
+
+struct hsh_glob *hsh_glob_compile(const char *pat, int flags) {
+    size_t len = strlen(pat);
+    struct hsh_glob *g = calloc(1, sizeof(*g));
+    if (!g)
+        return NULL;
+    g->flags = flags;
+    g->ops = malloc((len + 1) * sizeof(*g->ops));
+    g->lit = malloc(len + 1);
+    if (!g->ops || !g->lit)
+        goto fail;
+
+    int ncls = 0;
+    size_t run = 0;    /* current literal run, ending at ops[nops - 1] */
+
+    for (const char *p = pat; *p; ) {
+        struct hsh_glob_op op = { G_LIT, 0, 0 };
+
+        if (*p == '*') {
+            int dbl = (p[1] == '*');
+            p += dbl ? 2 : 1;
+            while (*p == '*')
+                p++;
+            op.op = G_STAR;
+            if (dbl && (flags & HSH_GLOB_PATHNAME)) {
+                op.op = G_DSTAR;
+                if (*p == '/') {
+                    op.op = G_DSTAR_SLASH;
+                    p++;
+                }
+            }
+        } else if (*p == '?') {
+            op.op = G_ANY;
+            p++;
+        } else if (*p == '[') {
+            uint8_t (*cls)[32] = realloc(g->classes, (size_t)(ncls + 1) * 32);
+            if (!cls)
+                goto fail;
+            g->classes = cls;
+            const char *q = hsh_glob_class(p + 1, g->classes[ncls]);
+            if (!q)
+                goto fail;
+            op.op = G_CLASS;
+            op.cls = (uint16_t)ncls++;
+            p = q;
+        } else {
+            if (*p == '\\' && p[1])
+                p++;
+            op.c = (unsigned char)*p++;
+        }
+
+        g->ops[g->nops++] = op;
+        if (op.op == G_LIT) {
+            run++;
+            if (run > g->litlen) {
+                g->litlen = run;
+                for (size_t k = 0; k < run; k++)
+                    g->lit[k] = (char)g->ops[g->nops - run + k].c;
+            }
+        } else {
+            run = 0;
+        }
+    }
+    return g;
+
+fail:
+    hsh_glob_free(g);
+    return NULL;
+}
+
+void hsh_glob_free(struct hsh_glob *g) {
+    if (!g)
+        return;
+    free(g->ops);
+    free(g->classes);
+    free(g->lit);
+    free(g);
+}
+
+struct hsh_glob_m {
+    const struct hsh_glob *g;
+    const char            *start;
+    const char            *end;
+};
+
+/* '.' at the start of s, or of a path component, is off limits */
+static int hsh_glob_hidden(const struct hsh_glob_m *m, const char *s) {
+    if (!(m->g->flags & HSH_GLOB_PERIOD) || s == m->end || *s != '.')
+        return 0;
+    return s == m->start || ((m->g->flags & HSH_GLOB_PATHNAME) && s[-1] == '/');
+}
+
+static int hsh_glob_run(const struct hsh_glob_m *m, int i, const char *s) {
+    const struct hsh_glob *g = m->g;
+    int slash = g->flags & HSH_GLOB_PATHNAME;
+
+    while (i < g->nops) {
+        const struct hsh_glob_op *op = &g->ops[i];
+
+        switch (op->op) {
+        case G_LIT:
+            if (s == m->end || (unsigned char)*s != op->c)
+                return 0;
+            break;
+
+        case G_ANY:
+            if (s == m->end || (slash && *s == '/') || hsh_glob_hidden(m, s))
+                return 0;
+            break;
+
+        case G_CLASS: {
+            if (s == m->end || (slash && *s == '/') || hsh_glob_hidden(m, s))
+                return 0;
+            unsigned char c = (unsigned char)*s;
+            if (!(g->classes[op->cls][c >> 3] & (1u << (c & 7))))
+                return 0;
+            break;
+        }
+
+        case G_STAR:
+            /* as in fnmatch(3), even an empty '*' can't stand there */
+            if (hsh_glob_hidden(m, s))
+                return 0;
+            for (const char *t = s; ; t++) {
+                if (hsh_glob_run(m, i + 1, t))
+                    return 1;
+                if (t == m->end || (slash && *t == '/'))
+                    return 0;
+            }
+
+        case G_DSTAR:
+            for (const char *t = s; ; t++) {
+                if (hsh_glob_run(m, i + 1, t))
+                    return 1;
+                if (t == m->end)
+                    return 0;
+            }
+
+        case G_DSTAR_SLASH:
+            /* "", or anything up to and including a '/' */
+            if (hsh_glob_run(m, i + 1, s))
+                return 1;
+            for (const char *t = s; t < m->end; t++) {
+                if (*t == '/' && hsh_glob_run(m, i + 1, t + 1))
+                    return 1;
+            }
+            return 0;
+        }
+        i++;
+        s++;
+    }
+    return s == m->end;
+}
+
+int hsh_glob_match(const struct hsh_glob *g, const char *s, size_t n) {
+    if (g->litlen > 1 && !hsh_memmem(s, n, g->lit, g->litlen))
+        return 0;
+
+    struct hsh_glob_m m = { g, s, s + n };
+    return hsh_glob_run(&m, 0, s);
+}
+
+/* ----- pathname expansion ----- */
+
+struct hsh_gx_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+/* one directory's names, packed: "name\0" runs in names, types alongside */
+struct hsh_gx_list {
+    char                 *dir;       /* as listed: "" for the cwd */
+    char                 *names;
+    size_t               *offs;
+    unsigned char        *types;
+    size_t                n;
+    struct hsh_gx_list   *next;      /* in the line's cache */
+};
+
+struct hsh_gx {
+    struct hsh_gx_list *cache;       /* directories listed for this line */
+    char               *arena;       /* result strings of every word */
+    size_t              used, cap;
+    size_t             *offs;        /* arena offsets, one per word */
+    size_t              n, ncap;
+    int                 error;       /* ENOMEM or E2BIG */
+};
+
+static void hsh_gx_list_free(struct hsh_gx_list *l) {
+    if (!l)
+        return;
+    free(l->dir);
+    free(l->names);
+    free(l->offs);
+    free(l->types);
+    free(l);
+}
+
+/* dir's entries but . and .., with getdents64(2) */
+static struct hsh_gx_list *hsh_gx_read(const char *dir) {
+    int fd = open(*dir ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct hsh_gx_list *l = calloc(1, sizeof(*l));
+    char buf[32 * 1024];
+    size_t used = 0, cap = 0, ncap = 0;
+    if (!l || !(l->dir = strdup(dir)))
+        goto fail;
+
+    for (;;) {
+        long got = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+        if (got <= 0)
+            break;
+        for (long off = 0; off < got; ) {
+            struct hsh_gx_dirent64 *d = (struct hsh_gx_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            const char *name = d->d_name;
+            if (name[0] == '.' &&
+                (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            size_t len = strlen(name) + 1;
+            if (used + len > cap) {
+                cap = (used + len) * 2;
+                char *p = realloc(l->names, cap);
+                if (!p)
+                    goto fail;
+                l->names = p;
+            }
+            if (l->n == ncap) {
+                ncap = ncap ? ncap * 2 : 64;
+                size_t *o = realloc(l->offs, ncap * sizeof(*o));
+                if (!o)
+                    goto fail;
+                l->offs = o;
+                unsigned char *t = realloc(l->types, ncap);
+                if (!t)
+                    goto fail;
+                l->types = t;
+            }
+            memcpy(l->names + used, name, len);
+            l->offs[l->n] = used;
+            l->types[l->n++] = d->d_type;
+            used += len;
+        }
+    }
+    close(fd);
+    return l;
+
+fail:
+    close(fd);
+    hsh_gx_list_free(l);
+    return NULL;
+}
+
+/* cached for the rest of the line: `ls *.c *.h` reads the cwd once */
+static struct hsh_gx_list *hsh_gx_cached(struct hsh_gx *x, const char *dir) {
+    for (struct hsh_gx_list *l = x->cache; l; l = l->next)
+        if (strcmp(l->dir, dir) == 0)
+            return l;
+    struct hsh_gx_list *l = hsh_gx_read(dir);
+    if (l) {
+        l->next = x->cache;
+        x->cache = l;
+    }
+    return l;
+}
+
+static void hsh_gx_add(struct hsh_gx *x, const char *s, size_t len) {
+    if (x->error)
+        return;
+    if (x->used + len + 1 > HSH_GLOB_MAX_BYTES) {
+        x->error = E2BIG;
+        return;
+    }
+    if (x->used + len + 1 > x->cap) {
+        size_t cap = x->cap ? x->cap : 4096;
+        while (cap < x->used + len + 1)
+            cap *= 2;
+        char *p = realloc(x->arena, cap);
+        if (!p) {
+            x->error = ENOMEM;
+            return;
+        }
+        x->arena = p;
+        x->cap = cap;
+    }
+    if (x->n == x->ncap) {
+        size_t ncap = x->ncap ? x->ncap * 2 : 64;
+        size_t *o = realloc(x->offs, ncap * sizeof(*o));
+        if (!o) {
+            x->error = ENOMEM;
+            return;
+        }
+        x->offs = o;
+        x->ncap = ncap;
+    }
+    memcpy(x->arena + x->used, s, len);
+    x->arena[x->used + len] = '\0';
+    x->offs[x->n++] = x->used;
+    x->used += len + 1;
+}
+
+/* a pattern, split at '/' into components; literal ones unescaped */
+struct hsh_gx_pat {
+    char            **comp;
+    struct hsh_glob **g;       /* NULL for a literal component */
+    int               n;
+    int               dirs_only;   /* pattern ended in '/' */
+};
+
+static int hsh_gx_isdir(const char *path, unsigned char type) {
+    struct stat st;
+    if (type == DT_DIR)
+        return 1;
+    if (type != DT_LNK && type != DT_UNKNOWN)
+        return 0;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/* a full match; "dir/" patterns only keep directories, slash included */
+static void hsh_gx_match(struct hsh_gx *x, const struct hsh_gx_pat *p,
+                         char *path, size_t len, unsigned char type) {
+    if (!p->dirs_only) {
+        hsh_gx_add(x, path, len);
+        return;
+    }
+    if (len + 2 > PATH_MAX || !hsh_gx_isdir(path, type))
+        return;
+    if (len == 0 || path[len - 1] != '/') {
+        path[len] = '/';
+        hsh_gx_add(x, path, len + 1);
+        path[len] = '\0';
+    } else {
+        hsh_gx_add(x, path, len);
+    }
+}
+
+/* path (len bytes, a directory or "") matched components up to i */
+static void hsh_gx_walk(struct hsh_gx *x, const struct hsh_gx_pat *p, int i,
+                        char *path, size_t len, int streamed);
+
+static size_t hsh_gx_join(char *path, size_t len, const char *name) {
+    size_t n = strlen(name);
+    if (len + n + 2 > PATH_MAX)
+        return 0;
+    if (len > 0 && path[len - 1] != '/')
+        path[len++] = '/';
+    memcpy(path + len, name, n + 1);
+    return len + n;
+}
+
+/* the names in path's listing l that match component i */
+static void hsh_gx_each(struct hsh_gx *x, const struct hsh_gx_pat *p, int i,
+                        char *path, size_t len, const struct hsh_gx_list *l,
+                        int streamed) {
+    for (size_t k = 0; k < l->n && !x->error; k++) {
+        const char *name = l->names + l->offs[k];
+        if (!hsh_glob_match(p->g[i], name, strlen(name)))
+            continue;
+        size_t sub = hsh_gx_join(path, len, name);
+        if (sub == 0)
+            continue;
+        if (i + 1 == p->n)
+            hsh_gx_match(x, p, path, sub, l->types[k]);
+        else if (hsh_gx_isdir(path, l->types[k]))
+            hsh_gx_walk(x, p, i + 1, path, sub, streamed);
+        path[len] = '\0';
+    }
+}
+
+/* `**`: here, and every directory below that doesn't start with '.'.
+ * Listings are read once, used for the next component and dropped: a big
+ * tree is never held in full. */
+static void hsh_gx_dstar(struct hsh_gx *x, const struct hsh_gx_pat *p, int i,
+                         char *path, size_t len) {
+    struct hsh_gx_list *l = hsh_gx_read(path);
+    if (!l) {
+        if (errno == ENOMEM)
+            x->error = ENOMEM;
+        return;
+    }
+    if (i + 1 < p->n) {
+        if (p->g[i + 1])
+            hsh_gx_each(x, p, i + 1, path, len, l, 1);
+        else
+            hsh_gx_walk(x, p, i + 1, path, len, 1);
+    }
+    for (size_t k = 0; k < l->n && !x->error; k++) {
+        const char *name = l->names + l->offs[k];
+        if (name[0] == '.')
+            continue;
+        size_t sub = hsh_gx_join(path, len, name);
+        if (sub == 0)
+            continue;
+        if (i + 1 == p->n)
+            hsh_gx_match(x, p, path, sub, l->types[k]);
+        if (l->types[k] == DT_DIR ||
+            (l->types[k] == DT_UNKNOWN && hsh_gx_isdir(path, DT_UNKNOWN)))
+            hsh_gx_dstar(x, p, i, path, sub);
+        path[len] = '\0';
+    }
+    hsh_gx_list_free(l);
+}
+
+static void hsh_gx_walk(struct hsh_gx *x, const struct hsh_gx_pat *p, int i,
+                        char *path, size_t len, int streamed) {
+    if (x->error)
+        return;
+    if (i == p->n) {
+        hsh_gx_match(x, p, path, len, DT_UNKNOWN);
+        return;
+    }
+
+    if (!p->g[i]) {
+        if (strcmp(p->comp[i], "**") == 0) {
+            hsh_gx_dstar(x, p, i, path, len);
+            return;
+        }
+        size_t sub = hsh_gx_join(path, len, p->comp[i]);
+        struct stat st;
+        if (sub > 0 && lstat(path, &st) == 0 &&
+            (i + 1 == p->n || S_ISDIR(st.st_mode) ||
+             (S_ISLNK(st.st_mode) && hsh_gx_isdir(path, DT_LNK))))
+            hsh_gx_walk(x, p, i + 1, path, sub, streamed);
+        path[len] = '\0';
+        return;
+    }
+
+    /* below a `**` every directory is new: don't fill the cache with them */
+    struct hsh_gx_list *l = streamed ? hsh_gx_read(path) : hsh_gx_cached(x, path);
+    if (!l)
+        return;
+    hsh_gx_each(x, p, i, path, len, l, streamed);
+    if (streamed)
+        hsh_gx_list_free(l);
+}
+
+static int hsh_gx_cmp(const void *a, const void *b, void *arena) {
+    return strcmp((char *)arena + *(const size_t *)a,
+                  (char *)arena + *(const size_t *)b);
+}
+
+/* word's matches, sorted, appended to x; 0 if there were none */
+static size_t hsh_gx_word(struct hsh_gx *x, const char *word) {
+    size_t first = x->n;
+    char *copy = strdup(word);
+    size_t nslash = 1;
+    for (const char *c = word; *c; c++)
+        nslash += (*c == '/');
+    struct hsh_gx_pat p;
+    memset(&p, 0, sizeof(p));
+    p.comp = calloc(nslash, sizeof(*p.comp));
+    p.g = calloc(nslash, sizeof(*p.g));
+    char *path = malloc(PATH_MAX);
+    if (!copy || !p.comp || !p.g || !path) {
+        x->error = ENOMEM;
+        goto out;
+    }
+
+    path[0] = '\0';
+    size_t len = 0;
+    if (word[0] == '/') {
+        path[0] = '/';
+        path[1] = '\0';
+        len = 1;
+    }
+    char *save;
+    for (char *c = strtok_r(copy, "/", &save); c; c = strtok_r(NULL, "/", &save)) {
+        p.comp[p.n] = c;
+        if (strcmp(c, "**") != 0 && hsh_glob_has_magic(c)) {
+            p.g[p.n] = hsh_glob_compile(c, HSH_GLOB_PERIOD);
+            if (!p.g[p.n])
+                goto out;    /* malformed: stays literal */
+        } else {
+            /* literal: drop the escapes */
+            char *d = c;
+            for (char *s = c; *s; s++) {
+                if (*s == '\\' && s[1])
+                    s++;
+                *d++ = *s;
+            }
+            *d = '\0';
+        }
+        p.n++;
+    }
+
+    size_t wlen = strlen(word);
+    p.dirs_only = wlen > 1 && word[wlen - 1] == '/';
+    if (p.n > 0)
+        hsh_gx_walk(x, &p, 0, path, len, 0);
+    if (x->error)
+        goto out;
+
+    qsort_r(x->offs + first, x->n - first, sizeof(*x->offs), hsh_gx_cmp, x->arena);
+
+out:
+    for (int k = 0; k < p.n; k++)
+        hsh_glob_free(p.g[k]);
+    free(p.comp);
+    free(p.g);
+    free(copy);
+    free(path);
+    return x->error ? 0 : x->n - first;
+}
+
+char **hsh_glob_argv(char **argv, const char *noexpand) {
+    struct hsh_gx x;
+    memset(&x, 0, sizeof(x));
+
+    for (int i = 0; argv[i] && !x.error; i++) {
+        if ((noexpand && noexpand[i]) || !hsh_glob_has_magic(argv[i]) ||
+            hsh_gx_word(&x, argv[i]) == 0)
+            if (!x.error)
+                hsh_gx_add(&x, argv[i], strlen(argv[i]));
+    }
+    while (x.cache) {
+        struct hsh_gx_list *next = x.cache->next;
+        hsh_gx_list_free(x.cache);
+        x.cache = next;
+    }
+
+    /* the vector and its strings in one block: free() releases both */
+    char **out = NULL;
+    if (!x.error) {
+        size_t vec = (x.n + 1) * sizeof(char *);
+        out = malloc(vec + x.used);
+        if (out) {
+            char *strs = (char *)out + vec;
+            memcpy(strs, x.arena, x.used);
+            for (size_t k = 0; k < x.n; k++)
+                out[k] = strs + x.offs[k];
+            out[x.n] = NULL;
+        } else {
+            x.error = ENOMEM;
+        }
+    }
+    if (x.error == E2BIG)
+        fprintf(stderr, "hsh: wildcards match over %d MiB of names\n",
+                HSH_GLOB_MAX_BYTES >> 20);
+    else if (x.error)
+        perror("hsh: wildcard expansion");
+    free(x.arena);
+    free(x.offs);
+    return out;
+}
@@ -0,0 +1,50 @@
+#ifndef HSH_GLOB_H
+#define HSH_GLOB_H
+
+#include <stddef.h>
+
+/* Shell-style wildcard patterns: * ? [abc] [a-z] [!x] and \x.
+ * Patterns are compiled once and matched many times (fs find, .gitignore
+ * rules); the longest literal run in a pattern is checked first with a
+ * SIMD substring scan, so most non-matching names are rejected without
+ * running the matcher.
+ */
+
+/* '*', '?' and classes stop at '/'; a double star crosses it, and a
+ * double star followed by '/' also matches zero directories, as in
+ * .gitignore */
+#define HSH_GLOB_PATHNAME 0x1
+/* a leading '.' (after '/' with PATHNAME) only matches a literal '.' */
+#define HSH_GLOB_PERIOD   0x2
+
+struct hsh_glob;
+
+/* NULL on a malformed pattern (unterminated class) or out of memory */
+struct hsh_glob *hsh_glob_compile(const char *pat, int flags);
+void hsh_glob_free(struct hsh_glob *g);
+
+/* 1 if s[0..n) matches the whole pattern */
+int hsh_glob_match(const struct hsh_glob *g, const char *s, size_t n);
+
+/* 1 if pat has any unescaped wildcard */
+int hsh_glob_has_magic(const char *pat);
+
+/* Pathname expansion of an argument vector, as the parser runs it on each
+ * command: words with wildcards are replaced by the paths they match,
+ * sorted, read with getdents64(2) and each directory listed once per
+ * call. A '**' component matches any number of directories (not hidden,
+ * not through symlinks); a word ending in '/' only matches directories.
+ * Words that match nothing, and those flagged in noexpand (may be NULL),
+ * are kept as is. The vector and its strings are one allocation, released
+ * with free(). NULL (with a message) when out of memory or past
+ * HSH_GLOB_MAX_BYTES of names.
+ */
+#define HSH_GLOB_MAX_BYTES (16 << 20)
+char **hsh_glob_argv(char **argv, const char *noexpand);
+
+/* memmem(), 32 or 16 bytes at a time with AVX2/SSE2 where available */
+const char *hsh_memmem(const char *h, size_t n, const char *lit, size_t m);
+/* the same, ignoring ASCII case */
+const char *hsh_memcasemem(const char *h, size_t n, const char *lit, size_t m);
+
+#endif
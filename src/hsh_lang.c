@@ -1,12 +1,28 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "lang.h"
+#include "lang_aot.h"
+#include "lang_cache.h"
+#include "lang_memo.h"
+#include "lang_rt.h"
+#include "builtins.h"
 
 /* HorizonShell builtin: lang ... */
 int hsh_builtin_lang(char **args) {
     if (!args[1]) {
         fprintf(stderr, "hsh-lang: empty input\n");
+        return 0;
+    }
+
+    /* lang --stats: @cached hits/misses so far in this shell */
+    if (strcmp(args[1], "--stats") == 0 && !args[2]) {
+        hsh_memo_print_stats(stdout);
         return 1;
     }
 
@@ -21,54 +37,154 @@ int hsh_builtin_lang(char **args) {
 
     if (buf[0] == '\0') {
         fprintf(stderr, "hsh-lang: empty input\n");
-        return 1;
+        return 0;
     }
 
-    hsh_node *n = hsh_lang_parse_stmt(buf);
-    if (!n)
-        return 1;
+    hsh_lang_init();
+
+    hsh_arena *arena = hsh_arena_new();
+    if (!arena) {
+        fprintf(stderr, "hsh-lang: out of memory\n");
+        return 0;
+    }
+
+    hsh_node *n = hsh_lang_parse_stmt(arena, buf);
+    hsh_prog *prog = n ? hsh_lang_compile(n) : NULL;
+    if (n && !prog)
+        fprintf(stderr, "hsh-lang: out of memory\n");
 
-    int st = hsh_lang_eval(n);
-    hsh_lang_free(n);
+    /* fn definitions outlive the arena: the registry owns them */
+    int st = prog ? hsh_lang_run(prog) : 1;
+    hsh_prog_free(prog);
+    hsh_arena_free(arena);
 
-    (void)st; /* keep HorizonShell running */
-    return 1;
+    return st == 0;  /* builtin convention: 1 = success */
 }
 
 #ifdef BUILD_HSH_MAIN
-/* Standalone interpreter: hsh-lang <file> */
+/* parse a mapped script into arena (names are copied, so the mapping can
+ * go right after); -1 after a syntax error */
+static int hsh_lang_parse_file(const char *path, int fd, size_t size,
+                               hsh_arena *arena,
+                               hsh_node ***stmts, size_t *n) {
+    void *map = NULL;
+    if (size > 0) {
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("hsh-lang: mmap");
+            return -1;
+        }
+    }
+
+    int rc = hsh_lang_parse_program(arena, map ? map : "", size, path,
+                                    stmts, n);
+    if (map)
+        munmap(map, size);
+    return rc;
+}
+
+/* compile a script; NULL after a syntax error */
+static hsh_script *hsh_lang_load_source(const char *path, int fd, size_t size) {
+    hsh_arena *arena = hsh_arena_new();
+    hsh_node **stmts = NULL;
+    size_t n = 0;
+    hsh_script *sc = NULL;
+
+    if (!arena) {
+        fprintf(stderr, "hsh-lang: out of memory\n");
+    } else if (hsh_lang_parse_file(path, fd, size, arena, &stmts, &n) == 0) {
+        sc = hsh_lang_compile_script(stmts, n);
+        if (!sc)
+            fprintf(stderr, "hsh-lang: out of memory\n");
+    }
+
+    /* compiled programs hold registry names, not arena ones */
+    hsh_arena_free(arena);
+    return sc;
+}
+
+/* hsh-lang --compile <file> -o <out> */
+static int hsh_lang_compile_file(const char *path, int fd, size_t size,
+                                 const char *out) {
+    hsh_arena *arena = hsh_arena_new();
+    hsh_node **stmts = NULL;
+    size_t n = 0;
+    int rc = 1;
+
+    if (!arena)
+        fprintf(stderr, "hsh-lang: out of memory\n");
+    else if (hsh_lang_parse_file(path, fd, size, arena, &stmts, &n) == 0)
+        rc = hsh_lang_aot_build(stmts, n, path, out) == 0 ? 0 : 1;
+
+    hsh_arena_free(arena);
+    return rc;
+}
+
+static void hsh_lang_usage(void) {
+    fprintf(stderr, "Usage: hsh-lang [--stats] <file>\n"
+                    "       hsh-lang --compile <file> -o <out>[.c]\n");
+}
+
+/* Standalone interpreter: hsh-lang [--stats] <file> */
 int main(int argc, char **argv) {
+    int stats = 0;
+    const char *compile_out = NULL;
+
+    if (argc > 1 && strcmp(argv[1], "--stats") == 0) {
+        stats = 1;
+        argv++;
+        argc--;
+    } else if (argc > 1 && strcmp(argv[1], "--compile") == 0) {
+        if (argc != 5 || strcmp(argv[3], "-o") != 0) {
+            hsh_lang_usage();
+            return 1;
+        }
+        compile_out = argv[4];
+        argv++;
+        argc--;
+    }
     if (argc < 2) {
-        fprintf(stderr, "Usage: hsh-lang <file>\n");
+        hsh_lang_usage();
         return 1;
     }
 
     const char *path = argv[1];
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        perror("hsh-lang: fopen");
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror("hsh-lang: open");
         return 1;
     }
 
-    char line[512];
-    int st = 0;
+    if (compile_out) {
+        int rc = hsh_lang_compile_file(path, fd, (size_t)st.st_size,
+                                       compile_out);
+        close(fd);
+        return rc;
+    }
 
-    while (fgets(line, sizeof(line), f)) {
-        char *p = line;
-        while (*p == ' ' || *p == '\t') p++;
-        if (*p == '#' || *p == '\n' || *p == '\0')
-            continue;
+    hsh_lang_init();
 
-        hsh_node *n = hsh_lang_parse_stmt(p);
-        if (!n) {
-            st = 1;
-            break;
-        }
-        st = hsh_lang_eval(n);
-        hsh_lang_free(n);
+    /* a cache that still matches the source skips parsing entirely */
+    char cache[4096];
+    int have_cache = hsh_lang_cache_path(path, cache, sizeof(cache)) == 0;
+    hsh_script *sc = have_cache ? hsh_lang_cache_load(cache, &st) : NULL;
+
+    if (!sc) {
+        sc = hsh_lang_load_source(path, fd, (size_t)st.st_size);
+        /* best effort: read-only directories just don't get a cache */
+        if (sc && have_cache)
+            (void)hsh_lang_cache_save(cache, &st, sc);
     }
+    close(fd);
+    if (!sc)
+        return 1;
 
-    fclose(f);
-    return st;
+    hsh_script_define(sc);
+    int status = hsh_lang_run(sc->main);
+    hsh_script_free(sc);
+    if (stats)
+        hsh_memo_print_stats(stderr);
+    return status;
 }
 #endif
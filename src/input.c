@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "input.h"
+#include "builtins.h"
+
+typedef char *(*hsh_readline_fn)(const char *);
+typedef void  (*hsh_add_history_fn)(const char *);
+typedef char *(*hsh_compentry_fn)(const char *, int);
+typedef char **(*hsh_completion_fn)(const char *, int, int);
+typedef char **(*hsh_matches_fn)(const char *, hsh_compentry_fn);
+
+static hsh_readline_fn    rl_readline = NULL;
+static hsh_add_history_fn rl_add_history = NULL;
+static hsh_matches_fn     rl_completion_matches = NULL;
+static int rl_tried = 0;
+
+/* builtin names (builtins.def) starting with text, one per call */
+static char *hsh_complete_builtin(const char *text, int state) {
+    static int i;
+    static size_t len;
+    if (state == 0) {
+        i = 0;
+        len = strlen(text);
+    }
+    for (const struct hsh_builtin *b; (b = hsh_builtin_at(i)) != NULL; ) {
+        i++;
+        if (strncmp(b->name, text, len) == 0)
+            return strdup(b->name);
+    }
+    return NULL;
+}
+
+/* the first word completes to builtins; others (and a first word no
+ * builtin starts with) fall back to readline's file names */
+static char **hsh_complete(const char *text, int start, int end) {
+    (void)end;
+    if (start != 0)
+        return NULL;
+    return rl_completion_matches(text, hsh_complete_builtin);
+}
+
+/* sonames tried in order; the unversioned one needs the -dev package */
+static const char *rl_libs[] = {
+    "libreadline.so.8",
+    "libreadline.so.7",
+    "libreadline.so",
+    NULL
+};
+
+static void hsh_input_load(void) {
+    rl_tried = 1;
+
+    for (int i = 0; rl_libs[i] != NULL; i++) {
+        void *h = dlopen(rl_libs[i], RTLD_NOW | RTLD_LOCAL);
+        if (!h)
+            continue;
+
+        rl_readline = (hsh_readline_fn)dlsym(h, "readline");
+        rl_add_history = (hsh_add_history_fn)dlsym(h, "add_history");
+        if (rl_readline) {
+            hsh_completion_fn *hook = dlsym(h, "rl_attempted_completion_function");
+            rl_completion_matches = (hsh_matches_fn)dlsym(h, "rl_completion_matches");
+            if (hook && rl_completion_matches)
+                *hook = hsh_complete;
+            return;
+        }
+
+        rl_add_history = NULL;
+        dlclose(h);
+    }
+}
+
+/* fallback when libreadline is not installed */
+static char *hsh_input_plain(const char *prompt) {
+    char *line = NULL;
+    size_t sz = 0;
+
+    fputs(prompt, stdout);
+    fflush(stdout);
+
+    ssize_t n = getline(&line, &sz, stdin);
+    if (n == -1) {
+        free(line);
+        return NULL;
+    }
+    if (n > 0 && line[n - 1] == '\n')
+        line[n - 1] = '\0';
+    return line;
+}
+
+char *hsh_input_readline(const char *prompt) {
+    if (!rl_tried)
+        hsh_input_load();
+
+    if (rl_readline)
+        return rl_readline(prompt);
+    return hsh_input_plain(prompt);
+}
+
+void hsh_input_add_history(const char *line) {
+    if (rl_add_history)
+        rl_add_history(line);
+}
@@ -0,0 +1,16 @@
+#ifndef HSH_INPUT_H
+#define HSH_INPUT_H
+
+/* Interactive line input.
+ * libreadline is dlopen'd on the first call, so script and -c modes never
+ * pay for loading it. Without libreadline a plain line read is used.
+ * With it, the first word tab-completes to builtin names.
+ */
+
+/* Returns malloc'd line without trailing newline, or NULL on EOF. */
+char *hsh_input_readline(const char *prompt);
+
+/* Add line to history (no-op without libreadline). */
+void hsh_input_add_history(const char *line);
+
+#endif
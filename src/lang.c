@@ -2,8 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "lang.h"
+#include "lang_memo.h"
 
 /* ===== tiny lexer ===== */
 
@@ -12,91 +17,137 @@ typedef enum {
     TOK_IDENT,
     TOK_LPAREN,
     TOK_RPAREN,
-    TOK_CHAIN      /* ")(" */
+    TOK_LBRACE,
+    TOK_RBRACE,
+    TOK_SEMI,
+    TOK_CHAIN,     /* ")(" */
+    TOK_AMP,       /* "&" */
+    TOK_AT,        /* "@" */
+    TOK_EQ,        /* "=" */
+    TOK_COMMA,     /* "," */
+    TOK_NUM,       /* digits with an optional unit: 30s, 500ms */
+    TOK_BAD        /* unexpected character at start */
 } token_kind;
 
 typedef struct {
-    token_kind kind;
-    char       ident[64]; /* for TOK_IDENT */
+    token_kind  kind;
+    const char *start;   /* TOK_IDENT / TOK_BAD: points into the source */
+    size_t      len;
+    unsigned    line;    /* 1-based source position, for errors */
+    unsigned    col;
 } token;
 
+/* the source is [p, end): scripts are mapped, not NUL-terminated */
 typedef struct {
     const char *p;
+    const char *end;
+    const char *line_start;
+    unsigned    line;
 } lexer;
 
-static void lx_init(lexer *lx, const char *src) {
+static void lx_init(lexer *lx, const char *src, size_t len) {
     lx->p = src;
+    lx->end = src + len;
+    lx->line_start = src;
+    lx->line = 1;
 }
 
+/* skips blanks, newlines and '#' comments (which covers #! lines) */
 static void lx_skip_ws(lexer *lx) {
-    while (*lx->p == ' ' || *lx->p == '\t' || *lx->p == '\r' || *lx->p == '\n')
-        lx->p++;
+    while (lx->p < lx->end) {
+        char c = *lx->p;
+        if (c == '\n') {
+            lx->p++;
+            lx->line++;
+            lx->line_start = lx->p;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            lx->p++;
+        } else if (c == '#') {
+            while (lx->p < lx->end && *lx->p != '\n')
+                lx->p++;
+        } else {
+            break;
+        }
+    }
+}
+
+static int lx_is_ident(char c, int first) {
+    return isalpha((unsigned char)c) || c == '_' ||
+           (!first && isdigit((unsigned char)c));
 }
 
 static token lx_next(lexer *lx) {
     token t;
-    t.kind = TOK_EOF;
-    t.ident[0] = '\0';
 
     lx_skip_ws(lx);
 
-    char c = *lx->p;
-    if (c == '\0') {
-        t.kind = TOK_EOF;
+    t.kind = TOK_EOF;
+    t.start = lx->p;
+    t.len = 0;
+    t.line = lx->line;
+    t.col = (unsigned)(lx->p - lx->line_start) + 1;
+
+    if (lx->p >= lx->end || *lx->p == '\0')
         return t;
-    }
+
+    char c = *lx->p;
 
     /* ")(" operator */
-    if (c == ')' && lx->p[1] == '(') {
+    if (c == ')' && lx->p + 1 < lx->end && lx->p[1] == '(') {
         lx->p += 2;
         t.kind = TOK_CHAIN;
         return t;
     }
 
-    if (isalpha((unsigned char)c) || c == '_') {
-        size_t n = 0;
-        while (isalpha((unsigned char)*lx->p) ||
-               isdigit((unsigned char)*lx->p) ||
-               *lx->p == '_') {
-            if (n + 1 < sizeof(t.ident)) {
-                t.ident[n++] = *lx->p;
-            }
+    if (isdigit((unsigned char)c)) {
+        while (lx->p < lx->end && isalnum((unsigned char)*lx->p))
             lx->p++;
-        }
-        t.ident[n] = '\0';
-        t.kind = TOK_IDENT;
-        return t;
-    }
-
-    if (c == '(') {
-        lx->p++;
-        t.kind = TOK_LPAREN;
+        t.len = (size_t)(lx->p - t.start);
+        t.kind = TOK_NUM;
         return t;
     }
 
-    if (c == ')') {
-        lx->p++;
-        t.kind = TOK_RPAREN;
+    if (lx_is_ident(c, 1)) {
+        while (lx->p < lx->end && lx_is_ident(*lx->p, 0))
+            lx->p++;
+        t.len = (size_t)(lx->p - t.start);
+        t.kind = TOK_IDENT;
         return t;
     }
 
-    /* unknown char: skip and signal EOF */
     lx->p++;
-    t.kind = TOK_EOF;
+    t.len = 1;
+    switch (c) {
+    case '(': t.kind = TOK_LPAREN; break;
+    case ')': t.kind = TOK_RPAREN; break;
+    case '{': t.kind = TOK_LBRACE; break;
+    case '}': t.kind = TOK_RBRACE; break;
+    case ';': t.kind = TOK_SEMI;   break;
+    case '&': t.kind = TOK_AMP;    break;
+    case '@': t.kind = TOK_AT;     break;
+    case '=': t.kind = TOK_EQ;     break;
+    case ',': t.kind = TOK_COMMA;  break;
+    default:  t.kind = TOK_BAD;    break;
+    }
     return t;
 }
 
 /* ===== one-token lookahead parser wrapper ===== */
 
 typedef struct {
-    lexer lx;
-    token cur;
-    int   has_cur;
+    lexer       lx;
+    token       cur;
+    int         has_cur;
+    hsh_arena  *arena;
+    const char *path;    /* for error messages; NULL for one-liners */
 } parser;
 
-static void ps_init(parser *ps, const char *src) {
-    lx_init(&ps->lx, src);
+static void ps_init(parser *ps, hsh_arena *arena,
+                    const char *src, size_t len, const char *path) {
+    lx_init(&ps->lx, src, len);
     ps->has_cur = 0;
+    ps->arena = arena;
+    ps->path = path;
 }
 
 static token ps_peek(parser *ps) {
@@ -115,24 +166,159 @@ static token ps_next(parser *ps) {
     return lx_next(&ps->lx);
 }
 
-/* ===== AST allocation / free ===== */
+/* "file:line:col: syntax error: expected '('" */
+static void ps_error(parser *ps, token t, const char *what) {
+    char near[32];
 
-static hsh_node *hsh_make_call(const char *name) {
-    hsh_node *n = malloc(sizeof *n);
-    if (!n) return NULL;
-    n->kind = HSH_NODE_CALL;
-    n->u.call.name = strdup(name);
-    if (!n->u.call.name) {
-        free(n);
+    if (t.kind == TOK_EOF)
+        snprintf(near, sizeof(near), "end of input");
+    else
+        snprintf(near, sizeof(near), "'%.*s'",
+                 (int)(t.len > 16 ? 16 : t.len), t.start);
+
+    if (ps->path)
+        fprintf(stderr, "%s:%u:%u: syntax error: %s near %s\n",
+                ps->path, t.line, t.col, what, near);
+    else
+        fprintf(stderr, "hsh-lang syntax error at %u:%u: %s near %s\n",
+                t.line, t.col, what, near);
+}
+
+/* ===== arena + symbol table ===== */
+
+#define HSH_ARENA_BLOCK (16 * 1024)
+#define HSH_ARENA_ALIGN 16
+
+typedef struct hsh_arena_block hsh_arena_block;
+
+struct hsh_arena_block {
+    hsh_arena_block *next;
+    size_t           size;
+    size_t           used;
+    char             data[];
+};
+
+typedef struct {
+    unsigned    hash;
+    unsigned    len;
+    const char *str;
+} hsh_sym;
+
+struct hsh_arena {
+    hsh_arena_block *head;
+    hsh_sym         *syms;      /* open addressing, str == NULL is empty */
+    size_t           nsyms;
+    size_t           syms_cap;
+};
+
+hsh_arena *hsh_arena_new(void) {
+    return calloc(1, sizeof(hsh_arena));
+}
+
+void hsh_arena_free(hsh_arena *a) {
+    if (!a) return;
+    hsh_arena_block *b = a->head;
+    while (b) {
+        hsh_arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(a->syms);
+    free(a);
+}
+
+void *hsh_arena_alloc(hsh_arena *a, size_t n) {
+    n = (n + HSH_ARENA_ALIGN - 1) & ~(size_t)(HSH_ARENA_ALIGN - 1);
+
+    hsh_arena_block *b = a->head;
+    if (!b || b->size - b->used < n) {
+        /* blocks double up to 1 MiB; oversized requests get their own */
+        size_t size = b ? b->size * 2 : HSH_ARENA_BLOCK;
+        if (size > 1024 * 1024)
+            size = 1024 * 1024;
+        if (size < n)
+            size = n;
+        b = malloc(sizeof(*b) + size);
+        if (!b) return NULL;
+        b->size = size;
+        b->used = 0;
+        b->next = a->head;
+        a->head = b;
+    }
+
+    void *p = b->data + b->used;
+    b->used += n;
+    return p;
+}
+
+static unsigned hsh_name_hash_n(const char *s, size_t len) {
+    unsigned h = 2166136261u;   /* FNV-1a */
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int hsh_syms_grow(hsh_arena *a) {
+    size_t cap = a->syms_cap ? a->syms_cap * 2 : 64;
+    hsh_sym *tab = calloc(cap, sizeof(*tab));
+    if (!tab) return -1;
+
+    for (size_t i = 0; i < a->syms_cap; i++) {
+        if (!a->syms[i].str) continue;
+        size_t j = a->syms[i].hash & (cap - 1);
+        while (tab[j].str) j = (j + 1) & (cap - 1);
+        tab[j] = a->syms[i];
+    }
+    free(a->syms);
+    a->syms = tab;
+    a->syms_cap = cap;
+    return 0;
+}
+
+const char *hsh_arena_intern(hsh_arena *a, const char *s, size_t len) {
+    if ((a->nsyms + 1) * 2 > a->syms_cap && hsh_syms_grow(a) != 0)
         return NULL;
+
+    unsigned h = hsh_name_hash_n(s, len);
+    size_t mask = a->syms_cap - 1;
+    size_t j = h & mask;
+    while (a->syms[j].str) {
+        if (a->syms[j].hash == h && a->syms[j].len == len &&
+            memcmp(a->syms[j].str, s, len) == 0)
+            return a->syms[j].str;
+        j = (j + 1) & mask;
     }
+
+    char *copy = hsh_arena_alloc(a, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+
+    a->syms[j].hash = h;
+    a->syms[j].len = (unsigned)len;
+    a->syms[j].str = copy;
+    a->nsyms++;
+    return copy;
+}
+
+/* ===== AST allocation ===== */
+
+static hsh_node *hsh_make_call(hsh_arena *a, const char *name, size_t len) {
+    hsh_node *n = hsh_arena_alloc(a, sizeof *n);
+    if (!n) return NULL;
+    n->kind = HSH_NODE_CALL;
+    n->u.call.name = hsh_arena_intern(a, name, len);
+    if (!n->u.call.name) return NULL;
     return n;
 }
 
-static hsh_node *hsh_make_chain(hsh_chain_kind op,
+static hsh_node *hsh_make_chain(hsh_arena *a,
+                                hsh_chain_kind op,
                                 hsh_node *left,
                                 hsh_node *right) {
-    hsh_node *n = malloc(sizeof *n);
+    hsh_node *n = hsh_arena_alloc(a, sizeof *n);
     if (!n) return NULL;
     n->kind = HSH_NODE_CHAIN;
     n->u.chain.op = op;
@@ -141,49 +327,72 @@ static hsh_node *hsh_make_chain(hsh_chain_kind op,
     return n;
 }
 
-void hsh_lang_free(hsh_node *node) {
-    if (!node) return;
-    if (node->kind == HSH_NODE_CALL) {
-        free(node->u.call.name);
-    } else if (node->kind == HSH_NODE_CHAIN) {
-        hsh_lang_free(node->u.chain.left);
-        hsh_lang_free(node->u.chain.right);
-    }
-    free(node);
-}
-
 /* ===== recursive-descent parser ===== */
 
 /* Call := IDENT '(' ')' */
 static hsh_node *parse_call(parser *ps) {
     token t = ps_next(ps);
     if (t.kind != TOK_IDENT) {
-        fprintf(stderr, "hsh-lang syntax error: expected identifier\n");
+        ps_error(ps, t, "expected identifier");
         return NULL;
     }
 
-    char name[64];
-    strncpy(name, t.ident, sizeof(name));
-    name[sizeof(name) - 1] = '\0';
+    token name = t;
 
     t = ps_next(ps);
     if (t.kind != TOK_LPAREN) {
-        fprintf(stderr, "hsh-lang syntax error: expected '('\n");
+        ps_error(ps, t, "expected '('");
         return NULL;
     }
 
     t = ps_next(ps);
     if (t.kind != TOK_RPAREN) {
-        fprintf(stderr, "hsh-lang syntax error: expected ')'\n");
+        ps_error(ps, t, "expected ')'");
         return NULL;
     }
 
-    return hsh_make_call(name);
+    return hsh_make_call(ps->arena, name.start, name.len);
+}
+
+/* Group := Call ( '&' Call )* */
+static hsh_node *parse_group(parser *ps) {
+    hsh_node *first = parse_call(ps);
+    if (!first || ps_peek(ps).kind != TOK_AMP)
+        return first;
+
+    hsh_node **kids = NULL;
+    size_t nkids = 0, cap = 0;
+    hsh_node *kid = first;
+
+    for (;;) {
+        if (nkids == cap) {
+            size_t ncap = cap ? cap * 2 : 4;
+            hsh_node **tmp = hsh_arena_alloc(ps->arena, ncap * sizeof(*tmp));
+            if (!tmp) return NULL;
+            if (nkids) memcpy(tmp, kids, nkids * sizeof(*tmp));
+            kids = tmp;
+            cap = ncap;
+        }
+        kids[nkids++] = kid;
+
+        if (ps_peek(ps).kind != TOK_AMP)
+            break;
+        (void)ps_next(ps);   /* '&' */
+        kid = parse_call(ps);
+        if (!kid) return NULL;
+    }
+
+    hsh_node *n = hsh_arena_alloc(ps->arena, sizeof *n);
+    if (!n) return NULL;
+    n->kind = HSH_NODE_PAR;
+    n->u.par.kids = kids;
+    n->u.par.nkids = nkids;
+    return n;
 }
 
-/* Expr := Call ( ')(' Call )* */
+/* Expr := Group ( ')(' Group )* */
 static hsh_node *parse_expr(parser *ps) {
-    hsh_node *left = parse_call(ps);
+    hsh_node *left = parse_group(ps);
     if (!left) return NULL;
 
     for (;;) {
@@ -194,47 +403,419 @@ static hsh_node *parse_expr(parser *ps) {
         /* consume ')(' */
         (void)ps_next(ps);
 
-        hsh_node *right = parse_call(ps);
-        if (!right) {
-            hsh_lang_free(left);
+        hsh_node *right = parse_group(ps);
+        if (!right)
             return NULL;
-        }
 
         /* use success chaining for now; tweak if you add error chaining */
-        left = hsh_make_chain(HSH_CHAIN_ON_SUCCESS, left, right);
-        if (!left) {
-            hsh_lang_free(right);
+        left = hsh_make_chain(ps->arena, HSH_CHAIN_ON_SUCCESS, left, right);
+        if (!left)
             return NULL;
-        }
     }
 
     return left;
 }
 
-hsh_node *hsh_lang_parse_stmt(const char *line) {
+static int tok_is(token t, const char *word) {
+    return t.kind == TOK_IDENT && t.len == strlen(word) &&
+           memcmp(t.start, word, t.len) == 0;
+}
+
+/* Fn := 'fn' IDENT '(' ')' '{' ( Expr ';'? )* '}' */
+static hsh_node *parse_fn(parser *ps) {
+    (void)ps_next(ps);   /* 'fn' */
+
+    token name = ps_next(ps);
+    token t = name;
+    if (name.kind != TOK_IDENT ||
+        (t = ps_next(ps)).kind != TOK_LPAREN ||
+        (t = ps_next(ps)).kind != TOK_RPAREN) {
+        ps_error(ps, t, "expected 'fn name()'");
+        return NULL;
+    }
+    if ((t = ps_next(ps)).kind != TOK_LBRACE) {
+        ps_error(ps, t, "expected '{'");
+        return NULL;
+    }
+
+    hsh_node **body = NULL;
+    size_t nbody = 0, cap = 0;
+
+    for (;;) {
+        t = ps_peek(ps);
+        if (t.kind == TOK_RBRACE) {
+            (void)ps_next(ps);
+            break;
+        }
+        if (t.kind == TOK_SEMI) {
+            (void)ps_next(ps);
+            continue;
+        }
+        if (t.kind == TOK_EOF) {
+            ps_error(ps, t, "missing '}'");
+            return NULL;
+        }
+
+        hsh_node *stmt = parse_expr(ps);
+        if (!stmt) return NULL;
+
+        if (nbody == cap) {
+            size_t ncap = cap ? cap * 2 : 8;
+            hsh_node **tmp = hsh_arena_alloc(ps->arena, ncap * sizeof(*tmp));
+            if (!tmp) return NULL;
+            if (nbody) memcpy(tmp, body, nbody * sizeof(*tmp));
+            body = tmp;
+            cap = ncap;
+        }
+        body[nbody++] = stmt;
+    }
+
+    hsh_node *n = hsh_arena_alloc(ps->arena, sizeof *n);
+    if (!n) return NULL;
+    n->kind = HSH_NODE_FN;
+    n->u.fn.name = hsh_arena_intern(ps->arena, name.start, name.len);
+    n->u.fn.body = body;
+    n->u.fn.nbody = nbody;
+    n->u.fn.attrs.ttl_ms = 0;
+    n->u.fn.attrs.persist = 0;
+    return n->u.fn.name ? n : NULL;
+}
+
+/* "30s" -> 30000; units ms, s (default), m, h. 0 if malformed. */
+static unsigned parse_duration(token t) {
+    unsigned long v = 0;
+    size_t i = 0;
+
+    while (i < t.len && isdigit((unsigned char)t.start[i]) && v < 100000000)
+        v = v * 10 + (unsigned long)(t.start[i++] - '0');
+
+    const char *u = t.start + i;
+    size_t ulen = t.len - i;
+    if (ulen == 2 && memcmp(u, "ms", 2) == 0) return (unsigned)v;
+    if (ulen == 0 || (ulen == 1 && *u == 's')) v *= 1000;
+    else if (ulen == 1 && *u == 'm') v *= 60 * 1000;
+    else if (ulen == 1 && *u == 'h') v *= 3600 * 1000;
+    else return 0;
+    return v > 0xffffffffUL ? 0xffffffffu : (unsigned)v;
+}
+
+/* Attr := '@' 'cached' [ '(' [ Arg ( ',' Arg )* ] ')' ]
+ * Arg  := 'ttl' '=' NUM | 'persist'
+ */
+static int parse_attrs(parser *ps, hsh_fn_attrs *attrs) {
+    (void)ps_next(ps);   /* '@' */
+
+    token t = ps_next(ps);
+    if (!tok_is(t, "cached")) {
+        ps_error(ps, t, "unknown attribute");
+        return -1;
+    }
+    attrs->ttl_ms = 60 * 1000;
+    attrs->persist = 0;
+
+    if (ps_peek(ps).kind != TOK_LPAREN)
+        return 0;
+    (void)ps_next(ps);
+
+    while ((t = ps_next(ps)).kind != TOK_RPAREN) {
+        if (tok_is(t, "persist")) {
+            attrs->persist = 1;
+        } else if (tok_is(t, "ttl")) {
+            if ((t = ps_next(ps)).kind != TOK_EQ ||
+                (t = ps_next(ps)).kind != TOK_NUM ||
+                (attrs->ttl_ms = parse_duration(t)) == 0) {
+                ps_error(ps, t, "expected ttl=DURATION (e.g. 30s)");
+                return -1;
+            }
+        } else {
+            ps_error(ps, t, "expected 'ttl=' or 'persist'");
+            return -1;
+        }
+
+        t = ps_peek(ps);
+        if (t.kind == TOK_COMMA)
+            (void)ps_next(ps);
+        else if (t.kind != TOK_RPAREN) {
+            ps_error(ps, t, "expected ',' or ')'");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static hsh_node *parse_stmt(parser *ps) {
+    hsh_fn_attrs attrs = { 0, 0 };
+
+    if (ps_peek(ps).kind == TOK_AT) {
+        if (parse_attrs(ps, &attrs) != 0)
+            return NULL;
+        if (!tok_is(ps_peek(ps), "fn")) {
+            ps_error(ps, ps_peek(ps), "attributes need an fn definition");
+            return NULL;
+        }
+    }
+
+    if (!tok_is(ps_peek(ps), "fn"))
+        return parse_expr(ps);
+
+    hsh_node *n = parse_fn(ps);
+    if (n)
+        n->u.fn.attrs = attrs;
+    return n;
+}
+
+hsh_node *hsh_lang_parse_stmt(hsh_arena *arena, const char *line) {
     parser ps;
-    ps_init(&ps, line);
+    ps_init(&ps, arena, line, strlen(line), NULL);
 
-    hsh_node *root = parse_expr(&ps);
+    hsh_node *root = parse_stmt(&ps);
     if (!root) return NULL;
 
     token t = ps_peek(&ps);
     if (t.kind != TOK_EOF) {
-        fprintf(stderr, "hsh-lang syntax error after expression\n");
-        hsh_lang_free(root);
+        ps_error(&ps, t, "unexpected input after expression");
         return NULL;
     }
 
     return root;
 }
 
+/* Program := ( Stmt ';'? )* -- statements may span lines */
+int hsh_lang_parse_program(hsh_arena *arena, const char *src, size_t len,
+                           const char *path,
+                           hsh_node ***stmts_out, size_t *n_out) {
+    parser ps;
+    ps_init(&ps, arena, src, len, path);
+
+    hsh_node **stmts = NULL;
+    size_t n = 0, cap = 0;
+
+    for (;;) {
+        token t = ps_peek(&ps);
+        if (t.kind == TOK_EOF)
+            break;
+        if (t.kind == TOK_SEMI) {
+            (void)ps_next(&ps);
+            continue;
+        }
+
+        hsh_node *stmt = parse_stmt(&ps);
+        if (!stmt) return -1;
+
+        if (n == cap) {
+            size_t ncap = cap ? cap * 2 : 16;
+            hsh_node **tmp = hsh_arena_alloc(arena, ncap * sizeof(*tmp));
+            if (!tmp) return -1;
+            if (n) memcpy(tmp, stmts, n * sizeof(*tmp));
+            stmts = tmp;
+            cap = ncap;
+        }
+        stmts[n++] = stmt;
+    }
+
+    *stmts_out = stmts;
+    *n_out = n;
+    return 0;
+}
+
+/* ===== function registry ===== */
+
+#define HSH_LANG_MAX_DEPTH 256
+
+static hsh_fn  **hsh_registry = NULL;   /* open addressing, NULL = empty */
+static unsigned  hsh_registry_cap = 0;
+static unsigned  hsh_registry_count = 0;
+static __thread int hsh_call_depth = 0;   /* per worker thread */
+
+static int hsh_spawn_default(const char *name);
+static void hsh_lang_define(hsh_fn *fn, hsh_prog *body, hsh_fn_attrs attrs);
+static int (*hsh_spawn)(const char *name) = hsh_spawn_default;
+
+static int hsh_registry_grow(void) {
+    unsigned cap = hsh_registry_cap ? hsh_registry_cap * 2 : 64;
+    hsh_fn **tab = calloc(cap, sizeof(*tab));
+    if (!tab) return -1;
+
+    for (unsigned i = 0; i < hsh_registry_cap; i++) {
+        hsh_fn *fn = hsh_registry[i];
+        if (!fn) continue;
+        unsigned j = hsh_name_hash_n(fn->name, strlen(fn->name)) & (cap - 1);
+        while (tab[j]) j = (j + 1) & (cap - 1);
+        tab[j] = fn;
+    }
+    free(hsh_registry);
+    hsh_registry = tab;
+    hsh_registry_cap = cap;
+    return 0;
+}
+
+hsh_fn *hsh_lang_lookup(const char *name) {
+    if ((hsh_registry_count + 1) * 2 > hsh_registry_cap &&
+        hsh_registry_grow() != 0)
+        return NULL;
+
+    unsigned mask = hsh_registry_cap - 1;
+    unsigned j = hsh_name_hash_n(name, strlen(name)) & mask;
+    while (hsh_registry[j]) {
+        if (strcmp(hsh_registry[j]->name, name) == 0)
+            return hsh_registry[j];
+        j = (j + 1) & mask;
+    }
+
+    hsh_fn *fn = calloc(1, sizeof(*fn));
+    if (!fn) return NULL;
+    fn->name = strdup(name);
+    if (!fn->name) {
+        free(fn);
+        return NULL;
+    }
+    fn->kind = HSH_FN_EXTERNAL;
+    hsh_registry[j] = fn;
+    hsh_registry_count++;
+    return fn;
+}
+
+int hsh_lang_register_native(const char *name,
+                             int (*handler)(char **args), char **args) {
+    hsh_fn *fn = hsh_lang_lookup(name);
+    if (!fn) return -1;
+    fn->kind = HSH_FN_NATIVE;
+    fn->handler = handler;
+    fn->args = args;
+    return 0;
+}
+
+int hsh_lang_register_compiled(const char *name, int (*code)(void),
+                               hsh_fn_attrs attrs, uint64_t key) {
+    hsh_fn *fn = hsh_lang_lookup(name);
+    if (!fn) return -1;
+    hsh_lang_define(fn, NULL, attrs);
+    fn->code = code;
+    fn->memo_key = key;
+    return 0;
+}
+
+void hsh_lang_set_spawn(int (*spawn)(const char *name)) {
+    hsh_spawn = spawn ? spawn : hsh_spawn_default;
+}
+
+static int hsh_spawn_default(const char *name) {
+    int status = 0;
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execlp(name, name, (char *)NULL);
+        fprintf(stderr, "hsh-lang: %s: not found\n", name);
+        _exit(127);
+    }
+    if (pid < 0) {
+        perror("hsh-lang: fork");
+        return 1;
+    }
+    if (waitpid(pid, &status, 0) < 0)
+        return 1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int hsh_lang_call_user(hsh_fn *fn) {
+    if (hsh_call_depth >= HSH_LANG_MAX_DEPTH) {
+        fprintf(stderr, "hsh-lang: %s(): call depth exceeded\n", fn->name);
+        return 1;
+    }
+    hsh_call_depth++;
+    int st = fn->code ? fn->code() : hsh_lang_run(fn->body);
+    hsh_call_depth--;
+    return st;
+}
+
+int hsh_lang_call(hsh_fn *fn) {
+    if (!fn) return 1;
+
+    switch (fn->kind) {
+    case HSH_FN_NATIVE:
+        return fn->handler(fn->args) ? 0 : 1;
+
+    case HSH_FN_USER:
+        return fn->attrs.ttl_ms ? hsh_memo_call(fn) : hsh_lang_call_user(fn);
+
+    default:
+        return hsh_spawn(fn->name);
+    }
+}
+
+/* ===== parallel calls =====
+ * The calling thread works through the group together with up to
+ * HSH_LANG_MAX_WORKERS - 1 helper threads; each takes the next unclaimed
+ * call until none are left. Since the caller never just blocks on the
+ * pool, nested groups (a user fn with its own '&') cannot starve it.
+ */
+
+typedef struct {
+    hsh_fn *const *fns;
+    int           *status;
+    unsigned       n;
+    unsigned       next;     /* next call to claim, atomic */
+} hsh_par_group;
+
+static __thread int hsh_par_depth = 0;
+
+int hsh_lang_in_par(void) {
+    return hsh_par_depth > 0;
+}
+
+static void *hsh_par_worker(void *arg) {
+    hsh_par_group *g = arg;
+    unsigned i;
+
+    hsh_par_depth++;
+    while ((i = __atomic_fetch_add(&g->next, 1, __ATOMIC_RELAXED)) < g->n)
+        g->status[i] = hsh_lang_call(g->fns[i]);
+    hsh_par_depth--;
+    return NULL;
+}
+
+int hsh_lang_call_par(hsh_fn *const *fns, unsigned n) {
+    if (n == 0) return 0;
+    if (n == 1) return hsh_lang_call(fns[0]);
+
+    int *status = calloc(n, sizeof(*status));
+    if (!status) return 1;
+
+    hsh_par_group g = { fns, status, n, 0 };
+    pthread_t tids[HSH_LANG_MAX_WORKERS - 1];
+    unsigned nthreads = n - 1;
+    if (nthreads > HSH_LANG_MAX_WORKERS - 1)
+        nthreads = HSH_LANG_MAX_WORKERS - 1;
+
+    /* children started by one call must not inherit buffered output */
+    fflush(NULL);
+
+    unsigned started = 0;
+    while (started < nthreads &&
+           pthread_create(&tids[started], NULL, hsh_par_worker, &g) == 0)
+        started++;
+
+    hsh_par_worker(&g);
+    for (unsigned i = 0; i < started; i++)
+        pthread_join(tids[i], NULL);
+
+    int st = 0;
+    for (unsigned i = 0; i < n; i++) {
+        if (status[i] != 0) {
+            st = status[i];
+            break;
+        }
+    }
+    free(status);
+    return st;
+}
+
 /* ===== evaluation ===== */
 
-/* stub: no builtins; just echo the call */
 static int eval_call(hsh_node *n) {
     if (!n || n->kind != HSH_NODE_CALL) return 1;
-    fprintf(stdout, "called %s()\n", n->u.call.name);
-    return 0;
+    return hsh_lang_call(hsh_lang_lookup(n->u.call.name));
 }
 
 static int eval_node(hsh_node *n) {
@@ -262,9 +843,371 @@ static int eval_node(hsh_node *n) {
         }
     }
 
+    if (n->kind == HSH_NODE_PAR) {
+        hsh_fn **fns = calloc(n->u.par.nkids, sizeof(*fns));
+        if (!fns) return 1;
+        for (size_t i = 0; i < n->u.par.nkids; i++)
+            fns[i] = hsh_lang_lookup(n->u.par.kids[i]->u.call.name);
+        int st = hsh_lang_call_par(fns, (unsigned)n->u.par.nkids);
+        free(fns);
+        return st;
+    }
+
+    if (n->kind == HSH_NODE_FN) {
+        /* definitions always go through the compiler */
+        hsh_prog *p = hsh_lang_compile(n);
+        hsh_prog_free(p);
+        return p ? 0 : 1;
+    }
+
     return 1;
 }
 
 int hsh_lang_eval(hsh_node *node) {
     return eval_node(node);
 }
+
+/* ===== bytecode compiler ===== */
+
+/* names are interned by the arena: hash and compare the pointer */
+static unsigned hsh_ptr_hash(const char *s) {
+    unsigned long v = (unsigned long)(size_t)s;
+    v ^= v >> 17;
+    v *= 0x9e3779b1u;
+    return (unsigned)(v ^ (v >> 15));
+}
+
+static int prog_emit(hsh_prog *p, unsigned op, unsigned arg) {
+    if (p->len == p->cap) {
+        unsigned cap = p->cap ? p->cap * 2 : 16;
+        hsh_insn *tmp = realloc(p->code, cap * sizeof(*tmp));
+        if (!tmp) return -1;
+        p->code = tmp;
+        p->cap = cap;
+    }
+    p->code[p->len].op = op;
+    p->code[p->len].arg = arg;
+    p->len++;
+    return (int)(p->len - 1);
+}
+
+static int prog_index_grow(hsh_prog *p) {
+    unsigned cap = p->index_cap ? p->index_cap * 2 : 16;
+    unsigned *idx = calloc(cap, sizeof(*idx));
+    if (!idx) return -1;
+
+    for (unsigned i = 0; i < p->nnames; i++) {
+        unsigned j = hsh_ptr_hash(p->names[i]) & (cap - 1);
+        while (idx[j]) j = (j + 1) & (cap - 1);
+        idx[j] = i + 1;
+    }
+    free(p->index);
+    p->index = idx;
+    p->index_cap = cap;
+    return 0;
+}
+
+/* returns the names[] index for name, adding it if new; -1 on error */
+static long prog_intern(hsh_prog *p, const char *name) {
+    if ((p->nnames + 1) * 2 > p->index_cap && prog_index_grow(p) != 0)
+        return -1;
+
+    unsigned mask = p->index_cap - 1;
+    unsigned j = hsh_ptr_hash(name) & mask;
+    while (p->index[j]) {
+        if (p->names[p->index[j] - 1] == name)
+            return (long)p->index[j] - 1;
+        j = (j + 1) & mask;
+    }
+
+    if (p->nnames == p->names_cap) {
+        unsigned cap = p->names_cap ? p->names_cap * 2 : 8;
+        const char **tmp = realloc(p->names, cap * sizeof(*tmp));
+        if (!tmp) return -1;
+        p->names = tmp;
+        p->names_cap = cap;
+    }
+    p->names[p->nnames] = name;
+    p->index[j] = ++p->nnames;
+    return (long)p->nnames - 1;
+}
+
+static int compile_node(hsh_prog *p, const hsh_node *n) {
+    const hsh_node **spine = NULL;
+    size_t depth = 0, cap = 0;
+    int rc = -1;
+
+    /* chains are left-deep: collect the left spine iteratively */
+    while (n && n->kind == HSH_NODE_CHAIN) {
+        if (depth == cap) {
+            size_t ncap = cap ? cap * 2 : 16;
+            const hsh_node **tmp = realloc(spine, ncap * sizeof(*tmp));
+            if (!tmp) goto out;
+            spine = tmp;
+            cap = ncap;
+        }
+        spine[depth++] = n;
+        n = n->u.chain.left;
+    }
+
+    if (n && n->kind == HSH_NODE_PAR) {
+        /* PAR n, then n CALL operands that the VM hands to the pool */
+        if (prog_emit(p, HSH_OP_PAR, (unsigned)n->u.par.nkids) < 0) goto out;
+        for (size_t i = 0; i < n->u.par.nkids; i++) {
+            long idx = prog_intern(p, n->u.par.kids[i]->u.call.name);
+            if (idx < 0 || prog_emit(p, HSH_OP_CALL, (unsigned)idx) < 0)
+                goto out;
+        }
+    } else {
+        if (!n || n->kind != HSH_NODE_CALL) goto out;
+
+        long idx = prog_intern(p, n->u.call.name);
+        if (idx < 0 || prog_emit(p, HSH_OP_CALL, (unsigned)idx) < 0)
+            goto out;
+    }
+
+    /* innermost chain first: test status, skip its right side if needed */
+    while (depth > 0) {
+        const hsh_node *c = spine[--depth];
+        unsigned op = (c->u.chain.op == HSH_CHAIN_ON_SUCCESS)
+                      ? HSH_OP_JUMP_IF_ERR : HSH_OP_JUMP_IF_OK;
+        int jmp = prog_emit(p, op, 0);
+        if (jmp < 0) goto out;
+        if (compile_node(p, c->u.chain.right) != 0) goto out;
+        p->code[jmp].arg = p->len;
+    }
+    rc = 0;
+
+out:
+    free(spine);
+    return rc;
+}
+
+/* resolve every name once; names[] then points at the registry's copy,
+ * so the program no longer depends on the arena */
+int hsh_prog_link(hsh_prog *p) {
+    p->fns = calloc(p->nnames ? p->nnames : 1, sizeof(*p->fns));
+    if (!p->fns) return -1;
+
+    for (unsigned i = 0; i < p->nnames; i++) {
+        p->fns[i] = hsh_lang_lookup(p->names[i]);
+        if (!p->fns[i]) return -1;
+        p->names[i] = p->fns[i]->name;
+    }
+    free(p->index);
+    p->index = NULL;
+    p->index_cap = 0;
+    return 0;
+}
+
+static hsh_prog *prog_build(const hsh_node *const *stmts, size_t n) {
+    hsh_prog *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+
+    for (size_t i = 0; i < n; i++) {
+        if (compile_node(p, stmts[i]) != 0) {
+            hsh_prog_free(p);
+            return NULL;
+        }
+    }
+    if (prog_emit(p, HSH_OP_HALT, 0) < 0 || hsh_prog_link(p) != 0) {
+        hsh_prog_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/* a redefinition replaces the body and drops any cached result;
+ * callers keep the same entry */
+static void hsh_lang_define(hsh_fn *fn, hsh_prog *body, hsh_fn_attrs attrs) {
+    if (fn->kind == HSH_FN_USER)
+        hsh_prog_free(fn->body);
+    hsh_memo_forget(fn);
+    fn->kind = HSH_FN_USER;
+    fn->body = body;
+    fn->code = NULL;
+    fn->memo_key = 0;
+    fn->attrs = attrs;
+}
+
+hsh_prog *hsh_lang_compile(const hsh_node *node) {
+    if (node && node->kind == HSH_NODE_FN) {
+        hsh_prog *body = prog_build((const hsh_node *const *)node->u.fn.body,
+                                    node->u.fn.nbody);
+        hsh_fn *fn = body ? hsh_lang_lookup(node->u.fn.name) : NULL;
+        if (!fn) {
+            hsh_prog_free(body);
+            return NULL;
+        }
+        hsh_lang_define(fn, body, node->u.fn.attrs);
+        return prog_build(NULL, 0);
+    }
+
+    return prog_build(&node, 1);
+}
+
+/* ===== whole scripts ===== */
+
+hsh_script *hsh_script_new(unsigned nfns) {
+    hsh_script *sc = calloc(1, sizeof(*sc));
+    if (!sc) return NULL;
+    sc->fns = calloc(nfns ? nfns : 1, sizeof(*sc->fns));
+    sc->bodies = calloc(nfns ? nfns : 1, sizeof(*sc->bodies));
+    sc->attrs = calloc(nfns ? nfns : 1, sizeof(*sc->attrs));
+    if (!sc->fns || !sc->bodies || !sc->attrs) {
+        hsh_script_free(sc);
+        return NULL;
+    }
+    sc->nfns = nfns;
+    return sc;
+}
+
+hsh_script *hsh_lang_compile_script(hsh_node *const *stmts, size_t n) {
+    const hsh_node **top = malloc((n ? n : 1) * sizeof(*top));
+    if (!top) return NULL;
+
+    unsigned nfns = 0;
+    size_t ntop = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (stmts[i]->kind == HSH_NODE_FN)
+            nfns++;
+        else
+            top[ntop++] = stmts[i];
+    }
+
+    hsh_script *sc = hsh_script_new(nfns);
+    if (!sc) goto fail;
+
+    unsigned k = 0;
+    for (size_t i = 0; i < n; i++) {
+        const hsh_node *s = stmts[i];
+        if (s->kind != HSH_NODE_FN)
+            continue;
+        sc->bodies[k] = prog_build((const hsh_node *const *)s->u.fn.body,
+                                   s->u.fn.nbody);
+        sc->fns[k] = hsh_lang_lookup(s->u.fn.name);
+        sc->attrs[k] = s->u.fn.attrs;
+        if (!sc->bodies[k] || !sc->fns[k])
+            goto fail;
+        k++;
+    }
+
+    sc->main = prog_build(top, ntop);
+    if (!sc->main)
+        goto fail;
+    free(top);
+    return sc;
+
+fail:
+    free(top);
+    hsh_script_free(sc);
+    return NULL;
+}
+
+void hsh_script_define(hsh_script *sc) {
+    for (unsigned i = 0; i < sc->nfns; i++) {
+        if (sc->bodies[i]) {
+            hsh_lang_define(sc->fns[i], sc->bodies[i], sc->attrs[i]);
+            sc->bodies[i] = NULL;   /* the registry owns it now */
+        }
+    }
+}
+
+void hsh_script_free(hsh_script *sc) {
+    if (!sc) return;
+    for (unsigned i = 0; i < sc->nfns; i++)
+        hsh_prog_free(sc->bodies[i]);
+    free(sc->bodies);
+    free(sc->attrs);
+    free(sc->fns);
+    hsh_prog_free(sc->main);
+    free(sc);
+}
+
+void hsh_prog_free(hsh_prog *prog) {
+    if (!prog) return;
+    free(prog->fns);
+    free(prog->names);
+    free(prog->index);
+    free(prog->code);
+    free(prog);
+}
+
+/* ===== bytecode VM ===== */
+
+static int run_par(const hsh_prog *prog, const hsh_insn *ops, unsigned n) {
+    hsh_fn *local[HSH_LANG_MAX_WORKERS];
+    hsh_fn **fns = (n <= HSH_LANG_MAX_WORKERS) ? local
+                                               : malloc(n * sizeof(*fns));
+    if (!fns) return 1;
+
+    for (unsigned i = 0; i < n; i++)
+        fns[i] = prog->fns[ops[i].arg];
+    int st = hsh_lang_call_par(fns, n);
+    if (fns != local)
+        free(fns);
+    return st;
+}
+
+int hsh_lang_run(const hsh_prog *prog) {
+    const hsh_insn *code = prog->code;
+    unsigned pc = 0;
+    int st = 0;
+
+#if defined(__GNUC__)
+    /* computed goto: one indirect branch per instruction */
+    static void *const labels[] = {
+        [HSH_OP_CALL]        = &&op_call,
+        [HSH_OP_JUMP_IF_OK]  = &&op_jump_if_ok,
+        [HSH_OP_JUMP_IF_ERR] = &&op_jump_if_err,
+        [HSH_OP_PAR]         = &&op_par,
+        [HSH_OP_HALT]        = &&op_halt,
+    };
+#define DISPATCH() goto *labels[code[pc].op]
+
+    DISPATCH();
+
+op_call:
+    st = hsh_lang_call(prog->fns[code[pc].arg]);
+    pc++;
+    DISPATCH();
+
+op_jump_if_ok:
+    pc = (st == 0) ? code[pc].arg : pc + 1;
+    DISPATCH();
+
+op_jump_if_err:
+    pc = (st != 0) ? code[pc].arg : pc + 1;
+    DISPATCH();
+
+op_par:
+    st = run_par(prog, &code[pc + 1], code[pc].arg);
+    pc += code[pc].arg + 1;
+    DISPATCH();
+
+op_halt:
+    return st;
+#undef DISPATCH
+#else
+    for (;;) {
+        switch (code[pc].op) {
+        case HSH_OP_CALL:
+            st = hsh_lang_call(prog->fns[code[pc].arg]);
+            pc++;
+            break;
+        case HSH_OP_JUMP_IF_OK:
+            pc = (st == 0) ? code[pc].arg : pc + 1;
+            break;
+        case HSH_OP_JUMP_IF_ERR:
+            pc = (st != 0) ? code[pc].arg : pc + 1;
+            break;
+        case HSH_OP_PAR:
+            st = run_par(prog, &code[pc + 1], code[pc].arg);
+            pc += code[pc].arg + 1;
+            break;
+        default:
+            return st;
+        }
+    }
+#endif
+}
@@ -1,9 +1,14 @@
 #ifndef HSH_LANG_H
 #define HSH_LANG_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef enum {
     HSH_NODE_CALL,
-    HSH_NODE_CHAIN
+    HSH_NODE_CHAIN,
+    HSH_NODE_PAR,
+    HSH_NODE_FN
 } hsh_node_kind;
 
 typedef enum {
@@ -13,34 +18,197 @@ typedef enum {
 
 typedef struct hsh_node hsh_node;
 
+/* @cached(ttl=30s[, persist]) on an fn definition */
+typedef struct {
+    unsigned ttl_ms;    /* 0 = not cached */
+    int      persist;   /* also share results through the memo file */
+} hsh_fn_attrs;
+
 struct hsh_node {
     hsh_node_kind kind;
     union {
         struct {
-            char *name;  /* e.g. "do_network" */
+            const char *name;  /* e.g. "do_network", interned */
         } call;
         struct {
             hsh_chain_kind op;
             hsh_node *left;
             hsh_node *right;
         } chain;
+        struct {
+            hsh_node  **kids;  /* kids[0] & kids[1] & ... (all calls) */
+            size_t      nkids;
+        } par;
+        struct {
+            const char *name;  /* fn name() { body[0] body[1] ... } */
+            hsh_node  **body;
+            size_t      nbody;
+            hsh_fn_attrs attrs;
+        } fn;
     } u;
 };
 
-/* Parse a single statement:
+/* Arena for AST nodes and interned names.
+ * Everything parsed into an arena is released at once by hsh_arena_free;
+ * names are interned, so equal names are the same pointer.
+ * One arena can hold a whole script.
+ */
+typedef struct hsh_arena hsh_arena;
+
+hsh_arena  *hsh_arena_new(void);
+void        hsh_arena_free(hsh_arena *arena);
+void       *hsh_arena_alloc(hsh_arena *arena, size_t n);
+const char *hsh_arena_intern(hsh_arena *arena, const char *s, size_t len);
+
+/* Parse a single statement into arena:
  *   do_network()
  *   do_network() () next_step()
  *   do_network() )( handle_error()
+ *   fetch_a() & fetch_b() & fetch_c() )( report()
+ *   fn bring_up() { do_network() )( start_services() ; sys_info() }
+ *   @cached(ttl=30s) fn nginx_ok() { check_nginx() }
  * Returns NULL on syntax error.
  */
-hsh_node *hsh_lang_parse_stmt(const char *line);
+hsh_node *hsh_lang_parse_stmt(hsh_arena *arena, const char *line);
 
-/* Free AST */
-void hsh_lang_free(hsh_node *node);
+/* Parse a whole script: src[0..len) need not be NUL-terminated, so a
+ * mapped file can be passed as is. Statements may span lines and are
+ * separated by newlines or ';'; '#' starts a comment. Syntax errors are
+ * reported as path:line:col. Returns 0 and the statements (allocated in
+ * arena), or -1.
+ */
+int hsh_lang_parse_program(hsh_arena *arena, const char *src, size_t len,
+                           const char *path,
+                           hsh_node ***stmts_out, size_t *n_out);
 
 /* Evaluate AST:
  * 0 = success, non‑zero = failure
  */
 int hsh_lang_eval(hsh_node *node);
 
+/* ===== function registry =====
+ * Each call name resolves to one hsh_fn entry, created on first lookup as
+ * an external command. Natives and `fn` definitions update the entry in
+ * place, so programs resolve names once, when they are compiled, and
+ * still see definitions that come later.
+ */
+typedef struct hsh_prog hsh_prog;
+
+typedef enum {
+    HSH_FN_EXTERNAL,   /* run `name` through the spawn hook */
+    HSH_FN_NATIVE,     /* C handler */
+    HSH_FN_USER        /* fn name() { ... } */
+} hsh_fn_kind;
+
+typedef struct {
+    char        *name;
+    hsh_fn_kind  kind;
+    int        (*handler)(char **args);   /* NATIVE: returns 1 on success, */
+    char       **args;                    /* like a shell builtin */
+    hsh_prog    *body;                    /* USER */
+    int        (*code)(void);             /* USER, built by --compile */
+    uint64_t     memo_key;                /* USER, --compile: body hash */
+    hsh_fn_attrs attrs;                   /* USER */
+    struct hsh_memo *memo;                /* last cached result, if any */
+} hsh_fn;
+
+/* Find or create the entry for name. NULL on allocation failure. */
+hsh_fn *hsh_lang_lookup(const char *name);
+
+/* Bind name to handler(args). 0 on success. */
+int hsh_lang_register_native(const char *name,
+                             int (*handler)(char **args), char **args);
+
+/* Define name as an ahead-of-time compiled fn: code() returns its status.
+ * key identifies the body for persisted @cached results. 0 on success.
+ */
+int hsh_lang_register_compiled(const char *name, int (*code)(void),
+                               hsh_fn_attrs attrs, uint64_t key);
+
+/* How external names are run; returns the exit status. The default
+ * forks and execs the name with no arguments.
+ */
+void hsh_lang_set_spawn(int (*spawn)(const char *name));
+
+/* Call a resolved entry: 0 = success, non-zero = failure.
+ * Cached USER fns go through the memo table (lang_memo.h).
+ */
+int hsh_lang_call(hsh_fn *fn);
+
+/* Run a USER fn's body, bypassing its cache. */
+int hsh_lang_call_user(hsh_fn *fn);
+
+/* Run n entries concurrently and wait for all of them. Returns 0 when
+ * every call succeeded, otherwise the first failing status in order.
+ */
+#define HSH_LANG_MAX_WORKERS 16
+
+int hsh_lang_call_par(hsh_fn *const *fns, unsigned n);
+
+/* Non-zero while the calling thread is working on a '&' group; other
+ * threads may be running calls too, so shared shell state is off limits.
+ */
+int hsh_lang_in_par(void);
+
+/* ===== bytecode =====
+ * A statement compiles to a flat instruction array that runs on an
+ * iterative dispatch loop. CALL carries an index into prog->fns, resolved
+ * when the program is compiled; prog->names holds the matching names.
+ * Compiling an `fn` statement defines the function and yields an empty
+ * program.
+ */
+typedef enum {
+    HSH_OP_CALL,         /* status = call fns[arg] */
+    HSH_OP_JUMP_IF_OK,   /* if status == 0, pc = arg */
+    HSH_OP_JUMP_IF_ERR,  /* if status != 0, pc = arg */
+    HSH_OP_PAR,          /* the next arg CALLs run concurrently */
+    HSH_OP_HALT
+} hsh_opcode;
+
+typedef struct {
+    unsigned op;
+    unsigned arg;
+} hsh_insn;
+
+struct hsh_prog {
+    hsh_insn     *code;
+    unsigned      len;
+    unsigned      cap;
+    hsh_fn      **fns;
+    const char  **names;
+    unsigned      nnames;
+    unsigned      names_cap;
+    unsigned     *index;     /* open-addressing name -> names[] slot + 1 */
+    unsigned      index_cap;
+};
+
+/* Compile AST to bytecode. Returns NULL on allocation failure. */
+hsh_prog *hsh_lang_compile(const hsh_node *node);
+
+/* Run bytecode: 0 = success, non-zero = failure */
+int hsh_lang_run(const hsh_prog *prog);
+
+void hsh_prog_free(hsh_prog *prog);
+
+/* Resolve prog->names[] into prog->fns[] through the registry. */
+int hsh_prog_link(hsh_prog *prog);
+
+/* ===== whole scripts =====
+ * A compiled file: its fn definitions and one program for the top-level
+ * statements. Definitions are hoisted: hsh_script_define installs all of
+ * them before main runs, later definitions of a name winning.
+ */
+typedef struct {
+    hsh_fn      **fns;      /* fns[i] is defined as bodies[i] */
+    hsh_prog    **bodies;
+    hsh_fn_attrs *attrs;
+    unsigned      nfns;
+    hsh_prog     *main;
+} hsh_script;
+
+hsh_script *hsh_script_new(unsigned nfns);
+hsh_script *hsh_lang_compile_script(hsh_node *const *stmts, size_t n);
+void        hsh_script_define(hsh_script *script);
+void        hsh_script_free(hsh_script *script);
+
 #endif
@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "lang_aot.h"
+
+/* ===== called names ===== */
+
+/* interned names are unique pointers, so a pointer set is enough */
+typedef struct {
+    const char **names;
+    size_t       n;
+    size_t       cap;
+    size_t      *index;     /* open addressing, names[] slot + 1 */
+    size_t       index_cap;
+} aot_names;
+
+static size_t aot_ptr_hash(const char *s) {
+    size_t v = (size_t)s;
+    v ^= v >> 17;
+    v *= 0x9e3779b1u;
+    return v ^ (v >> 15);
+}
+
+static long aot_name(aot_names *t, const char *name) {
+    if ((t->n + 1) * 2 > t->index_cap) {
+        size_t cap = t->index_cap ? t->index_cap * 2 : 64;
+        size_t *idx = calloc(cap, sizeof(*idx));
+        if (!idx) return -1;
+        for (size_t i = 0; i < t->n; i++) {
+            size_t j = aot_ptr_hash(t->names[i]) & (cap - 1);
+            while (idx[j]) j = (j + 1) & (cap - 1);
+            idx[j] = i + 1;
+        }
+        free(t->index);
+        t->index = idx;
+        t->index_cap = cap;
+    }
+
+    size_t mask = t->index_cap - 1;
+    size_t j = aot_ptr_hash(name) & mask;
+    while (t->index[j]) {
+        if (t->names[t->index[j] - 1] == name)
+            return (long)t->index[j] - 1;
+        j = (j + 1) & mask;
+    }
+
+    if (t->n == t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 32;
+        const char **tmp = realloc(t->names, cap * sizeof(*tmp));
+        if (!tmp) return -1;
+        t->names = tmp;
+        t->cap = cap;
+    }
+    t->names[t->n] = name;
+    t->index[j] = ++t->n;
+    return (long)t->n - 1;
+}
+
+/* ===== emitting ===== */
+
+/* Group := CALL or PAR of calls */
+static int emit_group(FILE *o, aot_names *t, const hsh_node *g, int ind) {
+    if (g->kind == HSH_NODE_CALL) {
+        long i = aot_name(t, g->u.call.name);
+        if (i < 0) return -1;
+        fprintf(o, "%*sst = hsh_lang_call(F[%ld]);   /* %s() */\n",
+                ind, "", i, g->u.call.name);
+        return 0;
+    }
+
+    fprintf(o, "%*s{\n%*s    hsh_fn *g[] = {", ind, "", ind, "");
+    for (size_t k = 0; k < g->u.par.nkids; k++) {
+        long i = aot_name(t, g->u.par.kids[k]->u.call.name);
+        if (i < 0) return -1;
+        fprintf(o, "%s F[%ld]", k ? "," : "", i);
+    }
+    fprintf(o, " };\n%*s    st = hsh_lang_call_par(g, %zu);\n%*s}\n",
+            ind, "", g->u.par.nkids, ind, "");
+    return 0;
+}
+
+/* chains are left-deep: emit the innermost call, then one `if` per link */
+static int emit_expr(FILE *o, aot_names *t, const hsh_node *n, int ind) {
+    const hsh_node **spine = NULL;
+    size_t depth = 0, cap = 0;
+    int rc = -1;
+
+    while (n->kind == HSH_NODE_CHAIN) {
+        if (depth == cap) {
+            size_t ncap = cap ? cap * 2 : 16;
+            const hsh_node **tmp = realloc(spine, ncap * sizeof(*tmp));
+            if (!tmp) goto out;
+            spine = tmp;
+            cap = ncap;
+        }
+        spine[depth++] = n;
+        n = n->u.chain.left;
+    }
+
+    if (emit_group(o, t, n, ind) != 0) goto out;
+    while (depth > 0) {
+        const hsh_node *c = spine[--depth];
+        fprintf(o, "%*sif (st %s 0) {\n", ind, "",
+                c->u.chain.op == HSH_CHAIN_ON_SUCCESS ? "==" : "!=");
+        if (emit_group(o, t, c->u.chain.right, ind + 4) != 0) goto out;
+        fprintf(o, "%*s}\n", ind, "");
+    }
+    rc = 0;
+
+out:
+    free(spine);
+    return rc;
+}
+
+/* ===== body hash for persisted @cached results ===== */
+
+static uint64_t aot_mix(uint64_t h, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t aot_hash_group(uint64_t h, const hsh_node *g) {
+    if (g->kind == HSH_NODE_CALL)
+        return aot_mix(h, g->u.call.name, strlen(g->u.call.name) + 1);
+    h = aot_mix(h, "&", 1);
+    for (size_t k = 0; k < g->u.par.nkids; k++)
+        h = aot_hash_group(h, g->u.par.kids[k]);
+    return aot_mix(h, ";", 1);
+}
+
+static uint64_t aot_hash_expr(uint64_t h, const hsh_node *n) {
+    if (n->kind != HSH_NODE_CHAIN)
+        return aot_hash_group(h, n);
+    h = aot_hash_expr(h, n->u.chain.left);
+    h = aot_mix(h, n->u.chain.op == HSH_CHAIN_ON_SUCCESS ? "+" : "-", 1);
+    return aot_hash_group(h, n->u.chain.right);
+}
+
+static uint64_t aot_fn_key(const hsh_node *fn) {
+    uint64_t h = 14695981039346656037ull;
+    h = aot_mix(h, fn->u.fn.name, strlen(fn->u.fn.name) + 1);
+    for (size_t i = 0; i < fn->u.fn.nbody; i++)
+        h = aot_mix(aot_hash_expr(h, fn->u.fn.body[i]), "\n", 1);
+    return h ? h : 1;
+}
+
+int hsh_lang_emit_c(FILE *o, hsh_node *const *stmts, size_t n,
+                    const char *srcpath) {
+    aot_names t = { NULL, 0, 0, NULL, 0 };
+    int rc = -1;
+
+    /* the body goes to a temp file first: F[] must be sized before it */
+    FILE *body = tmpfile();
+    if (!body) {
+        perror("hsh-lang: tmpfile");
+        return -1;
+    }
+
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        const hsh_node *s = stmts[i];
+        if (s->kind != HSH_NODE_FN)
+            continue;
+        fprintf(body, "/* fn %s() */\nstatic int hsl_fn_%zu(void) {\n"
+                      "    int st = 0;\n", s->u.fn.name, k++);
+        for (size_t j = 0; j < s->u.fn.nbody; j++)
+            if (emit_expr(body, &t, s->u.fn.body[j], 4) != 0) goto out;
+        fprintf(body, "    return st;\n}\n\n");
+    }
+
+    fprintf(body, "int main(void) {\n    int st = 0;\n\n"
+                  "    hsh_lang_init();\n"
+                  "    for (size_t i = 0; i < sizeof(F) / sizeof(F[0]); i++) {\n"
+                  "        if (!(F[i] = hsh_lang_lookup(names[i]))) {\n"
+                  "            fprintf(stderr, \"%%s: out of memory\\n\", names[i]);\n"
+                  "            return 1;\n"
+                  "        }\n"
+                  "    }\n");
+
+    /* fn definitions are hoisted, the same as in the interpreter */
+    k = 0;
+    for (size_t i = 0; i < n; i++) {
+        const hsh_node *s = stmts[i];
+        if (s->kind != HSH_NODE_FN)
+            continue;
+        fprintf(body, "    hsh_lang_register_compiled(\"%s\", hsl_fn_%zu, "
+                      "(hsh_fn_attrs){ %uu, %d }, 0x%016llxull);\n",
+                s->u.fn.name, k++, s->u.fn.attrs.ttl_ms,
+                s->u.fn.attrs.persist,
+                (unsigned long long)aot_fn_key(s));
+    }
+    fputc('\n', body);
+
+    for (size_t i = 0; i < n; i++)
+        if (stmts[i]->kind != HSH_NODE_FN &&
+            emit_expr(body, &t, stmts[i], 4) != 0)
+            goto out;
+    fprintf(body, "    return st;\n}\n");
+
+    fprintf(o, "/* Generated by hsh-lang --compile from %s; do not edit. */\n"
+               "#include <stdio.h>\n\n"
+               "#include \"lang.h\"\n#include \"lang_rt.h\"\n\n",
+            srcpath);
+    fprintf(o, "static const char *const names[] = {\n");
+    for (size_t i = 0; i < t.n; i++)
+        fprintf(o, "    \"%s\",\n", t.names[i]);
+    if (t.n == 0)
+        fprintf(o, "    NULL\n");
+    fprintf(o, "};\nstatic hsh_fn *F[%zu];\n\n", t.n);
+
+    /* fns that are declared before use keep the C file order free */
+    k = 0;
+    for (size_t i = 0; i < n; i++)
+        if (stmts[i]->kind == HSH_NODE_FN)
+            fprintf(o, "static int hsl_fn_%zu(void);\n", k++);
+    if (k)
+        fputc('\n', o);
+
+    rewind(body);
+    char buf[8192];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), body)) > 0)
+        fwrite(buf, 1, got, o);
+    rc = ferror(o) ? -1 : 0;
+
+out:
+    fclose(body);
+    free(t.names);
+    free(t.index);
+    return rc;
+}
+
+/* ===== building ===== */
+
+/* runtime dir: $HSH_LANG_RTDIR, else ../lib/hsh relative to hsh-lang */
+#define AOT_RTDIR_MAX (PATH_MAX + sizeof("/../lib/hsh"))
+
+static int aot_rtdir(char *out, size_t outsz) {
+    const char *env = getenv("HSH_LANG_RTDIR");
+    if (env && *env)
+        return (size_t)snprintf(out, outsz, "%s", env) < outsz ? 0 : -1;
+
+    char exe[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0)
+        return -1;
+    exe[len] = '\0';
+
+    char *slash = strrchr(exe, '/');
+    if (!slash)
+        return -1;
+    *slash = '\0';
+    return (size_t)snprintf(out, outsz, "%s/../lib/hsh", exe) < outsz ? 0 : -1;
+}
+
+static int aot_run(char *const argv[]) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(argv[0], argv);
+        fprintf(stderr, "hsh-lang: %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    if (pid < 0) {
+        perror("hsh-lang: fork");
+        return -1;
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR) return -1;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+int hsh_lang_aot_build(hsh_node *const *stmts, size_t n,
+                       const char *srcpath, const char *outpath) {
+    size_t olen = strlen(outpath);
+    if (olen > 2 && strcmp(outpath + olen - 2, ".c") == 0) {
+        FILE *o = fopen(outpath, "w");
+        if (!o) {
+            perror("hsh-lang: fopen");
+            return -1;
+        }
+        int rc = hsh_lang_emit_c(o, stmts, n, srcpath);
+        return (fclose(o) != 0 || rc != 0) ? -1 : 0;
+    }
+
+    char rt[AOT_RTDIR_MAX], lib[AOT_RTDIR_MAX + 32], inc[AOT_RTDIR_MAX + 32];
+    if (aot_rtdir(rt, sizeof(rt)) != 0) {
+        fprintf(stderr, "hsh-lang: cannot locate the runtime; "
+                        "set HSH_LANG_RTDIR\n");
+        return -1;
+    }
+    snprintf(lib, sizeof(lib), "%s/libhsh-lang.a", rt);
+    snprintf(inc, sizeof(inc), "-I%s/include", rt);
+    if (access(lib, R_OK) != 0) {
+        fprintf(stderr, "hsh-lang: %s: %s (set HSH_LANG_RTDIR)\n",
+                lib, strerror(errno));
+        return -1;
+    }
+
+    char csrc[] = "/tmp/hsh-lang-XXXXXX.c";
+    int fd = mkstemps(csrc, 2);
+    if (fd < 0) {
+        perror("hsh-lang: mkstemps");
+        return -1;
+    }
+    FILE *o = fdopen(fd, "w");
+    if (!o) {
+        perror("hsh-lang: fdopen");
+        close(fd);
+        unlink(csrc);
+        return -1;
+    }
+    int rc = hsh_lang_emit_c(o, stmts, n, srcpath);
+    if (fclose(o) != 0)
+        rc = -1;
+
+    if (rc == 0) {
+        const char *cc = getenv("CC");
+        char *argv[] = {
+            (char *)(cc && *cc ? cc : "cc"), "-O2", "-o", (char *)outpath,
+            csrc, inc, lib, "-pthread", NULL
+        };
+        rc = aot_run(argv);
+        if (rc != 0)
+            fprintf(stderr, "hsh-lang: building %s failed\n", outpath);
+    }
+    unlink(csrc);
+    return rc;
+}
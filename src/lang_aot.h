@@ -0,0 +1,26 @@
+#ifndef HSH_LANG_AOT_H
+#define HSH_LANG_AOT_H
+
+#include <stdio.h>
+
+#include "lang.h"
+
+/* Ahead-of-time compilation: hsh-lang --compile script.hsl -o script
+ *
+ * A parsed script becomes one C file: each fn is a C function, chains
+ * are plain if statements and '&' groups call hsh_lang_call_par. It is
+ * built with $CC (default cc) against libhsh-lang.a, found in
+ * $HSH_LANG_RTDIR or in ../lib/hsh next to the hsh-lang binary.
+ */
+
+/* Write the C translation of stmts to out. 0 on success. */
+int hsh_lang_emit_c(FILE *out, hsh_node *const *stmts, size_t n,
+                    const char *srcpath);
+
+/* Emit and build an executable at outpath; an outpath ending in ".c"
+ * just keeps the generated source. 0 on success.
+ */
+int hsh_lang_aot_build(hsh_node *const *stmts, size_t n,
+                       const char *srcpath, const char *outpath);
+
+#endif
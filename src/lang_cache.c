@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lang_cache.h"
+
+/* bump when the opcode set or the record layout changes */
+#define HSH_LC_MAGIC "HSHLC003"
+
+struct hsh_lc_header {
+    char     magic[8];
+    uint64_t total_size;
+    int64_t  ino;          /* identity of the source file */
+    int64_t  size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint32_t nfns;
+    uint32_t pad;
+    /* followed by nfns fn records, then the record for main:
+     *   u32 fnlen, fn name + NUL   (fnlen 0 and no name for main)
+ *   u32 ttl_ms, u32 persist    (fns only)
+     *   u32 nnames, nnames * { u32 len, name + NUL }
+     *   u32 ninsns, ninsns * { u32 op, u32 arg }
+     */
+};
+
+int hsh_lang_cache_path(const char *srcpath, char *out, size_t outsz) {
+    const char *base = strrchr(srcpath, '/');
+    int dirlen = base ? (int)(base - srcpath) + 1 : 0;
+    base = base ? base + 1 : srcpath;
+
+    int n = snprintf(out, outsz, "%.*s.%s.hslc", dirlen, srcpath, base);
+    return (n < 0 || (size_t)n >= outsz) ? -1 : 0;
+}
+
+static void hsh_lc_src(struct hsh_lc_header *h, const struct stat *st) {
+    h->ino = (int64_t)st->st_ino;
+    h->size = (int64_t)st->st_size;
+    h->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    h->mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+}
+
+/* ----- reading ----- */
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+} hsh_lc_cursor;
+
+static int lc_u32(hsh_lc_cursor *c, uint32_t *v) {
+    if ((size_t)(c->end - c->p) < sizeof(*v)) return -1;
+    memcpy(v, c->p, sizeof(*v));
+    c->p += sizeof(*v);
+    return 0;
+}
+
+/* a NUL-terminated string of len bytes, pointing into the mapping */
+static const char *lc_str(hsh_lc_cursor *c, uint32_t len) {
+    if ((size_t)(c->end - c->p) < (size_t)len + 1 || c->p[len] != '\0')
+        return NULL;
+    const char *s = (const char *)c->p;
+    c->p += len + 1;
+    return s;
+}
+
+/* every operand must stay inside the program, and it must end in HALT */
+static int lc_check(const hsh_prog *p) {
+    if (p->len == 0 || p->code[p->len - 1].op != HSH_OP_HALT)
+        return -1;
+
+    for (unsigned pc = 0; pc < p->len; pc++) {
+        const hsh_insn *in = &p->code[pc];
+        switch (in->op) {
+        case HSH_OP_CALL:
+            if (in->arg >= p->nnames) return -1;
+            break;
+        case HSH_OP_JUMP_IF_OK:
+        case HSH_OP_JUMP_IF_ERR:
+            if (in->arg >= p->len) return -1;
+            break;
+        case HSH_OP_PAR:
+            if (in->arg >= p->len - pc - 1) return -1;
+            for (unsigned i = 1; i <= in->arg; i++)
+                if (p->code[pc + i].op != HSH_OP_CALL) return -1;
+            break;
+        case HSH_OP_HALT:
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static hsh_prog *lc_read_prog(hsh_lc_cursor *c) {
+    uint32_t nnames, len;
+    hsh_prog *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+
+    if (lc_u32(c, &nnames) != 0 || nnames > (size_t)(c->end - c->p))
+        goto bad;
+    p->names = calloc(nnames ? nnames : 1, sizeof(*p->names));
+    if (!p->names) goto bad;
+    p->names_cap = nnames;
+    for (uint32_t i = 0; i < nnames; i++) {
+        uint32_t n;
+        if (lc_u32(c, &n) != 0 || !(p->names[i] = lc_str(c, n)))
+            goto bad;
+        p->nnames++;
+    }
+
+    if (lc_u32(c, &len) != 0 ||
+        len > (size_t)(c->end - c->p) / sizeof(hsh_insn))
+        goto bad;
+    p->code = malloc((len ? len : 1) * sizeof(hsh_insn));
+    if (!p->code) goto bad;
+    memcpy(p->code, c->p, len * sizeof(hsh_insn));
+    c->p += len * sizeof(hsh_insn);
+    p->len = p->cap = len;
+
+    /* names[] still point into the mapping until they are linked */
+    if (lc_check(p) != 0 || hsh_prog_link(p) != 0)
+        goto bad;
+    return p;
+
+bad:
+    hsh_prog_free(p);
+    return NULL;
+}
+
+hsh_script *hsh_lang_cache_load(const char *cachepath, const struct stat *src) {
+    int fd = open(cachepath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(struct hsh_lc_header)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const struct hsh_lc_header *h = map;
+    struct hsh_lc_header want;
+    hsh_lc_src(&want, src);
+
+    hsh_script *sc = NULL;
+    if (memcmp(h->magic, HSH_LC_MAGIC, sizeof(h->magic)) != 0 ||
+        h->total_size != (uint64_t)st.st_size ||
+        h->ino != want.ino || h->size != want.size ||
+        h->mtime_sec != want.mtime_sec || h->mtime_nsec != want.mtime_nsec ||
+        h->nfns > (uint64_t)st.st_size)
+        goto out;
+
+    hsh_lc_cursor c = { (const unsigned char *)(h + 1),
+                        (const unsigned char *)map + st.st_size };
+
+    sc = hsh_script_new(h->nfns);
+    if (!sc) goto out;
+
+    for (uint32_t i = 0; i < h->nfns; i++) {
+        uint32_t n, ttl, persist;
+        const char *name;
+        if (lc_u32(&c, &n) != 0 || n == 0 || !(name = lc_str(&c, n)) ||
+            lc_u32(&c, &ttl) != 0 || lc_u32(&c, &persist) != 0 ||
+            !(sc->fns[i] = hsh_lang_lookup(name)) ||
+            !(sc->bodies[i] = lc_read_prog(&c)))
+            goto bad;
+        sc->attrs[i].ttl_ms = ttl;
+        sc->attrs[i].persist = persist != 0;
+    }
+
+    uint32_t zero;
+    if (lc_u32(&c, &zero) != 0 || zero != 0 ||
+        !(sc->main = lc_read_prog(&c)) || c.p != c.end)
+        goto bad;
+    goto out;
+
+bad:
+    hsh_script_free(sc);
+    sc = NULL;
+out:
+    munmap(map, (size_t)st.st_size);
+    return sc;
+}
+
+/* ----- writing ----- */
+
+typedef struct {
+    unsigned char *data;
+    size_t         len;
+    size_t         cap;
+    int            failed;
+} hsh_lc_buf;
+
+static void lc_put(hsh_lc_buf *b, const void *src, size_t n) {
+    if (b->failed) return;
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) cap *= 2;
+        unsigned char *tmp = realloc(b->data, cap);
+        if (!tmp) {
+            b->failed = 1;
+            return;
+        }
+        b->data = tmp;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, src, n);
+    b->len += n;
+}
+
+static void lc_put_u32(hsh_lc_buf *b, uint32_t v) {
+    lc_put(b, &v, sizeof(v));
+}
+
+static void lc_put_str(hsh_lc_buf *b, const char *s) {
+    size_t n = strlen(s);
+    lc_put_u32(b, (uint32_t)n);
+    lc_put(b, s, n + 1);
+}
+
+static void lc_put_prog(hsh_lc_buf *b, const hsh_prog *p) {
+    lc_put_u32(b, p->nnames);
+    for (unsigned i = 0; i < p->nnames; i++)
+        lc_put_str(b, p->names[i]);
+    lc_put_u32(b, p->len);
+    lc_put(b, p->code, p->len * sizeof(hsh_insn));
+}
+
+int hsh_lang_cache_save(const char *cachepath, const struct stat *src,
+                        const hsh_script *sc) {
+    hsh_lc_buf b = { NULL, 0, 0, 0 };
+    struct hsh_lc_header h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, HSH_LC_MAGIC, sizeof(h.magic));
+    hsh_lc_src(&h, src);
+    h.nfns = sc->nfns;
+    lc_put(&b, &h, sizeof(h));
+
+    for (unsigned i = 0; i < sc->nfns; i++) {
+        lc_put_str(&b, sc->fns[i]->name);
+        lc_put_u32(&b, sc->attrs[i].ttl_ms);
+        lc_put_u32(&b, (uint32_t)sc->attrs[i].persist);
+        lc_put_prog(&b, sc->bodies[i]);
+    }
+    lc_put_u32(&b, 0);
+    lc_put_prog(&b, sc->main);
+
+    if (b.failed) {
+        free(b.data);
+        return -1;
+    }
+    ((struct hsh_lc_header *)b.data)->total_size = b.len;
+
+    char tmppath[4200];
+    snprintf(tmppath, sizeof(tmppath), "%s.%ld", cachepath, (long)getpid());
+
+    int fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        free(b.data);
+        return -1;
+    }
+
+    size_t done = 0;
+    while (done < b.len) {
+        ssize_t w = write(fd, b.data + done, b.len - done);
+        if (w <= 0)
+            break;
+        done += (size_t)w;
+    }
+    free(b.data);
+
+    if (close(fd) != 0 || done != b.len || rename(tmppath, cachepath) != 0) {
+        unlink(tmppath);
+        return -1;
+    }
+    return 0;
+}
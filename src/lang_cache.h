@@ -0,0 +1,29 @@
+#ifndef HSH_LANG_CACHE_H
+#define HSH_LANG_CACHE_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+#include "lang.h"
+
+/* Compiled hsh-lang scripts, cached next to the source as .NAME.hslc.
+ *
+ * The cache records the inode, size and mtime of the source it was built
+ * from; one that doesn't match is ignored and rewritten. Loading maps the
+ * file and only resolves names, so repeated runs skip lexing, parsing and
+ * compiling.
+ */
+
+/* "dir/script.hsl" -> "dir/.script.hsl.hslc". 0 on success. */
+int hsh_lang_cache_path(const char *srcpath, char *out, size_t outsz);
+
+/* Load cachepath if it is current for src. NULL if missing, stale or
+ * malformed.
+ */
+hsh_script *hsh_lang_cache_load(const char *cachepath, const struct stat *src);
+
+/* Write the cache (atomically, via rename). 0 on success. */
+int hsh_lang_cache_save(const char *cachepath, const struct stat *src,
+                        const hsh_script *script);
+
+#endif
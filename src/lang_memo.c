@@ -0,0 +1,403 @@
+#define _GNU_SOURCE   /* pipe2 */
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "lang_memo.h"
+
+struct hsh_memo {
+    int      status;
+    char    *out;
+    size_t   len;
+    int64_t  expires_ms;
+};
+
+/* memo table and stats are shared by '&' worker threads */
+static pthread_mutex_t hsh_memo_lock = PTHREAD_MUTEX_INITIALIZER;
+static hsh_memo_stats  hsh_memo_counts;
+static pthread_once_t  hsh_memo_once = PTHREAD_ONCE_INIT;
+
+/* a child forked by any thread must not inherit the lock held by another,
+ * or a nested @cached call in it would block forever */
+static void hsh_memo_prefork(void) {
+    pthread_mutex_lock(&hsh_memo_lock);
+}
+
+static void hsh_memo_postfork(void) {
+    pthread_mutex_unlock(&hsh_memo_lock);
+}
+
+static void hsh_memo_init(void) {
+    pthread_atfork(hsh_memo_prefork, hsh_memo_postfork, hsh_memo_postfork);
+}
+
+/* wall clock, since persisted entries must mean the same in every run */
+static int64_t hsh_memo_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* ===== memo file =====
+ * A fixed table of slots, so it can be mapped once and updated in place
+ * under flock. Outputs longer than a slot are only cached in-process.
+ */
+
+#define HSH_MEMO_MAGIC  "HSHMEMO1"
+#define HSH_MEMO_SLOTS  128        /* power of two */
+#define HSH_MEMO_PROBE  8
+#define HSH_MEMO_OUTMAX 4000
+
+struct hsh_memo_slot {
+    uint64_t key;                  /* 0 = empty */
+    int64_t  expires_ms;
+    int32_t  status;
+    uint32_t len;
+    char     out[HSH_MEMO_OUTMAX];
+};
+
+struct hsh_memo_file {
+    char     magic[8];
+    uint32_t nslots;
+    uint32_t pad;
+    struct hsh_memo_slot slots[HSH_MEMO_SLOTS];
+};
+
+static struct hsh_memo_file *hsh_memo_map = NULL;
+static int hsh_memo_fd = -1;
+static int hsh_memo_tried = 0;
+
+/* map the memo file once; NULL if it can't be used */
+static struct hsh_memo_file *hsh_memo_file_open(void) {
+    if (hsh_memo_tried)
+        return hsh_memo_map;
+    hsh_memo_tried = 1;
+
+    char path[4096];
+    const char *env = getenv("HSH_MEMO");
+    const char *home = getenv("HOME");
+    if (env && *env) {
+        snprintf(path, sizeof(path), "%s", env);
+    } else if (home) {
+        snprintf(path, sizeof(path), "%s/.cache", home);
+        mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/.cache/hsh", home);
+        mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/.cache/hsh/memo", home);
+    } else {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &st) != 0 ||
+        (st.st_size != sizeof(struct hsh_memo_file) &&
+         ftruncate(fd, 0) != 0) ||
+        ftruncate(fd, sizeof(struct hsh_memo_file)) != 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return NULL;
+    }
+
+    struct hsh_memo_file *m = mmap(NULL, sizeof(*m), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return NULL;
+    }
+    if (memcmp(m->magic, HSH_MEMO_MAGIC, sizeof(m->magic)) != 0 ||
+        m->nslots != HSH_MEMO_SLOTS) {
+        memset(m, 0, sizeof(*m));
+        memcpy(m->magic, HSH_MEMO_MAGIC, sizeof(m->magic));
+        m->nslots = HSH_MEMO_SLOTS;
+    }
+    flock(fd, LOCK_UN);
+
+    hsh_memo_fd = fd;
+    hsh_memo_map = m;
+    return m;
+}
+
+/* FNV-1a over the name and the compiled body: an edited fn misses */
+static uint64_t hsh_memo_key(const hsh_fn *fn) {
+    uint64_t h = 14695981039346656037ull;
+    const hsh_prog *p = fn->body;
+
+    if (fn->memo_key)   /* compiled ahead of time: hashed by the compiler */
+        return fn->memo_key;
+
+#define MIX(ptr, n) do {                                  \
+        const unsigned char *b_ = (const unsigned char *)(ptr); \
+        for (size_t i_ = 0; i_ < (n); i_++) {             \
+            h ^= b_[i_];                                  \
+            h *= 1099511628211ull;                        \
+        }                                                 \
+    } while (0)
+
+    MIX(fn->name, strlen(fn->name) + 1);
+    for (unsigned i = 0; i < p->nnames; i++)
+        MIX(p->names[i], strlen(p->names[i]) + 1);
+    MIX(p->code, p->len * sizeof(*p->code));
+#undef MIX
+
+    return h ? h : 1;
+}
+
+static struct hsh_memo_slot *hsh_memo_file_find(struct hsh_memo_file *m,
+                                                uint64_t key, int for_write) {
+    struct hsh_memo_slot *victim = NULL;
+
+    for (unsigned i = 0; i < HSH_MEMO_PROBE; i++) {
+        struct hsh_memo_slot *s = &m->slots[(key + i) & (HSH_MEMO_SLOTS - 1)];
+        if (s->key == key)
+            return s;
+        if (!for_write)
+            continue;
+        /* reuse an empty slot, else the one that expires first */
+        if (!victim || s->key == 0 ||
+            (victim->key != 0 && s->expires_ms < victim->expires_ms))
+            victim = s;
+    }
+    return victim;
+}
+
+static int hsh_memo_file_get(uint64_t key, int64_t now, struct hsh_memo *out) {
+    struct hsh_memo_file *m = hsh_memo_file_open();
+    if (!m) return 0;
+
+    int found = 0;
+    flock(hsh_memo_fd, LOCK_SH);
+    struct hsh_memo_slot *s = hsh_memo_file_find(m, key, 0);
+    if (s && s->expires_ms > now && s->len <= HSH_MEMO_OUTMAX) {
+        out->out = malloc(s->len ? s->len : 1);
+        if (out->out) {
+            memcpy(out->out, s->out, s->len);
+            out->len = s->len;
+            out->status = s->status;
+            out->expires_ms = s->expires_ms;
+            found = 1;
+        }
+    }
+    flock(hsh_memo_fd, LOCK_UN);
+    return found;
+}
+
+static void hsh_memo_file_put(uint64_t key, const struct hsh_memo *r) {
+    struct hsh_memo_file *m = hsh_memo_file_open();
+    if (!m || r->len > HSH_MEMO_OUTMAX) return;
+
+    flock(hsh_memo_fd, LOCK_EX);
+    struct hsh_memo_slot *s = hsh_memo_file_find(m, key, 1);
+    s->key = key;
+    s->expires_ms = r->expires_ms;
+    s->status = r->status;
+    s->len = (uint32_t)r->len;
+    memcpy(s->out, r->out, r->len);
+    flock(hsh_memo_fd, LOCK_UN);
+}
+
+/* ===== calls ===== */
+
+/* Run the body in a child and collect its stdout. Returns 0 with the
+ * output in r, -1 if the body did not run (no pipe or fork), or 1 if it
+ * ran but its output could not be kept: what was read so far and the
+ * rest are then passed straight to stdout, and only r->status is set.
+ */
+static int hsh_memo_run(hsh_fn *fn, struct hsh_memo *r) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        perror("hsh-lang: pipe");
+        return -1;
+    }
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("hsh-lang: fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        int st = hsh_lang_call_user(fn);
+        fflush(NULL);
+        _exit(st & 0xff);
+    }
+    close(fds[1]);
+
+    char buf[4096];
+    size_t cap = 0;
+    ssize_t n;
+    int failed = 0;
+
+    r->out = NULL;
+    r->len = 0;
+    while ((n = read(fds[0], buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("hsh-lang: read");
+            if (!failed && r->len)
+                fwrite(r->out, 1, r->len, stdout);
+            failed = 1;
+            break;
+        }
+        if (failed) {
+            fwrite(buf, 1, (size_t)n, stdout);   /* uncached pass-through */
+            continue;
+        }
+        if (r->len + (size_t)n > cap) {
+            size_t ncap = cap ? cap * 2 : sizeof(buf);
+            char *tmp = realloc(r->out, ncap);
+            if (!tmp) {
+                failed = 1;
+                if (r->len)
+                    fwrite(r->out, 1, r->len, stdout);
+                fwrite(buf, 1, (size_t)n, stdout);
+                continue;
+            }
+            r->out = tmp;
+            cap = ncap;
+        }
+        memcpy(r->out + r->len, buf, (size_t)n);
+        r->len += (size_t)n;
+    }
+    close(fds[0]);
+    if (!failed && !r->out)
+        failed = !(r->out = malloc(1));
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    r->status = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    if (failed) {
+        fflush(stdout);
+        free(r->out);
+        r->out = NULL;
+        r->len = 0;
+        return 1;
+    }
+    return 0;
+}
+
+static void hsh_memo_replay(const struct hsh_memo *r) {
+    fwrite(r->out, 1, r->len, stdout);
+    fflush(stdout);
+}
+
+int hsh_memo_call(hsh_fn *fn) {
+    int64_t now = hsh_memo_now_ms();
+    struct hsh_memo r = { 0, NULL, 0, 0 };
+
+    pthread_once(&hsh_memo_once, hsh_memo_init);
+
+    pthread_mutex_lock(&hsh_memo_lock);
+    struct hsh_memo *m = fn->memo;
+    if (m && m->expires_ms > now) {
+        r = *m;
+        r.out = malloc(m->len ? m->len : 1);
+        if (r.out) {
+            memcpy(r.out, m->out, m->len);
+            hsh_memo_counts.hits++;
+        }
+    }
+    int stale = (m != NULL && !r.out);
+    pthread_mutex_unlock(&hsh_memo_lock);
+
+    if (r.out) {
+        hsh_memo_replay(&r);
+        free(r.out);
+        return r.status;
+    }
+
+    uint64_t key = fn->attrs.persist ? hsh_memo_key(fn) : 0;
+    int from_file = 0;
+
+    pthread_mutex_lock(&hsh_memo_lock);
+    if (key)
+        from_file = hsh_memo_file_get(key, now, &r);
+    pthread_mutex_unlock(&hsh_memo_lock);
+
+    if (!from_file) {
+        int rc = hsh_memo_run(fn, &r);
+        if (rc < 0)
+            return hsh_lang_call_user(fn);   /* never ran: run uncached */
+        if (rc > 0)
+            return r.status;                 /* ran, output passed through */
+        r.expires_ms = hsh_memo_now_ms() + fn->attrs.ttl_ms;
+    }
+
+    struct hsh_memo *keep = malloc(sizeof(*keep));
+    if (keep) {
+        *keep = r;
+        keep->out = malloc(r.len ? r.len : 1);
+        if (keep->out) {
+            memcpy(keep->out, r.out, r.len);
+        } else {
+            free(keep);
+            keep = NULL;
+        }
+    }
+
+    pthread_mutex_lock(&hsh_memo_lock);
+    if (from_file) {
+        hsh_memo_counts.hits++;
+        hsh_memo_counts.file_hits++;
+    } else {
+        hsh_memo_counts.misses++;
+        if (stale)
+            hsh_memo_counts.expired++;
+        if (key)
+            hsh_memo_file_put(key, &r);
+    }
+    if (keep) {
+        if (fn->memo)
+            free(fn->memo->out);
+        free(fn->memo);
+        fn->memo = keep;
+    }
+    pthread_mutex_unlock(&hsh_memo_lock);
+
+    hsh_memo_replay(&r);
+    free(r.out);
+    return r.status;
+}
+
+void hsh_memo_forget(hsh_fn *fn) {
+    pthread_mutex_lock(&hsh_memo_lock);
+    if (fn->memo) {
+        free(fn->memo->out);
+        free(fn->memo);
+        fn->memo = NULL;
+    }
+    pthread_mutex_unlock(&hsh_memo_lock);
+}
+
+void hsh_memo_get_stats(hsh_memo_stats *out) {
+    pthread_mutex_lock(&hsh_memo_lock);
+    *out = hsh_memo_counts;
+    pthread_mutex_unlock(&hsh_memo_lock);
+}
+
+void hsh_memo_print_stats(FILE *out) {
+    hsh_memo_stats s;
+    hsh_memo_get_stats(&s);
+    fprintf(out, "hsh-lang: cache: %lu hits (%lu from file), "
+                 "%lu misses (%lu expired)\n",
+            s.hits, s.file_hits, s.misses, s.expired);
+}
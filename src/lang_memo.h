@@ -0,0 +1,31 @@
+#ifndef HSH_LANG_MEMO_H
+#define HSH_LANG_MEMO_H
+
+#include <stdio.h>
+
+#include "lang.h"
+
+/* Memoized calls for @cached(ttl=...) fns.
+ *
+ * A miss runs the fn in a forked child with stdout on a pipe, then stores
+ * the exit status and output on the hsh_fn until the ttl runs out; a hit
+ * replays them. With `persist`, results also go to a small mmap'd file
+ * (HSH_MEMO, default ~/.cache/hsh/memo) so later runs can reuse them.
+ * Persisted entries are keyed by the fn name and its compiled body.
+ */
+int  hsh_memo_call(hsh_fn *fn);
+
+/* Drop the cached result, e.g. when fn is redefined. */
+void hsh_memo_forget(hsh_fn *fn);
+
+typedef struct {
+    unsigned long hits;        /* includes file_hits */
+    unsigned long file_hits;
+    unsigned long misses;
+    unsigned long expired;     /* misses that replaced a stale result */
+} hsh_memo_stats;
+
+void hsh_memo_get_stats(hsh_memo_stats *out);
+void hsh_memo_print_stats(FILE *out);
+
+#endif
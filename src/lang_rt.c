@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "lang.h"
+#include "lang_rt.h"
+#include "parser.h"
+#include "builtins.h"
+
+/* hsh-lang natives: name() -> shell builtin with fixed arguments */
+static char *hsh_native_sys_info[]      = { "sys", "info", NULL };
+static char *hsh_native_sys_resources[] = { "sys", "resources", NULL };
+static char *hsh_native_fs_tree[]       = { "fs", "tree", NULL };
+static char *hsh_native_fs_ls[]         = { "fs", "ls", NULL };
+static char *hsh_native_net_ip[]        = { "net", "ip", NULL };
+static char *hsh_native_ps_top[]        = { "ps", "top", NULL };
+
+static const struct {
+    const char *name;
+    int       (*handler)(char **args);
+    char      **args;
+} hsh_lang_natives[] = {
+    { "sys_info",      hsh_builtin_sys, hsh_native_sys_info },
+    { "sys_resources", hsh_builtin_sys, hsh_native_sys_resources },
+    { "fs_tree",       hsh_builtin_fs,  hsh_native_fs_tree },
+    { "fs_ls",         hsh_builtin_fs,  hsh_native_fs_ls },
+    { "net_ip",        hsh_builtin_net, hsh_native_net_ip },
+    { "ps_top",        hsh_builtin_ps,  hsh_native_ps_top },
+    { NULL, NULL, NULL }
+};
+
+/* anything else runs like a command typed at the shell prompt; inside
+ * a '&' group the line runs in a forked child, since the parser keeps
+ * its state ($?, pipestatus, the exec cache) in unlocked globals */
+static int hsh_lang_spawn_line(const char *name) {
+    char line[256];
+    int status = 0;
+
+    snprintf(line, sizeof(line), "%s", name);
+    fflush(NULL);  /* natives print through stdio; keep output ordered */
+    if (!hsh_lang_in_par()) {
+        hsh_run_line(line, &status);
+        return status;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        hsh_run_line(line, &status);
+        fflush(NULL);
+        _exit(status);
+    }
+    if (pid < 0) {
+        perror("hsh-lang: fork");
+        return 1;
+    }
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return 1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+void hsh_lang_init(void) {
+    static int done = 0;
+    if (done)
+        return;
+    done = 1;
+
+    for (int i = 0; hsh_lang_natives[i].name; i++)
+        hsh_lang_register_native(hsh_lang_natives[i].name,
+                                 hsh_lang_natives[i].handler,
+                                 hsh_lang_natives[i].args);
+    hsh_lang_set_spawn(hsh_lang_spawn_line);
+}
@@ -0,0 +1,13 @@
+#ifndef HSH_LANG_RT_H
+#define HSH_LANG_RT_H
+
+/* hsh-lang runtime shared by the interpreter, the `lang` builtin and
+ * programs built with `hsh-lang --compile` (libhsh-lang.a).
+ */
+
+/* Register the natives (sys_info, fs_ls, ...) and run external names
+ * through the shell. Safe to call more than once.
+ */
+void hsh_lang_init(void);
+
+#endif
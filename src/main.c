@@ -32,15 +32,13 @@
 #include <errno.h>
 #include <signal.h>
 
-#include <readline/readline.h>
-#include <readline/history.h>
-
 #include "extras.h"
 #include "parser.h"
 #include "lang.h"
-
-#define HSH_NAME    "HorizonShell"
-#define HSH_VERSION "0.1.0"
+#include "input.h"
+#include "snapshot.h"
+#include "server.h"
+#include "batch.h"
 
 #define HSH_MAX_LINE    1024
 
@@ -51,25 +49,58 @@ static void hsh_sigint_handler(int sig) {
     hsh_got_sigint = 1;
 }
 
-static void hsh_loop(const struct hsh_config *cfg,
-                     struct hsh_alias *aliases, int alias_count);
-static int  hsh_run_script(FILE *f, const struct hsh_config *cfg,
-                           struct hsh_alias *aliases, int alias_count);
-
-/* builtin handlers (used by parser.c via extern prototypes there) */
-int hsh_builtin_help(char **args);
-int hsh_builtin_sys(char **args);
-int hsh_builtin_fs(char **args);
-int hsh_builtin_net(char **args);
-int hsh_builtin_ps(char **args);
-int hsh_builtin_config(char **args);
-int hsh_builtin_alias(char **args);
-int hsh_builtin_cd(char **args);
+/* aliases: loaded eagerly for interactive/script mode, lazily for -c / -s.
+ * Either hsh_snap (mmap'd snapshot) or hsh_aliases (parsed text) is used.
+ */
+static const struct hsh_snapshot *hsh_snap = NULL;
+static struct hsh_alias *hsh_aliases = NULL;
+static int hsh_alias_count = 0;
+static int hsh_aliases_loaded = 0;
+static int hsh_pipe_opts_loaded = 0;
+
+static void  hsh_loop(const struct hsh_config *cfg);
+static int   hsh_run_script(FILE *f, const struct hsh_config *cfg,
+                            int *last_status_out);
+static int   hsh_state_load(struct hsh_config *cfg);
+static void  hsh_state_free(void);
+static char *hsh_alias_for_line(const char *line, int lazy);
+static char *hsh_alias_lazy(const char *line);
+static int   hsh_run_args(int argc, char **argv);
+static void  hsh_usage(void);
+static void  hsh_apply_pipe_opts(const struct hsh_config *cfg);
+static void  hsh_pipe_opts_load(void);
 
 
 /* ===== main ===== */
 
 int main(int argc, char **argv) {
+    /* -c / -s / batch: minimal startup, no setup check, no config, no
+     * status bar */
+    if (argc > 1 && (strcmp(argv[1], "-c") == 0 ||
+                     strcmp(argv[1], "-s") == 0 ||
+                     strcmp(argv[1], "-") == 0 ||
+                     strcmp(argv[1], "--batch") == 0)) {
+        int rc = hsh_run_args(argc, argv);
+        hsh_state_free();
+        return rc;
+    }
+
+    /* hsh --server <socket>: keep aliases warm, fork per hsh-client request */
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        if (argc < 3) {
+            hsh_usage();
+            return 2;
+        }
+        hsh_state_load(NULL);
+        return hsh_server_main(argv[2], hsh_run_args);
+    }
+
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 ||
+                     strcmp(argv[1], "--help") == 0)) {
+        hsh_usage();
+        return 0;
+    }
+
     char *home = getenv("HOME");
     if (!home) {
         fprintf(stderr, "hsh: HOME not set\n");
@@ -77,14 +108,10 @@ int main(int argc, char **argv) {
     }
 
     char confpath[512];
-    char aliaspath[512];
     struct stat st;
     struct hsh_config cfg;
-    struct hsh_alias *aliases = NULL;
-    int alias_count = 0;
 
     snprintf(confpath, sizeof(confpath), "%s/.config/hsh/config", home);
-    snprintf(aliaspath, sizeof(aliaspath), "%s/.config/hsh/aliases", home);
 
     /* If config missing, run setup */
     if (stat(confpath, &st) != 0) {
@@ -104,26 +131,22 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (hsh_load_config(confpath, &cfg) != 0) {
+    /* config + aliases, from the snapshot when it is current */
+    if (hsh_state_load(&cfg) != 0) {
         return 1;
     }
 
-    /* load aliases */
-    if (hsh_load_aliases(aliaspath, &aliases, &alias_count) != 0) {
-        fprintf(stderr, "hsh: failed to load aliases\n");
-    }
-
     /* script mode: hsh myscript.hsh */
     if (argc > 1) {
         FILE *f = fopen(argv[1], "r");
         if (!f) {
             perror("hsh: fopen script");
-            hsh_free_aliases(aliases, alias_count);
+            hsh_state_free();
             return 1;
         }
-        int rc = hsh_run_script(f, &cfg, aliases, alias_count);
+        int rc = hsh_run_script(f, &cfg, NULL);
         fclose(f);
-        hsh_free_aliases(aliases, alias_count);
+        hsh_state_free();
         return rc;
     }
 
@@ -136,540 +159,299 @@ int main(int argc, char **argv) {
     sigaction(SIGINT, &sa, NULL);
 
     /* interactive mode */
-    hsh_loop(&cfg, aliases, alias_count);
+    hsh_loop(&cfg);
 
-    hsh_free_aliases(aliases, alias_count);
+    hsh_state_free();
     return 0;
 }
 
 
-/* ===== interactive loop ===== */
-
-static void hsh_loop(const struct hsh_config *cfg,
-                     struct hsh_alias *aliases, int alias_count) {
-    char *line;
-    int status;
-
-    do {
-        if (hsh_got_sigint) {
-            hsh_got_sigint = 0;
-            write(STDOUT_FILENO, "\n", 1);
-        }
-
-        /* draw status bar first */
-        hsh_draw_statusbar(cfg);
-
-        /* let readline own the prompt so backspace doesn't delete it */
-        char prompt[64];
-        snprintf(prompt, sizeof(prompt),
-                 "\033[%d;%dmhsh$ \033[0m", cfg->fg, cfg->bg);
-
-        line = readline(prompt);
-        if (!line)
-            break;
-
-        if (line[0] != '\0')
-            add_history(line);
-
-        /* alias expansion on first word only */
-        char *expanded = NULL;
-        {
-            char *tmp = strdup(line);
-            if (!tmp) {
-                perror("hsh: strdup");
-                free(line);
-                continue;
-            }
-            char *first = strtok(tmp, " \t\r\n");
-            if (first) {
-                expanded = hsh_expand_alias(aliases, alias_count, first);
-            }
-            free(tmp);
-        }
-
-        if (expanded) {
-            free(line);
-            line = expanded;
-        }
-
-        /* Normal shell parsing; lang is available as a builtin */
-        status = hsh_run_line(line, &status);
-
-        free(line);
-    } while (status);
+static void hsh_usage(void) {
+    fprintf(stderr,
+            "Usage: hsh [script.hsh]\n"
+            "       hsh -c 'command'   run one command and exit\n"
+            "       hsh -s             read commands from stdin\n"
+            "       hsh --batch [--jobs N] (or hsh -)\n"
+            "                          stream commands from stdin, N at a time;\n"
+            "                          commands get /dev/null as stdin\n"
+            "       hsh --server sock  serve hsh-client requests on sock\n");
+}
 
-    printf("\n");
+static char *hsh_alias_lazy(const char *line) {
+    return hsh_alias_for_line(line, 1);
 }
 
 
-/* ===== script mode: run each non-comment line through shell ===== */
+/* ===== non-interactive entry: hsh -c / -s / script.hsh =====
+ * No setup check, config or status bar; aliases are loaded lazily.
+ * Also called in each forked hsh --server worker with the client's argv.
+ */
 
-static int hsh_run_script(FILE *f, const struct hsh_config *cfg,
-                          struct hsh_alias *aliases, int alias_count) {
-    char *line = NULL;
-    size_t sz = 0;
-    int status = 1;
+static int hsh_run_args(int argc, char **argv) {
+    int status = 0;
 
-    while (getline(&line, &sz, f) != -1) {
-        /* skip comments and blank lines */
-        char *p = line;
-        while (*p == ' ' || *p == '\t') p++;
-        if (*p == '#' || *p == '\n' || *p == '\0')
-            continue;
+    if (argc < 2) {
+        hsh_usage();
+        return 2;
+    }
 
-        /* no readline, but we still want aliases */
-        char *expanded = NULL;
-        {
-            char *tmp = strdup(line);
-            if (!tmp) {
-                perror("hsh: strdup");
-                free(line);
-                return 1;
-            }
-            char *first = strtok(tmp, " \t\r\n");
-            if (first) {
-                expanded = hsh_expand_alias(aliases, alias_count, first);
-            }
-            free(tmp);
-        }
+    hsh_apply_pipe_opts(NULL);
 
-        char *exec_line = line;
-        if (expanded) {
-            exec_line = expanded;
+    /* hsh -c 'command': aliases only read if the first word might be one */
+    if (strcmp(argv[1], "-c") == 0) {
+        if (argc < 3) {
+            hsh_usage();
+            return 2;
         }
-
-        status = hsh_run_line(exec_line, &status);
-
-        if (expanded)
-            free(expanded);
-
-        if (status == 0)  /* exit in script */
-            break;
+        char *expanded = hsh_alias_for_line(argv[2], 1);
+        hsh_run_line(expanded ? expanded : argv[2], &status);
+        free(expanded);
+        return status;
     }
 
-    free(line);
-    (void)cfg; /* cfg kept for future script features */
-    return 0;
-}
-
-
-/* ====== BUILTINS (used by parser.c) ====== */
-
-int hsh_builtin_cd(char **args) {
-    char *target = NULL;
+    /* hsh -s: commands read from stdin */
+    if (strcmp(argv[1], "-s") == 0) {
+        hsh_run_script(stdin, NULL, &status);
+        return status;
+    }
 
-    if (args[1] == NULL || strcmp(args[1], "~") == 0) {
-        /* cd or cd ~ -> HOME */
-        target = getenv("HOME");
-        if (!target) {
-            fprintf(stderr, "cd: HOME not set\n");
-            return 1;
-        }
-    } else if (args[1][0] == '~') {
-        /* handle things like ~/foo */
-        char *home = getenv("HOME");
-        if (!home) {
-            fprintf(stderr, "cd: HOME not set\n");
-            return 1;
-        }
-        size_t len = strlen(home) + strlen(args[1]);
-        char *buf = malloc(len);
-        if (!buf) {
-            perror("cd");
-            return 1;
-        }
-        snprintf(buf, len, "%s%s", home, args[1] + 1);
-        int rc = chdir(buf);
-        free(buf);
-        if (rc != 0) {
-            perror("cd");
-            return 1;
-        }
-        return 1;
-    } else if (args[1][0] == '$') {
-        /* cd $VAR */
-        const char *var = args[1] + 1;
-        target = getenv(var);
-        if (!target || target[0] == '\0') {
-            fprintf(stderr, "cd: %s not set or empty\n", args[1]);
-            return 1;
+    /* hsh - / --batch [--jobs N]: streamed from stdin, with a summary */
+    if (strcmp(argv[1], "-") == 0 || strcmp(argv[1], "--batch") == 0) {
+        int jobs = 1;
+        if (argc > 3 && (strcmp(argv[2], "--jobs") == 0 ||
+                         strcmp(argv[2], "-j") == 0)) {
+            jobs = atoi(argv[3]);
+            if (jobs < 1) {
+                hsh_usage();
+                return 2;
+            }
         }
-    } else {
-        target = args[1];
+        return hsh_run_batch(STDIN_FILENO, jobs, hsh_alias_lazy);
     }
 
-    if (chdir(target) != 0) {
-        perror("cd");
+    FILE *f = fopen(argv[1], "r");
+    if (!f) {
+        perror("hsh: fopen script");
         return 1;
     }
-
-    return 1;
+    hsh_run_script(f, NULL, &status);
+    fclose(f);
+    return status;
 }
 
 
-int hsh_builtin_help(char **args) {
-    if (args[1] == NULL) {
-        printf("%s %s\n", HSH_NAME, HSH_VERSION);
-        printf("A hybrid interactive shell with system-aware status bar and extended commands.\n\n");
-
-        printf("Builtins:\n");
-        printf("  help [name]        - show this help or details about a builtin\n");
-        printf("  exit               - exit %s\n", HSH_NAME);
-        printf("  cd [dir]           - change directory\n");
-        printf("  config             - edit HorizonShell config file\n");
-        printf("  alias [name value] - manage command aliases\n\n");
-
-        printf("System commands:\n");
-        printf("  sys info           - system info (OS, kernel, host, uptime)\n");
-        printf("  sys resources      - CPU/RAM/disk summary\n");
-        printf("  sys config         - open HorizonShell config in your editor\n\n");
-
-        printf("Filesystem commands:\n");
-        printf("  fs tree [path]     - directory tree view (uses tree or find)\n");
-        printf("  fs ls [path]       - colored ls wrapper\n\n");
-
-        printf("Network commands:\n");
-        printf("  net ip             - show IP addresses\n");
-        printf("  net ping <host>    - ping host with sane defaults\n\n");
+/* ===== aliases ===== */
 
-        printf("Process commands:\n");
-        printf("  ps top             - show top processes by CPU\n");
-        printf("  ps find <pattern>  - list processes matching pattern\n\n");
-
-        printf("Scripting helpers:\n");
-        printf("  let NAME = VALUE   - set environment variable NAME to VALUE\n");
-        printf("  hsh script.hsh     - run script file line by line\n\n");
-
-        printf("Usage:\n");
-        printf("  <external-command> [args...]    - runs like a normal shell (ls, cat, etc.)\n");
-        printf("  <namespace> <verb> [args...]    - HorizonShell extended syntax (sys, fs, net, ps)\n");
-
-        return 1;
-    }
-
-    if (strcmp(args[1], "sys") == 0) {
-        printf("sys: system-related commands\n");
-        printf("  sys info           - show OS, kernel, host, uptime\n");
-        printf("  sys resources      - show CPU, RAM, disk summary\n");
-        printf("  sys config         - choose an editor and open ~/.config/hsh/config\n");
-        return 1;
-    } else if (strcmp(args[1], "fs") == 0) {
-        printf("fs: filesystem commands\n");
-        printf("  fs tree [path]     - print a directory tree (max depth 3 if tree missing)\n");
-        printf("  fs ls [path]       - colored long listing of a directory\n");
-        return 1;
-    } else if (strcmp(args[1], "net") == 0) {
-        printf("net: networking commands\n");
-        printf("  net ip             - show IP configuration using ip or ifconfig\n");
-        printf("  net ping <host>    - ping host with 4 echo requests\n");
-        return 1;
-    } else if (strcmp(args[1], "ps") == 0) {
-        printf("ps: process inspection commands\n");
-        printf("  ps top             - top CPU processes (ps -eo ... | head)\n");
-        printf("  ps find <pattern>  - search processes by name using ps aux\n");
-        return 1;
-    } else if (strcmp(args[1], "exit") == 0) {
-        printf("exit: exit %s\n", HSH_NAME);
-        printf("  exit               - terminate the current shell session\n");
-        return 1;
-    } else if (strcmp(args[1], "config") == 0) {
-        printf("config: edit HorizonShell config file\n");
-        printf("  config             - choose an editor and open ~/.config/hsh/config\n");
-        printf("                       restart hsh after changing settings.\n");
-        return 1;
-    } else if (strcmp(args[1], "alias") == 0) {
-        printf("alias: manage command aliases\n");
-        printf("  alias              - show where aliases are stored and usage\n");
-        printf("  alias name value   - append an alias (name -> value) to aliases file\n");
-        printf("                       HSH reloads aliases on startup.\n");
-        return 1;
-    } else if (strcmp(args[1], "cd") == 0) {
-        printf("cd: change the current working directory\n");
-        printf("  cd [dir]           - change to dir, or $HOME if omitted\n");
-        printf("  cd ~               - change to $HOME\n");
-        printf("  cd $VAR            - change to directory in environment variable VAR\n");
-        return 1;
-    }
-
-    printf("help: no detailed help for '%s' yet.\n", args[1]);
-    return 1;
-}
+/* Load aliases, and config when cfg is non-NULL (-c / -s pass NULL).
+ * The mmap'd snapshot is used when it matches the text files; otherwise
+ * they are parsed and the snapshot is rebuilt for the next start.
+ */
+static int hsh_state_load(struct hsh_config *cfg) {
+    struct hsh_config scratch;
 
+    hsh_aliases_loaded = 1;
+    hsh_pipe_opts_loaded = 1;
 
-int hsh_builtin_sys(char **args) {
     char *home = getenv("HOME");
-    if (!home) {
-        fprintf(stderr, "sys: HOME not set\n");
-        return 1;
-    }
+    if (!home)
+        return cfg ? -1 : 0;
 
     char confpath[512];
+    char aliaspath[512];
+    char snappath[512];
     snprintf(confpath, sizeof(confpath), "%s/.config/hsh/config", home);
+    snprintf(aliaspath, sizeof(aliaspath), "%s/.config/hsh/aliases", home);
+    snprintf(snappath, sizeof(snappath), "%s/.config/hsh/snapshot", home);
 
-    if (args[1] == NULL || strcmp(args[1], "info") == 0) {
-        printf("=== System info ===\n");
-        system("uname -a");
-        system("echo");
-        system("echo User: $USER");
-        system("echo Host: $(hostname)");
-        system("echo");
-        system("uptime");
-        return 1;
+    hsh_snap = hsh_snapshot_open(snappath, confpath, aliaspath);
+    if (hsh_snap) {
+        hsh_snapshot_config(hsh_snap, cfg ? cfg : &scratch);
+        hsh_apply_pipe_opts(cfg ? cfg : &scratch);
+        return 0;
     }
 
-    if (strcmp(args[1], "resources") == 0) {
-        printf("=== CPU / Memory / Disk ===\n");
-        system("echo CPU: && lscpu | head -n 5");
-        system("echo");
-        system("echo Memory: && free -h");
-        system("echo");
-        system("echo Disk: && df -h");
-        return 1;
+    /* -c / -s never ran setup; without a config there is nothing to snapshot */
+    int have_cfg = 1;
+    if (!cfg) {
+        cfg = &scratch;
+        have_cfg = (access(confpath, R_OK) == 0);
     }
 
-    if (strcmp(args[1], "config") == 0) {
-        char *env_editor = getenv("EDITOR");
-        char editor[64] = {0};
-
-        printf("=== Edit HorizonShell config ===\n");
-        printf("Config file: %s\n", confpath);
-        if (env_editor && env_editor[0] != '\0') {
-            printf("Detected $EDITOR = %s\n", env_editor);
-        }
-
-        printf("Choose editor:\n");
-        if (env_editor && env_editor[0] != '\0')
-            printf("  1) Use $EDITOR (%s)\n", env_editor);
-        else
-            printf("  1) nano\n");
-        printf("  2) nano\n");
-        printf("  3) vim\n");
-        printf("  4) code (VS Code CLI)\n");
-        printf("Select [1-4] (default 1): ");
-
-        int choice = 1;
-        char buf[32];
-        if (fgets(buf, sizeof(buf), stdin)) {
-            int v;
-            if (sscanf(buf, "%d", &v) == 1 && v >= 1 && v <= 4)
-                choice = v;
-        }
+    if (have_cfg && hsh_load_config(confpath, cfg) != 0)
+        return -1;
+    if (have_cfg)
+        hsh_apply_pipe_opts(cfg);
 
-        if (choice == 1) {
-            if (env_editor && env_editor[0] != '\0') {
-                strncpy(editor, env_editor, sizeof(editor) - 1);
-            } else {
-                strncpy(editor, "nano", sizeof(editor) - 1);
-            }
-        } else if (choice == 2) {
-            strncpy(editor, "nano", sizeof(editor) - 1);
-        } else if (choice == 3) {
-            strncpy(editor, "vim", sizeof(editor) - 1);
-        } else if (choice == 4) {
-            strncpy(editor, "code", sizeof(editor) - 1);
-        }
-
-        if (editor[0] == '\0') {
-            fprintf(stderr, "sys config: no editor selected\n");
-            return 1;
-        }
-
-        char cmd[600];
-        snprintf(cmd, sizeof(cmd), "%s %s", editor, confpath);
-        printf("Opening config with: %s\n", cmd);
-        system(cmd);
-        printf("Done editing. Changes take effect next time you start hsh (or after reload).\n");
-        return 1;
+    if (hsh_load_aliases(aliaspath, &hsh_aliases, &hsh_alias_count) != 0) {
+        fprintf(stderr, "hsh: failed to load aliases\n");
+        return 0;
     }
 
-    printf("sys: unknown subcommand '%s'\n", args[1]);
-    return 1;
+    if (have_cfg)
+        hsh_snapshot_write(snappath, confpath, aliaspath,
+                           cfg, hsh_aliases, hsh_alias_count);
+    return 0;
 }
 
+static void hsh_state_free(void) {
+    hsh_snapshot_close(hsh_snap);
+    hsh_snap = NULL;
+    hsh_free_aliases(hsh_aliases, hsh_alias_count);
+    hsh_aliases = NULL;
+    hsh_alias_count = 0;
+}
 
-int hsh_builtin_fs(char **args) {
-    if (args[1] == NULL || strcmp(args[1], "tree") == 0) {
-        const char *path = ".";
-        if (args[1] && args[2])
-            path = args[2];
-
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd),
-                 "command -v tree >/dev/null 2>&1 && tree -C %s || (echo \"tree not found, using find\"; find %s -maxdepth 3 -print)",
-                 path, path);
-        system(cmd);
-        return 1;
-    }
+/* HSH_PIPESZ / HSH_PIPEFAIL win over the config's pipe_size / pipefail */
+static void hsh_apply_pipe_opts(const struct hsh_config *cfg) {
+    const char *env = getenv("HSH_PIPESZ");
+    long size = env ? hsh_parse_size(env) : -1;
+    int pipefail = -1;
 
-    if (strcmp(args[1], "ls") == 0) {
-        const char *path = ".";
-        if (args[2])
-            path = args[2];
+    if (size < 0 && cfg)
+        size = cfg->pipe_size;
 
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "ls --color=auto -al %s", path);
-        system(cmd);
-        return 1;
-    }
+    env = getenv("HSH_PIPEFAIL");
+    if (env && *env)
+        pipefail = strcmp(env, "0") != 0;
+    else if (cfg)
+        pipefail = cfg->pipefail;
 
-    printf("fs: unknown subcommand '%s'\n", args[1]);
-    return 1;
+    hsh_pipe_defaults(size, pipefail);
 }
 
+/* Just pipe_size / pipefail, for the first -c / -s / batch pipeline:
+ * from the environment when it sets both, else from the config file.
+ * Aliases and the snapshot stay unloaded.
+ */
+static void hsh_pipe_opts_load(void) {
+    struct hsh_config cfg;
+    char confpath[512];
+    const char *home = getenv("HOME");
 
-int hsh_builtin_net(char **args) {
-    if (args[1] == NULL || strcmp(args[1], "ip") == 0) {
-        printf("=== IP addresses ===\n");
-        system("command -v ip >/dev/null 2>&1 && ip addr show || ifconfig");
-        return 1;
-    }
-
-    if (strcmp(args[1], "ping") == 0) {
-        if (!args[2]) {
-            printf("Usage: net ping <host>\n");
-            return 1;
-        }
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd), "ping -c 4 %s", args[2]);
-        system(cmd);
-        return 1;
+    hsh_pipe_opts_loaded = 1;
+    if (!home || (getenv("HSH_PIPESZ") && getenv("HSH_PIPEFAIL"))) {
+        hsh_apply_pipe_opts(NULL);
+        return;
     }
 
-    printf("net: unknown subcommand '%s'\n", args[1]);
-    return 1;
+    snprintf(confpath, sizeof(confpath), "%s/.config/hsh/config", home);
+    if (access(confpath, R_OK) == 0 && hsh_load_config(confpath, &cfg) == 0)
+        hsh_apply_pipe_opts(&cfg);
+    else
+        hsh_apply_pipe_opts(NULL);
 }
 
+/* Alias expansion on the first word of line.
+ * Returns malloc'd replacement line, or NULL if no alias applies.
+ * In lazy mode the aliases file is only read once a first word shows up
+ * that could be an alias (not a builtin, not a path). The first
+ * pipeline reads only the config's pipe_size and pipefail.
+ */
+static char *hsh_alias_for_line(const char *line, int lazy) {
+    char first[128];
 
-int hsh_builtin_ps(char **args) {
-    if (args[1] == NULL || strcmp(args[1], "top") == 0) {
-        printf("=== Top processes (CPU) ===\n");
-        system("ps -eo pid,ppid,cmd,%mem,%cpu --sort=-%cpu | head -n 15");
-        return 1;
-    }
+    if (sscanf(line, " %127s", first) != 1)
+        return NULL;
 
-    if (strcmp(args[1], "find") == 0) {
-        if (!args[2]) {
-            printf("Usage: ps find <pattern>\n");
-            return 1;
-        }
-        char cmd[512];
-        snprintf(cmd, sizeof(cmd),
-                 "ps aux | grep -i -- '%s' | grep -v grep", args[2]);
-        system(cmd);
-        return 1;
+    if (lazy && !hsh_pipe_opts_loaded && strchr(line, '|'))
+        hsh_pipe_opts_load();
+
+    if (!hsh_aliases_loaded) {
+        if (lazy && (hsh_is_builtin(first) || strchr(first, '/')))
+            return NULL;
+        hsh_state_load(NULL);
     }
 
-    printf("ps: unknown subcommand '%s'\n", args[1]);
-    return 1;
+    if (hsh_snap) {
+        const char *value = hsh_snapshot_alias(hsh_snap, first);
+        return value ? strdup(value) : NULL;
+    }
+    return hsh_expand_alias(hsh_aliases, hsh_alias_count, first);
 }
 
 
-int hsh_builtin_config(char **args) {
-    (void)args;
+/* ===== interactive loop ===== */
 
-    char *home = getenv("HOME");
-    if (!home) {
-        fprintf(stderr, "config: HOME not set\n");
-        return 1;
-    }
+static void hsh_loop(const struct hsh_config *cfg) {
+    char *line;
+    int status;
+    int cmd_status = 0;
 
-    char confpath[512];
-    snprintf(confpath, sizeof(confpath), "%s/.config/hsh/config", home);
+    do {
+        if (hsh_got_sigint) {
+            hsh_got_sigint = 0;
+            write(STDOUT_FILENO, "\n", 1);
+        }
 
-    char *env_editor = getenv("EDITOR");
-    char editor[64] = {0};
+        /* draw status bar first */
+        hsh_draw_statusbar(cfg);
 
-    printf("=== Edit HorizonShell config ===\n");
-    printf("Config file: %s\n", confpath);
-    if (env_editor && env_editor[0] != '\0') {
-        printf("Detected $EDITOR = %s\n", env_editor);
-    }
+        /* let readline own the prompt so backspace doesn't delete it */
+        char prompt[64];
+        snprintf(prompt, sizeof(prompt),
+                 "\033[%d;%dmhsh$ \033[0m", cfg->fg, cfg->bg);
 
-    printf("Choose editor:\n");
-    if (env_editor && env_editor[0] != '\0')
-        printf("  1) Use $EDITOR (%s)\n", env_editor);
-    else
-        printf("  1) nano\n");
-    printf("  2) nano\n");
-    printf("  3) vim\n");
-    printf("  4) code (VS Code CLI)\n");
-    printf("Select [1-4] (default 1): ");
-
-    int choice = 1;
-    char buf[32];
-    if (fgets(buf, sizeof(buf), stdin)) {
-        int v;
-        if (sscanf(buf, "%d", &v) == 1 && v >= 1 && v <= 4)
-            choice = v;
-    }
+        line = hsh_input_readline(prompt);
+        if (!line)
+            break;
+
+        if (line[0] != '\0')
+            hsh_input_add_history(line);
 
-    if (choice == 1) {
-        if (env_editor && env_editor[0] != '\0') {
-            strncpy(editor, env_editor, sizeof(editor) - 1);
-        } else {
-            strncpy(editor, "nano", sizeof(editor) - 1);
+        /* alias expansion on first word only */
+        char *expanded = hsh_alias_for_line(line, 0);
+        if (expanded) {
+            free(line);
+            line = expanded;
         }
-    } else if (choice == 2) {
-        strncpy(editor, "nano", sizeof(editor) - 1);
-    } else if (choice == 3) {
-        strncpy(editor, "vim", sizeof(editor) - 1);
-    } else if (choice == 4) {
-        strncpy(editor, "code", sizeof(editor) - 1);
-    }
 
-    if (editor[0] == '\0') {
-        fprintf(stderr, "config: no editor selected\n");
-        return 1;
-    }
+        /* Normal shell parsing; lang is available as a builtin */
+        status = hsh_run_line(line, &cmd_status);
+
+        free(line);
+    } while (status);
 
-    char cmd[600];
-    snprintf(cmd, sizeof(cmd), "%s %s", editor, confpath);
-    printf("Opening config with: %s\n", cmd);
-    system(cmd);
-    printf("Done editing. Changes take effect next time you start hsh (or after reload).\n");
-    return 1;
+    printf("\n");
 }
 
 
-int hsh_builtin_alias(char **args) {
-    char *home = getenv("HOME");
-    if (!home) {
-        fprintf(stderr, "alias: HOME not set\n");
-        return 1;
-    }
+/* ===== script mode: run each non-comment line through shell =====
+ * cfg is NULL for hsh -s, which also loads aliases lazily.
+ */
 
-    char path[512];
-    snprintf(path, sizeof(path), "%s/.config/hsh/aliases", home);
+static int hsh_run_script(FILE *f, const struct hsh_config *cfg,
+                          int *last_status_out) {
+    char *line = NULL;
+    size_t sz = 0;
+    int status = 1;
+    int cmd_status = 0;
 
-    if (args[1] == NULL) {
-        printf("Aliases are stored in %s\n", path);
-        printf("Format: name value...\n");
-        printf("Example: ll ls -al --color=auto\n");
-        printf("Restart hsh after editing this file or adding aliases.\n");
-        return 1;
-    }
+    while (getline(&line, &sz, f) != -1) {
+        /* skip comments and blank lines */
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\0')
+            continue;
 
-    if (args[2] == NULL) {
-        printf("Usage: alias name value...\n");
-        return 1;
-    }
+        /* no readline, but we still want aliases */
+        char *expanded = hsh_alias_for_line(line, cfg == NULL);
 
-    char value[384] = {0};
-    for (int i = 2; args[i] != NULL; i++) {
-        if (i > 2)
-            strncat(value, " ", sizeof(value) - strlen(value) - 1);
-        strncat(value, args[i], sizeof(value) - strlen(value) - 1);
-    }
+        char *exec_line = line;
+        if (expanded) {
+            exec_line = expanded;
+        }
 
-    FILE *f = fopen(path, "a");
-    if (!f) {
-        perror("alias: fopen");
-        return 1;
+        status = hsh_run_line(exec_line, &cmd_status);
+
+        if (expanded)
+            free(expanded);
+
+        if (status == 0)  /* exit in script */
+            break;
     }
-    fprintf(f, "%s %s\n", args[1], value);
-    fclose(f);
 
-    printf("Alias added: %s -> %s\n", args[1], value);
-    printf("Restart hsh to load new aliases.\n");
-    return 1;
+    free(line);
+    if (last_status_out)
+        *last_status_out = cmd_status;
+    return 0;
 }
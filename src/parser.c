@@ -1,67 +1,605 @@
+#define _GNU_SOURCE   /* pipe2, F_SETPIPE_SZ, tee, splice */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/syscall.h>
 
 #include "extras.h"
 #include "parser.h"
+#include "builtins.h"
+#include "glob.h"
+#include "var.h"
 
 #define HSH_MAX_TOKENS 64
 
-/* forward declarations of main.c builtins */
-int hsh_builtin_help(char **args);
-int hsh_builtin_sys(char **args);
-int hsh_builtin_fs(char **args);
-int hsh_builtin_net(char **args);
-int hsh_builtin_ps(char **args);
-int hsh_builtin_config(char **args);
-int hsh_builtin_alias(char **args);
-int hsh_builtin_cd(char **args);
-int hsh_builtin_lang(char **args);
-
 /* local helpers */
 static int   hsh_execute(char **args, int *cmd_status_out);
 static int   hsh_execute_pipeline(char *line, int *cmd_status_out);
 static char **hsh_split_line_local(char *line);
 
+int hsh_is_builtin(const char *name) {
+    return hsh_builtin_find(name) != NULL;
+}
+
+/* F_SETPIPE_SZ for pipeline pipes; 0 keeps the kernel default (64 KiB).
+ * Set from the config's pipe_size or HSH_PIPESZ, and by `pipesz SIZE`.
+ */
+static long hsh_pipe_size = 0;
+static int  hsh_pipe_size_set = 0;   /* by pipesz: the config can't undo it */
+
+void hsh_set_pipe_size(long bytes) {
+    hsh_pipe_size = bytes > 0 ? bytes : 0;
+    hsh_pipe_size_set = 1;
+}
+
+long hsh_get_pipe_size(void) {
+    return hsh_pipe_size;
+}
+
+long hsh_parse_size(const char *s) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || v < 0)
+        return -1;
+
+    switch (*end) {
+    case 'k': case 'K': v <<= 10; end++; break;
+    case 'm': case 'M': v <<= 20; end++; break;
+    case 'g': case 'G': v <<= 30; end++; break;
+    default: break;
+    }
+    return *end == '\0' ? v : -1;
+}
+
+/* set -o pipefail: a pipeline fails if any stage does */
+static int hsh_pipefail = 0;
+static int hsh_pipefail_set = 0;
+
+void hsh_set_pipefail(int on) {
+    hsh_pipefail = on ? 1 : 0;
+    hsh_pipefail_set = 1;
+}
+
+void hsh_pipe_defaults(long size, int pipefail) {
+    if (size >= 0 && !hsh_pipe_size_set)
+        hsh_pipe_size = size;
+    if (pipefail >= 0 && !hsh_pipefail_set)
+        hsh_pipefail = pipefail ? 1 : 0;
+}
+
+int hsh_get_pipefail(void) {
+    return hsh_pipefail;
+}
+
+/* stages of the last pipeline, in command-line order */
+static struct hsh_pipestat hsh_stages[HSH_MAX_TOKENS];
+static int hsh_nstages = 0;
+
+int hsh_get_pipestatus(const struct hsh_pipestat **stages) {
+    *stages = hsh_stages;
+    return hsh_nstages;
+}
+
+static long hsh_tv_us(struct timeval tv) {
+    return (long)tv.tv_sec * 1000000L + (long)tv.tv_usec;
+}
+
+static long hsh_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+/* Children that run builtins never exec, so they would keep the
+ * interactive shell's Ctrl-C handler; give them the default back
+ * (an ignored SIGINT stays ignored). */
+static void hsh_child_sigint(void) {
+    struct sigaction sa;
+    if (sigaction(SIGINT, NULL, &sa) == 0 && sa.sa_handler != SIG_IGN)
+        signal(SIGINT, SIG_DFL);
+}
+
+/* set by hsh_exec_line(): a lone external command is exec'd in place */
+static int hsh_exec_last = 0;
+
 /* ----- simple tokenizer ----- */
 
+/* the ')' closing a "$(" whose body starts at p; NULL if unterminated */
+static const char *hsh_subst_end(const char *p) {
+    int depth = 1;
+    for (; *p; p++) {
+        if (*p == '(')
+            depth++;
+        else if (*p == ')' && --depth == 0)
+            return p;
+    }
+    return NULL;
+}
+
+/* first '|' of line outside $(...), or NULL */
+static char *hsh_pipe_sep(char *line) {
+    for (char *p = line; *p; p++) {
+        if (p[0] == '$' && p[1] == '(') {
+            const char *end = hsh_subst_end(p + 2);
+            if (!end)
+                return NULL;
+            p = (char *)end;
+        } else if (*p == '|') {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static int hsh_is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* words split at blanks, in place; a $(...) is one word whatever it holds */
 static char **hsh_split_line_local(char *line) {
     int bufsize = HSH_MAX_TOKENS, position = 0;
     char **tokens = malloc(bufsize * sizeof(char *));
-    char *token;
 
     if (!tokens) {
         perror("hsh: allocation error");
         exit(EXIT_FAILURE);
     }
 
-    token = strtok(line, " \t\r\n");
-    while (token != NULL && position < bufsize - 1) {
-        tokens[position++] = token;
-        token = strtok(NULL, " \t\r\n");
+    char *p = line;
+    while (position < bufsize - 1) {
+        while (hsh_is_blank(*p))
+            p++;
+        if (*p == '\0')
+            break;
+        tokens[position++] = p;
+        while (*p && !hsh_is_blank(*p)) {
+            if (p[0] == '$' && p[1] == '(') {
+                const char *end = hsh_subst_end(p + 2);
+                p = end ? (char *)end : p + strlen(p) - 1;
+            }
+            p++;
+        }
+        if (*p)
+            *p++ = '\0';
     }
     tokens[position] = NULL;
     return tokens;
 }
 
+/* ----- redirections: < > >> 2> 2>> 2>&1 ----- */
+
+#define HSH_MAX_REDIRS 8
+
+struct hsh_redir {
+    int fd;             /* descriptor being redirected */
+    int flags;          /* open() flags; 0 with dup_from >= 0 */
+    int dup_from;       /* N in >&N, else -1 */
+    const char *path;
+};
+
+/* "<", ">", ">>", "2>", "2>>", ">&2", "2>&1", ... with the word either
+ * attached (">out") or next. Returns the length of the operator, 0 if
+ * tok is not a redirection.
+ */
+static int hsh_redir_op(const char *tok, struct hsh_redir *r) {
+    const char *p = tok;
+    r->fd = -1;
+    if (*p >= '0' && *p <= '2' && (p[1] == '<' || p[1] == '>'))
+        r->fd = *p++ - '0';
+
+    if (*p == '<') {
+        if (r->fd < 0) r->fd = STDIN_FILENO;
+        r->flags = O_RDONLY;
+        p++;
+    } else if (*p == '>') {
+        if (r->fd < 0) r->fd = STDOUT_FILENO;
+        r->flags = O_WRONLY | O_CREAT | O_TRUNC;
+        if (*++p == '>') {
+            r->flags = O_WRONLY | O_CREAT | O_APPEND;
+            p++;
+        }
+    } else {
+        return 0;
+    }
+
+    r->dup_from = -1;
+    if (*p == '&' && p[1] >= '0' && p[1] <= '2' && p[2] == '\0') {
+        r->dup_from = p[1] - '0';
+        r->flags = 0;
+        p += 2;
+    }
+    return (int)(p - tok);
+}
+
+/* Take redirections out of args (in place). Returns how many were found,
+ * or -1 after a syntax error.
+ */
+static int hsh_redir_extract(char **args, struct hsh_redir *r, int max) {
+    int n = 0, out = 0;
+
+    for (int i = 0; args[i] != NULL; i++) {
+        struct hsh_redir cur;
+        int len = hsh_redir_op(args[i], &cur);
+        if (len == 0) {
+            args[out++] = args[i];
+            continue;
+        }
+
+        if (cur.dup_from < 0) {
+            cur.path = args[i][len] ? args[i] + len : args[++i];
+            if (cur.path == NULL) {
+                fprintf(stderr, "hsh: syntax error: no file after '%s'\n",
+                        args[i - 1]);
+                return -1;
+            }
+        }
+        if (n == max) {
+            fprintf(stderr, "hsh: too many redirections\n");
+            return -1;
+        }
+        r[n++] = cur;
+    }
+    args[out] = NULL;
+    return n;
+}
+
+/* Apply redirections to this process, left to right as in sh */
+static int hsh_redir_apply(const struct hsh_redir *r, int n) {
+    for (int i = 0; i < n; i++) {
+        if (r[i].dup_from >= 0) {
+            if (dup2(r[i].dup_from, r[i].fd) < 0) {
+                perror("hsh: dup2");
+                return -1;
+            }
+            continue;
+        }
+
+        int fd = open(r[i].path, r[i].flags | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            fprintf(stderr, "hsh: %s: %s\n", r[i].path, strerror(errno));
+            return -1;
+        }
+        if (dup2(fd, r[i].fd) < 0) {
+            perror("hsh: dup2");
+            close(fd);
+            return -1;
+        }
+        close(fd);
+    }
+    return 0;
+}
+
+/* Builtins run in the shell itself: keep copies of 0-2 to restore after */
+static void hsh_redir_save(int saved[3]) {
+    fflush(NULL);
+    for (int fd = 0; fd < 3; fd++)
+        saved[fd] = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+}
+
+static void hsh_redir_restore(const int saved[3]) {
+    fflush(NULL);
+    for (int fd = 0; fd < 3; fd++) {
+        if (saved[fd] < 0)
+            continue;
+        dup2(saved[fd], fd);
+        close(saved[fd]);
+    }
+}
+
+/* ----- command substitution: $(...) ----- */
+
+/* append n bytes of s to a growable buffer */
+static int hsh_buf_add(char **buf, size_t *len, size_t *cap,
+                       const char *s, size_t n) {
+    if (*len + n + 1 > *cap) {
+        size_t c = *cap ? *cap : 256;
+        while (c < *len + n + 1)
+            c *= 2;
+        char *p = realloc(*buf, c);
+        if (!p)
+            return -1;
+        *buf = p;
+        *cap = c;
+    }
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+    return 0;
+}
+
+/* read fd to EOF onto the buffer */
+static int hsh_buf_read(int fd, char **buf, size_t *len, size_t *cap) {
+    char chunk[16 * 1024];
+    for (;;) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            return 0;
+        if (hsh_buf_add(buf, len, cap, chunk, (size_t)n) < 0)
+            return -1;
+    }
+}
+
+/* Pipeline-safe builtins run right here, their stdout a memfd (a pipe
+ * we'd only read afterwards could fill up); anything else, including the
+ * builtins that change the shell, in a forked hsh that execs it in place,
+ * read through a pipe. No /bin/sh either way. */
+static char *hsh_capture(const char *cmd) {
+    char *line = strdup(cmd), *buf = NULL;
+    size_t len = 0, cap = 0;
+    int status = 0, ok = 0;
+    if (!line || hsh_buf_add(&buf, &len, &cap, "", 0) < 0)
+        goto out;
+
+    char first[64] = "";
+    sscanf(cmd, " %63s", first);
+    fflush(NULL);
+
+    const struct hsh_builtin *b = hsh_builtin_find(first);
+    if (b && (b->flags & HSH_BUILTIN_PIPE_SAFE)) {
+        int mfd = memfd_create("hsh-subst", MFD_CLOEXEC);
+        int saved = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+        if (mfd < 0 || saved < 0 || dup2(mfd, STDOUT_FILENO) < 0) {
+            perror("hsh: $(...)");
+            if (mfd >= 0) close(mfd);
+            if (saved >= 0) close(saved);
+            goto out;
+        }
+        int exec_last = hsh_exec_last;
+        hsh_exec_last = 0;
+        hsh_run_line(line, &status);
+        hsh_exec_last = exec_last;
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+        ok = lseek(mfd, 0, SEEK_SET) == 0 && hsh_buf_read(mfd, &buf, &len, &cap) == 0;
+        close(mfd);
+    } else {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) < 0) {
+            perror("hsh: pipe");
+            goto out;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            hsh_child_sigint();
+            if (dup2(fds[1], STDOUT_FILENO) < 0)
+                _exit(EXIT_FAILURE);
+            hsh_exec_line(line, &status);
+            fflush(NULL);
+            _exit(status);
+        }
+        close(fds[1]);
+        if (pid < 0)
+            perror("hsh: fork");
+        else
+            ok = hsh_buf_read(fds[0], &buf, &len, &cap) == 0;
+        close(fds[0]);
+        while (pid > 0 && waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+    }
+    if (!ok)
+        perror("hsh: $(...)");
+
+out:
+    free(line);
+    if (!ok) {
+        free(buf);
+        return NULL;
+    }
+    while (len > 0 && buf[len - 1] == '\n')
+        buf[--len] = '\0';
+    return buf;
+}
+
+/* ----- expansion: $(...) $NAME ${NAME} $?, then * ? [...] ** ----- */
+
+/* words being built for hsh_glob_argv() */
+struct hsh_words {
+    char  **w;
+    char   *noexpand;
+    size_t  n, cap;
+    char  **owned;      /* what to free once they are copied out */
+    size_t  nowned, owncap;
+};
+
+static int hsh_words_add(struct hsh_words *ws, char *w, char noexpand, int owned) {
+    if (ws->n + 1 >= ws->cap) {
+        size_t cap = ws->cap ? ws->cap * 2 : HSH_MAX_TOKENS;
+        char **nw = realloc(ws->w, cap * sizeof(*nw));
+        if (nw)
+            ws->w = nw;
+        char *nx = realloc(ws->noexpand, cap);
+        if (nx)
+            ws->noexpand = nx;
+        if (!nw || !nx)
+            return -1;
+        ws->cap = cap;
+    }
+    if (owned && ws->nowned == ws->owncap) {
+        size_t cap = ws->owncap ? ws->owncap * 2 : 16;
+        char **no = realloc(ws->owned, cap * sizeof(*no));
+        if (!no)
+            return -1;
+        ws->owned = no;
+        ws->owncap = cap;
+    }
+    if (owned)
+        ws->owned[ws->nowned++] = w;
+    ws->noexpand[ws->n] = noexpand;
+    ws->w[ws->n++] = w;
+    ws->w[ws->n] = NULL;
+    return 0;
+}
+
+/* finish the word in buf (if any) as one of ws */
+static int hsh_words_flush(struct hsh_words *ws, char **buf, size_t *len,
+                           size_t *cap, char noexpand) {
+    int rc = hsh_words_add(ws, *buf, noexpand, 1);
+    if (rc < 0)
+        free(*buf);
+    *buf = NULL;
+    *len = *cap = 0;
+    return rc;
+}
+
+/* tok with variables and $(...) expanded onto ws; command output is
+ * split into words at blanks. keep_empty for redirection targets. */
+static int hsh_expand_word(struct hsh_words *ws, const char *tok,
+                           char noexpand, int keep_empty) {
+    char *buf = NULL;
+    size_t len = 0, cap = 0, before = ws->n;
+    const char *p = tok;
+
+    while (*p) {
+        const char *sub = strstr(p, "$(");
+        size_t n = sub ? (size_t)(sub - p) : strlen(p);
+        if (n > 0) {
+            char *seg = strndup(p, n);
+            char *val = seg ? hsh_var_expand(seg) : NULL;
+            const char *v = val ? val : seg;
+            int rc = v ? hsh_buf_add(&buf, &len, &cap, v, strlen(v)) : -1;
+            free(seg);
+            free(val);
+            if (rc < 0)
+                goto fail;
+        }
+        if (!sub)
+            break;
+
+        const char *end = hsh_subst_end(sub + 2);
+        if (!end) {
+            fprintf(stderr, "hsh: missing ')' in %s\n", tok);
+            free(buf);
+            return -1;
+        }
+        char *cmd = strndup(sub + 2, (size_t)(end - sub - 2));
+        char *out = cmd ? hsh_capture(cmd) : NULL;
+        free(cmd);
+        if (!out) {
+            free(buf);
+            return -1;
+        }
+        for (const char *o = out; *o; o++) {
+            if (!hsh_is_blank(*o)) {
+                if (hsh_buf_add(&buf, &len, &cap, o, 1) < 0) {
+                    free(out);
+                    goto fail;
+                }
+            } else if (len > 0 && hsh_words_flush(ws, &buf, &len, &cap, noexpand) < 0) {
+                free(out);
+                goto fail;
+            }
+        }
+        free(out);
+        p = end + 1;
+    }
+
+    if (len > 0 || (keep_empty && ws->n == before)) {
+        if (!buf && hsh_buf_add(&buf, &len, &cap, "", 0) < 0)
+            goto fail;
+        return hsh_words_flush(ws, &buf, &len, &cap, noexpand);
+    }
+    free(buf);
+    return 0;
+
+fail:
+    free(buf);
+    perror("hsh: expansion");
+    return -1;
+}
+
+/* Expand tokens in place of the caller's vector (freed here). lang and
+ * alias lines are left alone; commands that take patterns themselves get
+ * variables but no wildcards, as do the words after redirection
+ * operators. A word that expands to nothing is dropped. NULL when
+ * expansion failed.
+ */
+static char **hsh_expand_words(char **tokens) {
+    if (!tokens[0])
+        return tokens;
+    const struct hsh_builtin *b = hsh_builtin_find(tokens[0]);
+    if (b && (b->flags & HSH_BUILTIN_VERBATIM))
+        return tokens;
+    int noglob = b && (b->flags & HSH_BUILTIN_PATTERNS) && tokens[1] &&
+        (strcmp(tokens[1], "find") == 0 || strcmp(tokens[1], "grep") == 0 ||
+         strcmp(tokens[1], "watch") == 0);
+
+    int dollar = 0;
+    for (int i = 0; tokens[i] != NULL; i++)
+        if (strchr(tokens[i], '$'))
+            dollar = 1;
+    if (noglob && !dollar)
+        return tokens;
+
+    struct hsh_words ws;
+    memset(&ws, 0, sizeof(ws));
+    int failed = 0, target = 0;
+    for (int i = 0; tokens[i] != NULL && !failed; i++) {
+        struct hsh_redir r;
+        int len = hsh_redir_op(tokens[i], &r);
+        char noexpand = noglob || len > 0 || target;
+        int keep = target;
+        /* the next word is a file name */
+        target = len > 0 && tokens[i][len] == '\0' && r.dup_from < 0;
+
+        if (strchr(tokens[i], '$')) {
+            failed = hsh_expand_word(&ws, tokens[i], noexpand, keep) < 0;
+        } else if (hsh_words_add(&ws, tokens[i], noexpand, 0) < 0) {
+            perror("hsh: expansion");
+            failed = 1;
+        }
+    }
+
+    char *none[] = { NULL };
+    char **out = NULL;
+    if (!failed)
+        out = hsh_glob_argv(ws.n ? ws.w : none, ws.noexpand);
+    for (size_t i = 0; i < ws.nowned; i++)
+        free(ws.owned[i]);
+    free(ws.owned);
+    free(ws.w);
+    free(ws.noexpand);
+    free(tokens);
+    return out;
+}
+
 /* ----- public entry: run one line (may contain pipes or () / )( operator) ----- */
 
+static int hsh_run_line_1(char *line, int *last_status_out);
+
+/* every line's status ends up in $? */
 int hsh_run_line(char *line, int *last_status_out) {
     int dummy_status = 0;
     if (!last_status_out)
         last_status_out = &dummy_status;
 
+    int shell_status = hsh_run_line_1(line, last_status_out);
+    hsh_var_set_status(*last_status_out);
+    return shell_status;
+}
+
+static int hsh_run_line_1(char *line, int *last_status_out) {
     if (!line) {
         *last_status_out = 0;
         return 1;
     }
 
-    /* handle pipelines first, on a copy because strtok_r mutates */
-    if (strchr(line, '|') != NULL) {
+    /* handle pipelines first, on a copy because splitting mutates */
+    if (hsh_pipe_sep(line) != NULL) {
         char *pipe_copy = strdup(line);
         if (!pipe_copy) {
             perror("hsh: strdup");
@@ -122,6 +660,9 @@ int hsh_run_line(char *line, int *last_status_out) {
         free(tokens);
         free(work);
 
+        /* both sides need to return here */
+        hsh_exec_last = 0;
+
         int status_left = 0;  /* command exit code */
         int status_right = 0;
 
@@ -151,6 +692,12 @@ int hsh_run_line(char *line, int *last_status_out) {
     }
 
     /* no ()/)( operator: normal single-command execution */
+    tokens = hsh_expand_words(tokens);
+    if (!tokens) {
+        free(work);
+        *last_status_out = 1;
+        return 1;
+    }
     int shell_status = hsh_execute(tokens, last_status_out);
 
     free(tokens);
@@ -158,8 +705,24 @@ int hsh_run_line(char *line, int *last_status_out) {
     return shell_status;
 }
 
+int hsh_exec_line(char *line, int *last_status_out) {
+    hsh_exec_last = 1;
+    int s = hsh_run_line(line, last_status_out);
+    hsh_exec_last = 0;
+    return s;
+}
+
 /* ----- single-command path (no pipes) ----- */
 
+/* cat with only file operands ("-" is stdin) */
+static int hsh_cat_is_plain(char **args) {
+    for (int i = 1; args[i] != NULL; i++) {
+        if (args[i][0] == '-' && args[i][1] != '\0')
+            return 0;
+    }
+    return 1;
+}
+
 static int hsh_execute(char **args, int *cmd_status_out) {
     pid_t pid;
     int status = 0;
@@ -167,63 +730,65 @@ static int hsh_execute(char **args, int *cmd_status_out) {
     if (!cmd_status_out)
         cmd_status_out = &status;
 
-    if (args[0] == NULL) {
-        *cmd_status_out = 0;
-        return 1;
-    }
-
-    /* builtins */
-    if (strcmp(args[0], "exit") == 0)
-        return 0;  /* signal main loop to exit */
-
-    if (strcmp(args[0], "cd") == 0) {
-        *cmd_status_out = hsh_builtin_cd(args);
-        return 1;
-    }
-
-    if (strcmp(args[0], "help") == 0) {
-        *cmd_status_out = hsh_builtin_help(args);
+    struct hsh_redir redirs[HSH_MAX_REDIRS];
+    int nredir = hsh_redir_extract(args, redirs, HSH_MAX_REDIRS);
+    if (nredir < 0) {
+        *cmd_status_out = 1;
         return 1;
     }
 
-    if (strcmp(args[0], "config") == 0) {
-        *cmd_status_out = hsh_builtin_config(args);
-        return 1;
-    }
+    /* builtins (and a bare "> file") get redirected in place, then undone */
+    if (nredir > 0 && (args[0] == NULL || hsh_is_builtin(args[0]) ||
+                       strcmp(args[0], "cat") == 0)) {
+        int saved[3];
+        int shell_status = 1;
 
-    if (strcmp(args[0], "alias") == 0) {
-        *cmd_status_out = hsh_builtin_alias(args);
-        return 1;
-    }
-
-    if (strcmp(args[0], "sys") == 0) {
-        *cmd_status_out = hsh_builtin_sys(args);
-        return 1;
+        hsh_redir_save(saved);
+        if (hsh_redir_apply(redirs, nredir) == 0)
+            shell_status = hsh_execute(args, cmd_status_out);
+        else
+            *cmd_status_out = 1;
+        hsh_redir_restore(saved);
+        return shell_status;
     }
 
-    if (strcmp(args[0], "fs") == 0) {
-        *cmd_status_out = hsh_builtin_fs(args);
+    if (args[0] == NULL) {
+        *cmd_status_out = 0;
         return 1;
     }
 
-    if (strcmp(args[0], "net") == 0) {
-        *cmd_status_out = hsh_builtin_net(args);
+    /* builtins (builtins.def); they return 1 ("keep running") when they
+     * succeeded */
+    const struct hsh_builtin *b = hsh_builtin_find(args[0]);
+    if (b) {
+        if (!b->fn)
+            return 0;  /* exit: signal main loop to exit */
+        hsh_exec_last = 0;  /* lines a builtin runs (lang) must return here */
+        *cmd_status_out = b->fn(args) ? 0 : 1;
         return 1;
     }
 
-    if (strcmp(args[0], "ps") == 0) {
-        *cmd_status_out = hsh_builtin_ps(args);
+    /* cat FILE...: in-process, so file-to-file copies stay in the kernel;
+     * cat with options is the real one */
+    if (strcmp(args[0], "cat") == 0 && hsh_cat_is_plain(args)) {
+        *cmd_status_out = hsh_builtin_cat(args) ? 0 : 1;
         return 1;
     }
 
-    if (strcmp(args[0], "lang") == 0) {
-        *cmd_status_out = hsh_builtin_lang(args);
-        return 1;
+    /* external command; replaces this process under hsh_exec_line() */
+    if (hsh_exec_last) {
+        fflush(NULL);
+        if (hsh_redir_apply(redirs, nredir) < 0)
+            exit(EXIT_FAILURE);
+        execvp(args[0], args);
+        perror("hsh");
+        exit(EXIT_FAILURE);
     }
 
-    /* external command */
     pid = fork();
     if (pid == 0) {
+        if (hsh_redir_apply(redirs, nredir) < 0)
+            exit(EXIT_FAILURE);
         execvp(args[0], args);
         perror("hsh");
         exit(EXIT_FAILURE);
@@ -248,16 +813,293 @@ static int hsh_execute(char **args, int *cmd_status_out) {
     return 1;  /* keep shell running */
 }
 
-/* ----- pipeline path: cmd1 | cmd2 | ... ----- */
+/* ----- pipeline path: cmd1 | cmd2 | ...  and  producer |+ a |+ b ----- */
+
+static int hsh_pipe_open(int fds[2], long size) {
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        perror("hsh: pipe");
+        return -1;
+    }
+    if (size > 0 && fcntl(fds[1], F_SETPIPE_SZ, (int)size) < 0) {
+        static int warned = 0;
+        if (!warned) {
+            fprintf(stderr, "hsh: pipe size %ld: %s\n", size, strerror(errno));
+            warned = 1;
+        }
+    }
+    return 0;
+}
+
+/* child side of a stage: everything but 0/1/2 is O_CLOEXEC */
+static void hsh_pipeline_exec(const char *cmdline) {
+    char *argv_buf = strdup(cmdline);
+    if (!argv_buf) {
+        perror("hsh: strdup");
+        exit(EXIT_FAILURE);
+    }
+
+    char **argv_tokens = hsh_expand_words(hsh_split_line_local(argv_buf));
+    if (!argv_tokens)
+        exit(EXIT_FAILURE);
+    struct hsh_redir redirs[HSH_MAX_REDIRS];
+    int nredir = hsh_redir_extract(argv_tokens, redirs, HSH_MAX_REDIRS);
+    if (nredir < 0 || hsh_redir_apply(redirs, nredir) < 0)
+        exit(EXIT_FAILURE);
+
+    if (argv_tokens[0] == NULL)
+        exit(EXIT_SUCCESS);
+
+    /* builtins run right here, so `fs find -0 | xargs -0 ...` works.
+     * With no exec, the O_CLOEXEC pipe ends we inherited stay open (our
+     * own write end included, and we'd never see EOF): drop them first. */
+    if (hsh_is_builtin(argv_tokens[0]) ||
+        (strcmp(argv_tokens[0], "cat") == 0 && hsh_cat_is_plain(argv_tokens))) {
+        int status = 0;
+        if (close_range(3, ~0U, 0) < 0) {
+            long max = sysconf(_SC_OPEN_MAX);
+            for (int fd = 3; fd < (max > 0 ? max : 1024); fd++)
+                close(fd);
+        }
+        hsh_execute(argv_tokens, &status);
+        fflush(NULL);
+        exit(status);
+    }
+
+    execvp(argv_tokens[0], argv_tokens);
+    perror("hsh");
+    exit(EXIT_FAILURE);
+}
+
+/* fork a stage reading from in and writing to out (-1: inherit) */
+static pid_t hsh_pipeline_spawn(const char *cmdline, int in, int out) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("hsh: fork");
+        return -1;
+    }
+    if (pid == 0) {
+        hsh_child_sigint();
+        if (in >= 0 && dup2(in, STDIN_FILENO) < 0) {
+            perror("hsh: dup2 in");
+            exit(EXIT_FAILURE);
+        }
+        if (out >= 0 && dup2(out, STDOUT_FILENO) < 0) {
+            perror("hsh: dup2 out");
+            exit(EXIT_FAILURE);
+        }
+        hsh_pipeline_exec(cmdline);
+    }
+    return pid;
+}
+
+#define HSH_FANOUT_CHUNK (1 << 20)
+
+static int hsh_write_all(int fd, const char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static void hsh_fanout_drop(int *outs, int k) {
+    close(outs[k]);
+    outs[k] = -1;
+}
+
+/* Fan-out stage (runs in its own child): copies in to every outs[k].
+ *
+ * Each chunk is tee(2)'d to all consumers but the last, which gets it by
+ * splice(2), consuming it from in; the data never enters userspace. tee
+ * can come up short when a consumer's pipe is full, and it always copies
+ * from the head of in, so then the chunk is read into a buffer instead
+ * and the missing tails are written from there. A consumer that exits is
+ * dropped; once all are gone the producer gets EPIPE.
+ */
+static void hsh_fanout_run(int in, int *outs, int n) {
+    size_t *got = calloc((size_t)n, sizeof(*got));
+    char *buf = malloc(HSH_FANOUT_CHUNK);
+    int *live = malloc((size_t)n * sizeof(*live));
+    int use_tee = 1;
+
+    hsh_child_sigint();
+
+    if (!got || !buf || !live) {
+        perror("hsh: fan-out");
+        _exit(EXIT_FAILURE);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int nlive = 0;
+        for (int k = 0; k < n; k++)
+            if (outs[k] >= 0) live[nlive++] = k;
+        if (nlive == 0)
+            _exit(EXIT_SUCCESS);
+
+        int last = live[nlive - 1];
+        ssize_t len;
+
+        if (!use_tee) {
+            /* tee refused these fds: plain read + write to everyone */
+            len = read(in, buf, HSH_FANOUT_CHUNK);
+            if (len == 0) _exit(EXIT_SUCCESS);
+            if (len < 0) {
+                if (errno == EINTR) continue;
+                _exit(EXIT_FAILURE);
+            }
+            for (int i = 0; i < nlive; i++)
+                if (hsh_write_all(outs[live[i]], buf, (size_t)len) < 0)
+                    hsh_fanout_drop(outs, live[i]);
+            continue;
+        }
+
+        if (nlive == 1) {
+            len = splice(in, NULL, outs[last], NULL, HSH_FANOUT_CHUNK,
+                         SPLICE_F_MOVE);
+        } else {
+            len = tee(in, outs[live[0]], HSH_FANOUT_CHUNK, 0);
+            if (len > 0)
+                got[live[0]] = (size_t)len;
+        }
+        if (len == 0)
+            _exit(EXIT_SUCCESS);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EPIPE) {
+                hsh_fanout_drop(outs, nlive == 1 ? last : live[0]);
+                continue;
+            }
+            if (errno == EINVAL) {
+                use_tee = 0;
+                continue;
+            }
+            _exit(EXIT_FAILURE);
+        }
+        if (nlive == 1)
+            continue;
+
+        int shortfall = 0;
+        for (int i = 1; i < nlive - 1; i++) {
+            int k = live[i];
+            ssize_t m;
+            do {
+                m = tee(in, outs[k], (size_t)len, 0);
+            } while (m < 0 && errno == EINTR);
+            if (m < 0) {
+                hsh_fanout_drop(outs, k);   /* EPIPE: consumer is gone */
+                continue;
+            }
+            got[k] = (size_t)m;
+            if (m < len)
+                shortfall = 1;
+        }
+
+        if (!shortfall) {
+            /* everyone else has the chunk: move it to the last consumer */
+            ssize_t done = 0;
+            while (done < len) {
+                ssize_t m = splice(in, NULL, outs[last], NULL,
+                                   (size_t)(len - done), SPLICE_F_MOVE);
+                if (m < 0 && errno == EINTR)
+                    continue;
+                if (m <= 0) {
+                    /* last consumer is gone: discard the rest of the chunk */
+                    hsh_fanout_drop(outs, last);
+                    while (done < len) {
+                        m = read(in, buf, (size_t)(len - done));
+                        if (m <= 0 && errno != EINTR) _exit(EXIT_FAILURE);
+                        if (m > 0) done += m;
+                    }
+                    break;
+                }
+                done += m;
+            }
+            continue;
+        }
+
+        /* short tee: take the chunk out of the pipe and fill in the tails */
+        ssize_t done = 0;
+        while (done < len) {
+            ssize_t m = read(in, buf + done, (size_t)(len - done));
+            if (m < 0 && errno == EINTR) continue;
+            if (m <= 0) _exit(EXIT_FAILURE);
+            done += m;
+        }
+        got[last] = 0;
+        for (int i = 0; i < nlive; i++) {
+            int k = live[i];
+            if (outs[k] >= 0 && got[k] < (size_t)len &&
+                hsh_write_all(outs[k], buf + got[k], (size_t)len - got[k]) < 0)
+                hsh_fanout_drop(outs, k);
+        }
+    }
+}
+
+/* Reap pid and record it in hsh_stages[stage] (stage -1: the fan-out
+ * child). Returns 1 once reaped (or on error), 0 if WNOHANG found it
+ * still running. */
+static int hsh_stage_reap(pid_t pid, int flags, int stage,
+                          const long *started_us) {
+    int status = 0;
+    struct rusage ru;
+    pid_t r;
+
+    while ((r = wait4(pid, &status, flags, &ru)) < 0 && errno == EINTR)
+        ;
+    if (r == 0)
+        return 0;
+    if (r < 0) {
+        perror("hsh: wait4");
+        return 1;
+    }
+    if (stage < 0)
+        return 1;
+
+    struct hsh_pipestat *st = &hsh_stages[stage];
+    st->wall_us = hsh_now_us() - started_us[stage];
+    st->user_us = hsh_tv_us(ru.ru_utime);
+    st->sys_us = hsh_tv_us(ru.ru_stime);
+    if (WIFEXITED(status)) {
+        st->status = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        st->signal = WTERMSIG(status);
+    }
+    return 1;
+}
 
 static int hsh_execute_pipeline(char *line, int *cmd_status_out) {
     char *segments[HSH_MAX_TOKENS];
     int seg_count = 0;
+    int fanout = -1;    /* index of the first |+ consumer */
 
-    char *saveptr;
-    char *seg = strtok_r(line, "|", &saveptr);
-    while (seg && seg_count < HSH_MAX_TOKENS - 1) {
+    char *seg = line, *next;
+    for (; seg && seg_count < HSH_MAX_TOKENS - 1; seg = next) {
+        next = hsh_pipe_sep(seg);
+        if (next)
+            *next++ = '\0';
         while (*seg == ' ' || *seg == '\t') seg++;
+
+        /* "|+ cmd": another consumer of the stage before the first |+ */
+        int plus = (*seg == '+');
+        if (plus) {
+            seg++;
+            while (*seg == ' ' || *seg == '\t') seg++;
+        }
+        if ((plus && seg_count == 0) || (!plus && fanout >= 0)) {
+            fprintf(stderr, "hsh: |+ consumers must come last: "
+                            "producer | ... |+ a |+ b\n");
+            if (cmd_status_out) *cmd_status_out = 1;
+            return 1;
+        }
+        if (plus && fanout < 0)
+            fanout = seg_count;
+
         char *end = seg + strlen(seg) - 1;
         while (end >= seg && (*end == ' ' || *end == '\t' || *end == '\n')) {
             *end = '\0';
@@ -266,7 +1108,6 @@ static int hsh_execute_pipeline(char *line, int *cmd_status_out) {
         if (*seg != '\0') {
             segments[seg_count++] = seg;
         }
-        seg = strtok_r(NULL, "|", &saveptr);
     }
     segments[seg_count] = NULL;
 
@@ -275,87 +1116,166 @@ static int hsh_execute_pipeline(char *line, int *cmd_status_out) {
         return 1;
     }
 
-    int num_cmds = seg_count;
-    int pipes[HSH_MAX_TOKENS][2];
+    /* pipesz SIZE cmd1 | cmd2 ...: buffer size for this pipeline only */
+    long pipe_size = hsh_pipe_size;
+    if (strncmp(segments[0], "pipesz", 6) == 0 &&
+        (segments[0][6] == ' ' || segments[0][6] == '\t')) {
+        char *p = segments[0] + 6;
+        while (*p == ' ' || *p == '\t') p++;
+        char *size = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+        if (*p) *p++ = '\0';
+        while (*p == ' ' || *p == '\t') p++;
 
-    for (int i = 0; i < num_cmds - 1; i++) {
-        if (pipe(pipes[i]) < 0) {
-            perror("hsh: pipe");
+        pipe_size = hsh_parse_size(size);
+        if (pipe_size < 0 || *p == '\0') {
+            fprintf(stderr, "pipesz: usage: pipesz SIZE cmd | cmd ...\n");
             if (cmd_status_out) *cmd_status_out = 1;
             return 1;
         }
+        segments[0] = p;
     }
 
+    int num_cmds = fanout >= 0 ? fanout : seg_count;
+    int prev_in = -1;   /* read end feeding stage i */
+    int failed = 0;
+    pid_t fanout_pid = -1;
+    pid_t pids[HSH_MAX_TOKENS];
+    long started_us[HSH_MAX_TOKENS];
+
+    for (int i = 0; i < seg_count; i++)
+        pids[i] = -1;
+
+    /* one pipe at a time, made just before the stage that writes it;
+     * O_CLOEXEC means children only keep what they dup2 onto 0 and 1 */
     for (int i = 0; i < num_cmds; i++) {
-        pid_t pid = fork();
-        if (pid < 0) {
-            perror("hsh: fork");
-            if (cmd_status_out) *cmd_status_out = 1;
-            return 1;
+        int next[2] = { -1, -1 };
+
+        if ((i < num_cmds - 1 || fanout >= 0) &&
+            hsh_pipe_open(next, pipe_size) < 0) {
+            failed = 1;
+            break;
         }
 
-        if (pid == 0) {
-            if (i > 0) {
-                if (dup2(pipes[i-1][0], STDIN_FILENO) < 0) {
-                    perror("hsh: dup2 in");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            if (i < num_cmds - 1) {
-                if (dup2(pipes[i][1], STDOUT_FILENO) < 0) {
-                    perror("hsh: dup2 out");
-                    exit(EXIT_FAILURE);
-                }
+        started_us[i] = hsh_now_us();
+        pids[i] = hsh_pipeline_spawn(segments[i], prev_in, next[1]);
+        if (pids[i] < 0) {
+            if (next[0] >= 0) {
+                close(next[0]);
+                close(next[1]);
             }
+            failed = 1;
+            break;
+        }
 
-            for (int j = 0; j < num_cmds - 1; j++) {
-                close(pipes[j][0]);
-                close(pipes[j][1]);
-            }
+        /* parent: keep only the read end the next stage needs */
+        if (prev_in >= 0) close(prev_in);
+        if (next[1] >= 0) close(next[1]);
+        prev_in = next[0];
+    }
 
-            char *cmdline = segments[i];
-            char *argv_buf = strdup(cmdline);
-            if (!argv_buf) {
-                perror("hsh: strdup");
-                exit(EXIT_FAILURE);
-            }
+    /* fan-out: one pipe per consumer, fed by a tee/splice stage */
+    if (!failed && fanout >= 0) {
+        int nout = seg_count - fanout;
+        int outs[HSH_MAX_TOKENS];
+        int started = 0;
 
-            char *argv_tokens[HSH_MAX_TOKENS];
-            int argc = 0;
-            char *tok = strtok(argv_buf, " \t\r\n");
-            while (tok && argc < HSH_MAX_TOKENS - 1) {
-                argv_tokens[argc++] = tok;
-                tok = strtok(NULL, " \t\r\n");
+        for (; started < nout; started++) {
+            int i = fanout + started;
+            int p[2];
+            if (hsh_pipe_open(p, pipe_size) < 0)
+                break;
+            started_us[i] = hsh_now_us();
+            pids[i] = hsh_pipeline_spawn(segments[i], p[0], -1);
+            close(p[0]);
+            if (pids[i] < 0) {
+                close(p[1]);
+                break;
             }
-            argv_tokens[argc] = NULL;
+            outs[started] = p[1];
+        }
+        if (started < nout)
+            failed = 1;
 
-            if (argv_tokens[0] == NULL) {
-                free(argv_buf);
-                exit(EXIT_SUCCESS);
-            }
+        fanout_pid = started > 0 ? fork() : -1;
+        if (fanout_pid == 0)
+            hsh_fanout_run(prev_in, outs, started);
+        if (started > 0 && fanout_pid < 0) {
+            perror("hsh: fork");
+            failed = 1;
+        }
+        for (int k = 0; k < started; k++)
+            close(outs[k]);
+    }
+    if (prev_in >= 0) close(prev_in);
 
-            execvp(argv_tokens[0], argv_tokens);
-            perror("hsh");
-            free(argv_buf);
-            exit(EXIT_FAILURE);
+    /* reap stages as they exit, so each wall time ends at its own exit;
+     * statuses are still stored by position on the command line */
+    for (int i = 0; i < hsh_nstages; i++)
+        free(hsh_stages[i].cmd);
+    hsh_nstages = seg_count;
+
+    /* only the pipeline's own children are waited for: one pidfd each,
+     * polled; a pid without a pidfd is waited for last, blocking */
+    struct pollfd pfds[HSH_MAX_TOKENS + 1];
+    pid_t wpids[HSH_MAX_TOKENS + 1];
+    int wstage[HSH_MAX_TOKENS + 1];
+    int nw = 0, left = 0;
+
+    for (int i = 0; i <= seg_count; i++) {
+        pid_t pid = i < seg_count ? pids[i] : fanout_pid;
+        if (i < seg_count) {
+            struct hsh_pipestat *st = &hsh_stages[i];
+            memset(st, 0, sizeof(*st));
+            st->cmd = strdup(segments[i]);
+            st->status = 1;
         }
-        /* parent continues loop */
+        if (pid <= 0)
+            continue;
+        wpids[nw] = pid;
+        wstage[nw] = i < seg_count ? i : -1;
+        pfds[nw].fd = (int)syscall(SYS_pidfd_open, pid, 0);
+        pfds[nw].events = POLLIN;
+        if (pfds[nw].fd >= 0)
+            left++;
+        nw++;
     }
 
-    for (int i = 0; i < num_cmds - 1; i++) {
-        close(pipes[i][0]);
-        close(pipes[i][1]);
+    while (left > 0) {
+        if (poll(pfds, (nfds_t)nw, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("hsh: poll");
+            break;
+        }
+        for (int k = 0; k < nw; k++) {
+            if (pfds[k].fd < 0 || !pfds[k].revents)
+                continue;
+            if (hsh_stage_reap(wpids[k], WNOHANG, wstage[k], started_us) == 0)
+                continue;
+            close(pfds[k].fd);
+            pfds[k].fd = -1;
+            wpids[k] = -1;
+            left--;
+        }
+    }
+    for (int k = 0; k < nw; k++) {
+        if (pfds[k].fd >= 0)
+            close(pfds[k].fd);
+        if (wpids[k] > 0)
+            hsh_stage_reap(wpids[k], 0, wstage[k], started_us);
     }
 
-    int status = 0;
     int last_status = 0;
-    while (wait(&status) > 0) {
-        if (WIFEXITED(status))
-            last_status = WEXITSTATUS(status);
-        else
-            last_status = 1;
+    int fail_status = 0;
+    for (int i = 0; i < seg_count; i++) {
+        if (hsh_stages[i].status != 0)
+            fail_status = hsh_stages[i].status;
+        last_status = hsh_stages[i].status;
     }
 
-    if (cmd_status_out) *cmd_status_out = last_status;
+    if (hsh_pipefail)
+        last_status = fail_status;
+    if (cmd_status_out) *cmd_status_out = failed ? 1 : last_status;
     return 1;
 }
@@ -3,12 +3,57 @@
 
 /* Execute a full command line (after alias expansion).
  * Handles:
- *   - Builtins (help, exit, config, alias, sys, fs, net, ps)
+ *   - Builtins (help, exit, config, alias, sys, fs, net, ps, ...)
  *   - External commands
  *   - Simple pipelines with '|'
  * Returns 0 to exit shell, 1 to continue.
  */
 int hsh_run_line(char *line, int *last_status_out);
 
+/* Like hsh_run_line, but for the last thing this process does: a single
+ * external command replaces the process instead of fork + wait.
+ */
+int hsh_exec_line(char *line, int *last_status_out);
+
+/* 1 if name is run in-process by hsh_run_line, 0 otherwise */
+int hsh_is_builtin(const char *name);
+
+/* Pipe buffer size (F_SETPIPE_SZ) for pipelines; 0 = kernel default.
+ * `pipesz SIZE cmd | ...` overrides it for one pipeline.
+ */
+void hsh_set_pipe_size(long bytes);
+long hsh_get_pipe_size(void);
+
+/* "65536", "256K", "1M" -> bytes; -1 if malformed */
+long hsh_parse_size(const char *s);
+
+/* set -o pipefail: a pipeline's status is that of its rightmost failing
+ * stage instead of its last stage.
+ */
+void hsh_set_pipefail(int on);
+int  hsh_get_pipefail(void);
+
+/* Defaults from the config / environment (-1 = no change). A size or
+ * pipefail the session already set with pipesz / set -o is kept, since
+ * the config is loaded lazily, on the first pipeline.
+ */
+void hsh_pipe_defaults(long size, int pipefail);
+
+/* One stage of the last pipeline (`pipestatus`). Times are microseconds;
+ * CPU time comes from wait4(2). A stage killed by a signal has status 1
+ * and signal set, as for simple commands.
+ */
+struct hsh_pipestat {
+    char *cmd;
+    int   status;
+    int   signal;
+    long  wall_us;
+    long  user_us;
+    long  sys_us;
+};
+
+/* stages of the last pipeline, in command-line order; returns the count */
+int hsh_get_pipestatus(const struct hsh_pipestat **stages);
+
 
 #endif
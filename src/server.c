@@ -0,0 +1,251 @@
+#define _GNU_SOURCE  /* accept4 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "server.h"
+
+extern char **environ;
+
+static void hsh_server_reap(int sig) {
+    (void)sig;
+    int saved = errno;
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+        ;
+    errno = saved;
+}
+
+static int hsh_read_full(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* receive the request header together with the client's stdio fds */
+static int hsh_server_recv_hdr(int conn, struct hsh_server_req *req, int fds[3]) {
+    char cbuf[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = { req, sizeof(*req) };
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    if (n != (ssize_t)sizeof(*req))
+        return -1;
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    if (!c || c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS ||
+        c->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+        return -1;
+    memcpy(fds, CMSG_DATA(c), 3 * sizeof(int));
+
+    if (req->magic != HSH_SERVER_MAGIC || req->argc == 0 ||
+        req->len > HSH_SERVER_MAX_REQ)
+        return -1;
+    return 0;
+}
+
+/* Forked by the worker once the request is read: turns signal bytes from
+ * the client into signals for the worker's process group, and a closed
+ * connection into SIGHUP. The worker kills it before answering. */
+static pid_t hsh_server_watch(int conn) {
+    pid_t pgrp = getpid();
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != pgrp)
+        _exit(0);
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGQUIT, SIG_IGN);
+    for (int i = 0; i < 3; i++)
+        close(i);
+
+    unsigned char sig;
+    for (;;) {
+        ssize_t n = read(conn, &sig, 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            kill(-pgrp, SIGHUP);
+            _exit(0);
+        }
+        if (sig == SIGINT || sig == SIGTERM || sig == SIGHUP || sig == SIGQUIT)
+            kill(-pgrp, sig);
+    }
+}
+
+/* runs in the forked worker; never returns */
+static void hsh_server_worker(int conn, int (*run)(int, char **)) {
+    struct hsh_server_req req;
+    int fds[3];
+    int32_t status = 1;
+
+    signal(SIGCHLD, SIG_DFL);
+    setpgid(0, 0);   /* the command's group, for forwarded signals */
+    signal(SIGINT, SIG_DFL);   /* not what a backgrounded server inherited */
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+
+    if (hsh_server_recv_hdr(conn, &req, fds) != 0)
+        _exit(1);
+
+    char *buf = malloc(req.len + 1);
+    char **argv = calloc(req.argc + 1, sizeof(char *));
+    char **envp = calloc(req.envc + 1, sizeof(char *));
+    if (!buf || !argv || !envp || hsh_read_full(conn, buf, req.len) != 0)
+        _exit(1);
+    buf[req.len] = '\0';
+
+    /* split cwd, argv, env */
+    char *p = buf, *end = buf + req.len;
+    char *cwd = p;
+    p += strlen(p) + 1;
+    for (uint32_t i = 0; i < req.argc; i++) {
+        if (p >= end)
+            _exit(1);
+        argv[i] = p;
+        p += strlen(p) + 1;
+    }
+    for (uint32_t i = 0; i < req.envc; i++) {
+        if (p >= end)
+            _exit(1);
+        envp[i] = p;
+        p += strlen(p) + 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (dup2(fds[i], i) < 0)
+            _exit(1);
+        close(fds[i]);
+    }
+
+    pid_t watcher = hsh_server_watch(conn);
+
+    environ = envp;
+    if (chdir(cwd) != 0)
+        perror("hsh: chdir");
+    else
+        status = run((int)req.argc, argv);
+
+    fflush(stdout);
+    fflush(stderr);
+    if (watcher > 0) {
+        kill(watcher, SIGKILL);
+        while (waitpid(watcher, NULL, 0) < 0 && errno == EINTR)
+            ;
+    }
+    if (write(conn, &status, sizeof(status)) != (ssize_t)sizeof(status))
+        _exit(1);
+    _exit(0);
+}
+
+int hsh_server_main(const char *sockpath, int (*run)(int argc, char **argv)) {
+    struct sockaddr_un addr;
+
+    if (strlen(sockpath) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "hsh: socket path too long: %s\n", sockpath);
+        return 1;
+    }
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0) {
+        perror("hsh: socket");
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sockpath);
+
+    /* replace a stale socket, never anything else */
+    struct stat st;
+    if (lstat(sockpath, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "hsh: %s exists and is not a socket\n", sockpath);
+            close(lfd);
+            return 1;
+        }
+        unlink(sockpath);
+    }
+
+    /* only our user may connect: 0600, and peers are checked below */
+    mode_t mask = umask(077);
+    int rc = bind(lfd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (rc != 0 || chmod(sockpath, 0600) != 0 || listen(lfd, 128) != 0) {
+        perror("hsh: bind");
+        close(lfd);
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = hsh_server_reap;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "hsh: serving on %s (pid %ld)\n", sockpath, (long)getpid());
+
+    for (;;) {
+        int conn = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("hsh: accept");
+            break;
+        }
+
+        struct ucred cred;
+        socklen_t clen = sizeof(cred);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &clen) != 0 ||
+            cred.uid != getuid()) {
+            fprintf(stderr, "hsh: rejected connection from uid %ld\n",
+                    (long)cred.uid);
+            close(conn);
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(lfd);
+            signal(SIGPIPE, SIG_DFL);
+            hsh_server_worker(conn, run);
+        }
+        if (pid < 0)
+            perror("hsh: fork");
+        close(conn);
+    }
+
+    close(lfd);
+    unlink(sockpath);
+    return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef HSH_SERVER_H
+#define HSH_SERVER_H
+
+#include <stdint.h>
+
+/* hsh --server <socket> / hsh-client wire format.
+ *
+ * The client sends one struct hsh_server_req with its stdin, stdout and
+ * stderr attached as SCM_RIGHTS, followed by req.len bytes of
+ * NUL-terminated strings: cwd, argv[0..argc-1], env[0..envc-1].
+ * While it waits, the client may send single bytes, each a signal number
+ * (SIGINT, SIGTERM, SIGHUP, SIGQUIT) for the command's process group;
+ * closing the connection sends SIGHUP. The server answers with a single
+ * int32_t exit status. Only peers with the server's uid are served.
+ */
+
+#define HSH_SERVER_MAGIC   0x31485348u   /* "HSH1" */
+#define HSH_SERVER_MAX_REQ (4u << 20)
+
+struct hsh_server_req {
+    uint32_t magic;
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t len;
+};
+
+/* Run the server loop on sockpath. Each request is handled in a forked
+ * copy of the warm process by calling run(argc, argv) with the client's
+ * fds, cwd and environment in place. Only returns on setup errors.
+ */
+int hsh_server_main(const char *sockpath, int (*run)(int argc, char **argv));
+
+#endif
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+#define HSH_SNAP_MAGIC "HSHSNAP3"
+
+/* identity of a source text file; size == -1 means "did not exist" */
+struct hsh_snap_src {
+    int64_t ino;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+};
+
+struct hsh_snap_slot {
+    uint32_t hash;
+    uint32_t name_off;   /* 0 = empty slot */
+    uint32_t value_off;
+    uint32_t pad;
+};
+
+struct hsh_snapshot {
+    char     magic[8];
+    uint64_t total_size;
+    struct hsh_snap_src conf;
+    struct hsh_snap_src alias;
+    int32_t  cfg[6];     /* fg, bg, sb_enabled, sb_time, sb_cpu, sb_ram */
+    uint32_t nslots;     /* power of two */
+    uint32_t pool_size;
+    int64_t  pipe_size;
+    int32_t  pipefail;
+    uint32_t pad;
+    /* followed by nslots struct hsh_snap_slot, then the string pool */
+};
+
+static uint32_t hsh_snap_hash(const char *s) {
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void hsh_snap_src_stat(const char *path, struct hsh_snap_src *src) {
+    struct stat st;
+    memset(src, 0, sizeof(*src));
+    if (stat(path, &st) != 0) {
+        src->size = -1;
+        return;
+    }
+    src->ino = (int64_t)st.st_ino;
+    src->size = (int64_t)st.st_size;
+    src->mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    src->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+}
+
+static const struct hsh_snap_slot *hsh_snap_slots(const struct hsh_snapshot *s) {
+    return (const struct hsh_snap_slot *)(s + 1);
+}
+
+static const char *hsh_snap_pool(const struct hsh_snapshot *s) {
+    return (const char *)(hsh_snap_slots(s) + s->nslots);
+}
+
+const struct hsh_snapshot *hsh_snapshot_open(const char *snappath,
+                                             const char *confpath,
+                                             const char *aliaspath) {
+    int fd = open(snappath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(struct hsh_snapshot)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const struct hsh_snapshot *s = map;
+    struct hsh_snap_src conf, alias;
+    hsh_snap_src_stat(confpath, &conf);
+    hsh_snap_src_stat(aliaspath, &alias);
+
+    uint64_t need = sizeof(*s) +
+                    (uint64_t)s->nslots * sizeof(struct hsh_snap_slot) +
+                    s->pool_size;
+
+    if (memcmp(s->magic, HSH_SNAP_MAGIC, sizeof(s->magic)) != 0 ||
+        s->total_size != (uint64_t)st.st_size ||
+        need != s->total_size ||
+        s->nslots == 0 || (s->nslots & (s->nslots - 1)) != 0 ||
+        s->pool_size == 0 || hsh_snap_pool(s)[s->pool_size - 1] != '\0' ||
+        memcmp(&s->conf, &conf, sizeof(conf)) != 0 ||
+        memcmp(&s->alias, &alias, sizeof(alias)) != 0) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    return s;
+}
+
+void hsh_snapshot_close(const struct hsh_snapshot *snap) {
+    if (snap)
+        munmap((void *)snap, (size_t)snap->total_size);
+}
+
+void hsh_snapshot_config(const struct hsh_snapshot *snap,
+                         struct hsh_config *cfg) {
+    cfg->fg = snap->cfg[0];
+    cfg->bg = snap->cfg[1];
+    cfg->sb_enabled = snap->cfg[2];
+    cfg->sb_time = snap->cfg[3];
+    cfg->sb_cpu = snap->cfg[4];
+    cfg->sb_ram = snap->cfg[5];
+    cfg->pipe_size = (long)snap->pipe_size;
+    cfg->pipefail = snap->pipefail;
+}
+
+const char *hsh_snapshot_alias(const struct hsh_snapshot *snap,
+                               const char *name) {
+    const struct hsh_snap_slot *slots = hsh_snap_slots(snap);
+    const char *pool = hsh_snap_pool(snap);
+    uint32_t mask = snap->nslots - 1;
+    uint32_t h = hsh_snap_hash(name);
+
+    for (uint32_t i = h & mask, n = 0; n < snap->nslots; i = (i + 1) & mask, n++) {
+        const struct hsh_snap_slot *sl = &slots[i];
+        if (sl->name_off == 0)
+            return NULL;
+        if (sl->name_off >= snap->pool_size || sl->value_off >= snap->pool_size)
+            return NULL;
+        if (sl->hash == h && strcmp(pool + sl->name_off, name) == 0)
+            return pool + sl->value_off;
+    }
+    return NULL;
+}
+
+int hsh_snapshot_write(const char *snappath,
+                       const char *confpath, const char *aliaspath,
+                       const struct hsh_config *cfg,
+                       const struct hsh_alias *aliases, int count) {
+    uint32_t nslots = 8;
+    while (nslots < (uint32_t)count * 2)
+        nslots <<= 1;
+
+    /* pool starts with one NUL so offset 0 can mean "empty" */
+    size_t pool_size = 1;
+    for (int i = 0; i < count; i++)
+        pool_size += strlen(aliases[i].name) + strlen(aliases[i].value) + 2;
+
+    size_t total = sizeof(struct hsh_snapshot) +
+                   nslots * sizeof(struct hsh_snap_slot) + pool_size;
+    if (pool_size > UINT32_MAX)
+        return -1;
+
+    unsigned char *buf = calloc(1, total);
+    if (!buf) {
+        perror("hsh: calloc snapshot");
+        return -1;
+    }
+
+    struct hsh_snapshot *s = (struct hsh_snapshot *)buf;
+    struct hsh_snap_slot *slots = (struct hsh_snap_slot *)(s + 1);
+    char *pool = (char *)(slots + nslots);
+    uint32_t mask = nslots - 1;
+    uint32_t off = 1;
+
+    memcpy(s->magic, HSH_SNAP_MAGIC, sizeof(s->magic));
+    s->total_size = total;
+    hsh_snap_src_stat(confpath, &s->conf);
+    hsh_snap_src_stat(aliaspath, &s->alias);
+    s->cfg[0] = cfg->fg;
+    s->cfg[1] = cfg->bg;
+    s->cfg[2] = cfg->sb_enabled;
+    s->cfg[3] = cfg->sb_time;
+    s->cfg[4] = cfg->sb_cpu;
+    s->cfg[5] = cfg->sb_ram;
+    s->pipe_size = cfg->pipe_size;
+    s->pipefail = cfg->pipefail;
+    s->nslots = nslots;
+    s->pool_size = (uint32_t)pool_size;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t h = hsh_snap_hash(aliases[i].name);
+        uint32_t j = h & mask;
+        int dup = 0;
+
+        while (slots[j].name_off != 0) {
+            /* first definition wins, like the linear text lookup */
+            if (slots[j].hash == h &&
+                strcmp(pool + slots[j].name_off, aliases[i].name) == 0) {
+                dup = 1;
+                break;
+            }
+            j = (j + 1) & mask;
+        }
+        if (dup)
+            continue;
+
+        size_t nlen = strlen(aliases[i].name) + 1;
+        size_t vlen = strlen(aliases[i].value) + 1;
+        slots[j].hash = h;
+        slots[j].name_off = off;
+        memcpy(pool + off, aliases[i].name, nlen);
+        off += (uint32_t)nlen;
+        slots[j].value_off = off;
+        memcpy(pool + off, aliases[i].value, vlen);
+        off += (uint32_t)vlen;
+    }
+
+    char tmppath[600];
+    snprintf(tmppath, sizeof(tmppath), "%s.%ld", snappath, (long)getpid());
+
+    int fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        free(buf);
+        return -1;
+    }
+
+    size_t done = 0;
+    while (done < total) {
+        ssize_t w = write(fd, buf + done, total - done);
+        if (w <= 0)
+            break;
+        done += (size_t)w;
+    }
+    free(buf);
+
+    if (close(fd) != 0 || done != total || rename(tmppath, snappath) != 0) {
+        unlink(tmppath);
+        return -1;
+    }
+    return 0;
+}
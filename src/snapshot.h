@@ -0,0 +1,35 @@
+#ifndef HSH_SNAPSHOT_H
+#define HSH_SNAPSHOT_H
+
+#include "extras.h"
+
+/* Binary snapshot of config + aliases (~/.config/hsh/snapshot).
+ *
+ * Layout: header, open-addressing hash table of aliases, string pool.
+ * The header records mtime/size/inode of the text files it was built
+ * from; a snapshot that doesn't match them is ignored and rebuilt.
+ * Opening maps the file read-only: no parsing, no allocations.
+ */
+struct hsh_snapshot;
+
+/* Map snappath if it is still current for confpath/aliaspath.
+ * Returns NULL if missing, stale or malformed.
+ */
+const struct hsh_snapshot *hsh_snapshot_open(const char *snappath,
+                                             const char *confpath,
+                                             const char *aliaspath);
+void hsh_snapshot_close(const struct hsh_snapshot *snap);
+
+/* Write a new snapshot (atomically, via rename). 0 on success. */
+int hsh_snapshot_write(const char *snappath,
+                       const char *confpath, const char *aliaspath,
+                       const struct hsh_config *cfg,
+                       const struct hsh_alias *aliases, int count);
+
+void        hsh_snapshot_config(const struct hsh_snapshot *snap,
+                                struct hsh_config *cfg);
+/* Returns the alias value inside the mapping, or NULL. */
+const char *hsh_snapshot_alias(const struct hsh_snapshot *snap,
+                               const char *name);
+
+#endif
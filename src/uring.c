@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+struct hsh_uring {
+    int                  fd;
+    unsigned             queued;     /* SQEs handed out since the last run */
+
+    void                *sq_ring, *cq_ring;
+    size_t               sq_len, cq_len;
+    struct io_uring_sqe *sqes;
+    size_t               sqes_len;
+
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned             sq_entries;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+struct hsh_uring *hsh_uring_open(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    int fd = (int)syscall(SYS_io_uring_setup, entries, &p);
+    if (fd < 0)
+        return NULL;
+
+    struct hsh_uring *r = calloc(1, sizeof(*r));
+    if (!r) {
+        close(fd);
+        return NULL;
+    }
+    r->fd = fd;
+    r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_len > r->sq_len)
+            r->sq_len = r->cq_len;
+        r->cq_len = r->sq_len;
+    }
+
+    r->sq_ring = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED)
+        goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED)
+            goto fail;
+    }
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+        goto fail;
+
+    char *sq = r->sq_ring, *cq = r->cq_ring;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->sq_entries = p.sq_entries;
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return r;
+
+fail:
+    hsh_uring_close(r);
+    return NULL;
+}
+
+void hsh_uring_close(struct hsh_uring *r) {
+    if (!r)
+        return;
+    if (r->sqes && r->sqes != MAP_FAILED)
+        munmap(r->sqes, r->sqes_len);
+    if (r->cq_ring && r->cq_ring != MAP_FAILED && r->cq_ring != r->sq_ring)
+        munmap(r->cq_ring, r->cq_len);
+    if (r->sq_ring && r->sq_ring != MAP_FAILED)
+        munmap(r->sq_ring, r->sq_len);
+    close(r->fd);
+    free(r);
+}
+
+struct io_uring_sqe *hsh_uring_sqe(struct hsh_uring *r) {
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *r->sq_tail + r->queued;
+    if (tail - head >= r->sq_entries)
+        return NULL;
+
+    unsigned idx = tail & *r->sq_mask;
+    r->sq_array[idx] = idx;
+    r->queued++;
+    memset(&r->sqes[idx], 0, sizeof(r->sqes[idx]));
+    return &r->sqes[idx];
+}
+
+int hsh_uring_run(struct hsh_uring *r, unsigned n, int *res) {
+    unsigned submit = r->queued;
+    __atomic_store_n(r->sq_tail, *r->sq_tail + r->queued, __ATOMIC_RELEASE);
+    r->queued = 0;
+
+    unsigned got = 0;
+    for (;;) {
+        /* take what has completed, then sleep for the rest */
+        unsigned head = *r->cq_head;
+        unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail && got < n; head++, got++) {
+            struct io_uring_cqe *c = &r->cqes[head & *r->cq_mask];
+            res[c->user_data] = c->res;
+        }
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+        if (got >= n && submit == 0)
+            break;
+
+        int ret = (int)syscall(SYS_io_uring_enter, r->fd, submit,
+                               got < n ? n - got : 0,
+                               got < n ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        submit -= (unsigned)ret;
+    }
+    return 0;
+}
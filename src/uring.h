@@ -0,0 +1,26 @@
+#ifndef HSH_URING_H
+#define HSH_URING_H
+
+#include <linux/io_uring.h>
+
+/* A bare io_uring(7) instance on the raw syscalls (no liburing): queue a
+ * batch of requests, submit them with one io_uring_enter(2) and wait for
+ * all of them. Used by hsh_copy_batch() to copy many small files in a
+ * handful of syscalls. A ring belongs to one thread at a time.
+ */
+
+struct hsh_uring;
+
+/* NULL if io_uring is unavailable (old kernel, seccomp, sysctl) */
+struct hsh_uring *hsh_uring_open(unsigned entries);
+void hsh_uring_close(struct hsh_uring *r);
+
+/* next free submission entry, zeroed, or NULL when the queue is full */
+struct io_uring_sqe *hsh_uring_sqe(struct hsh_uring *r);
+
+/* Submit everything queued and wait for n completions. Each result goes
+ * to res[user_data]. Returns 0, or -1 with errno set.
+ */
+int hsh_uring_run(struct hsh_uring *r, unsigned n, int *res);
+
+#endif
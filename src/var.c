@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "var.h"
+
+extern char **environ;
+
+struct hsh_var {
+    char           *entry;      /* "NAME=VALUE" */
+    size_t          namelen;
+    uint32_t        hash;
+    int             slot;       /* index in hsh_env, -1 if not exported */
+    struct hsh_var *next;       /* bucket chain */
+};
+
+static pthread_mutex_t  hsh_var_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct hsh_var **hsh_vars;         /* power-of-two buckets */
+static size_t           hsh_var_buckets, hsh_var_count;
+
+/* what environ points at once the store is up */
+static char           **hsh_env;
+static struct hsh_var **hsh_env_var;      /* owner of each slot */
+static size_t           hsh_envc, hsh_env_cap;
+
+static int hsh_var_status = 0;
+
+static int hsh_var_char(char c, int first) {
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (!first && c >= '0' && c <= '9');
+}
+
+int hsh_var_valid(const char *name, size_t len) {
+    if (len == 0)
+        return 0;
+    for (size_t i = 0; i < len; i++)
+        if (!hsh_var_char(name[i], i == 0))
+            return 0;
+    return 1;
+}
+
+/* FNV-1a */
+static uint32_t hsh_var_hash(const char *name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+static struct hsh_var **hsh_var_find(const char *name, size_t len, uint32_t h) {
+    struct hsh_var **pp = &hsh_vars[h & (hsh_var_buckets - 1)];
+    for (; *pp; pp = &(*pp)->next) {
+        struct hsh_var *v = *pp;
+        if (v->hash == h && v->namelen == len && memcmp(v->entry, name, len) == 0)
+            break;
+    }
+    return pp;
+}
+
+static int hsh_var_grow(void) {
+    size_t n = hsh_var_buckets ? hsh_var_buckets * 2 : 64;
+    struct hsh_var **b = calloc(n, sizeof(*b));
+    if (!b)
+        return -1;
+    for (size_t i = 0; i < hsh_var_buckets; i++) {
+        struct hsh_var *v = hsh_vars[i], *next;
+        for (; v; v = next) {
+            next = v->next;
+            v->next = b[v->hash & (n - 1)];
+            b[v->hash & (n - 1)] = v;
+        }
+    }
+    free(hsh_vars);
+    hsh_vars = b;
+    hsh_var_buckets = n;
+    return 0;
+}
+
+/* room for one more environ slot and its NULL */
+static int hsh_env_reserve(void) {
+    if (hsh_envc + 1 < hsh_env_cap)
+        return 0;
+    size_t cap = hsh_env_cap ? hsh_env_cap * 2 : 64;
+    char **e = malloc(cap * sizeof(*e));
+    struct hsh_var **o = realloc(hsh_env_var, cap * sizeof(*o));
+    if (o)
+        hsh_env_var = o;
+    if (!e || !o) {
+        free(e);
+        return -1;
+    }
+    if (hsh_envc)
+        memcpy(e, hsh_env, hsh_envc * sizeof(*e));
+    e[hsh_envc] = NULL;
+
+    /* a new array, published whole: environ is never half-copied */
+    char **old = hsh_env;
+    hsh_env = e;
+    hsh_env_cap = cap;
+    environ = hsh_env;
+    free(old);
+    return 0;
+}
+
+static int hsh_env_add(struct hsh_var *v) {
+    if (hsh_env_reserve() < 0)
+        return -1;
+    v->slot = (int)hsh_envc;
+    hsh_env_var[hsh_envc] = v;
+    hsh_env[hsh_envc + 1] = NULL;
+    hsh_env[hsh_envc++] = v->entry;
+    return 0;
+}
+
+/* drop v's slot: the last one moves into it */
+static void hsh_env_del(struct hsh_var *v) {
+    size_t last = --hsh_envc;
+    if ((size_t)v->slot != last) {
+        hsh_env[v->slot] = hsh_env[last];
+        hsh_env_var[v->slot] = hsh_env_var[last];
+        hsh_env_var[v->slot]->slot = v->slot;
+    }
+    hsh_env[last] = NULL;
+    v->slot = -1;
+}
+
+/* entry (owned from now on) as NAME's new value */
+static int hsh_var_put(char *entry, size_t namelen, int export) {
+    uint32_t h = hsh_var_hash(entry, namelen);
+    struct hsh_var **pp = hsh_var_find(entry, namelen, h);
+    struct hsh_var *v = *pp;
+
+    if (v) {
+        free(v->entry);
+        v->entry = entry;
+        if (v->slot >= 0)
+            hsh_env[v->slot] = entry;
+        else if (export && hsh_env_add(v) < 0)
+            return -1;
+        return 0;
+    }
+
+    if (hsh_var_count + 1 > hsh_var_buckets / 4 * 3) {
+        if (hsh_var_grow() < 0) {
+            free(entry);
+            return -1;
+        }
+        pp = hsh_var_find(entry, namelen, h);
+    }
+    v = calloc(1, sizeof(*v));
+    if (!v) {
+        free(entry);
+        return -1;
+    }
+    v->entry = entry;
+    v->namelen = namelen;
+    v->hash = h;
+    v->slot = -1;
+    *pp = v;
+    hsh_var_count++;
+    return export ? hsh_env_add(v) : 0;
+}
+
+/* take over environ on first use (under the lock) */
+static int hsh_var_init(void) {
+    static int done = 0;
+    if (done)
+        return 0;
+    if (hsh_var_grow() < 0)
+        return -1;
+    for (char **e = environ; e && *e; e++) {
+        const char *eq = strchr(*e, '=');
+        if (!eq || eq == *e)
+            continue;
+        char *entry = strdup(*e);
+        if (!entry || hsh_var_put(entry, (size_t)(eq - *e), 1) < 0)
+            return -1;
+    }
+    if (hsh_env_reserve() < 0)
+        return -1;
+    environ = hsh_env;
+    done = 1;
+    return 0;
+}
+
+int hsh_var_set(const char *name, const char *value, int export) {
+    size_t len = strlen(name), vlen = strlen(value);
+    if (!hsh_var_valid(name, len)) {
+        fprintf(stderr, "hsh: '%s': not a valid name\n", name);
+        return -1;
+    }
+    char *entry = malloc(len + vlen + 2);
+    if (!entry) {
+        perror("hsh: variable");
+        return -1;
+    }
+    memcpy(entry, name, len);
+    entry[len] = '=';
+    memcpy(entry + len + 1, value, vlen + 1);
+
+    pthread_mutex_lock(&hsh_var_lock);
+    int rc = hsh_var_init();
+    if (rc == 0)
+        rc = hsh_var_put(entry, len, export);
+    else
+        free(entry);
+    pthread_mutex_unlock(&hsh_var_lock);
+    if (rc < 0)
+        perror("hsh: variable");
+    return rc;
+}
+
+int hsh_var_export(const char *name) {
+    size_t len = strlen(name);
+    if (!hsh_var_valid(name, len)) {
+        fprintf(stderr, "hsh: '%s': not a valid name\n", name);
+        return -1;
+    }
+    int rc = 0;
+    pthread_mutex_lock(&hsh_var_lock);
+    if (hsh_var_init() < 0) {
+        rc = -1;
+    } else {
+        struct hsh_var *v = *hsh_var_find(name, len, hsh_var_hash(name, len));
+        if (v && v->slot < 0)
+            rc = hsh_env_add(v);
+    }
+    pthread_mutex_unlock(&hsh_var_lock);
+    if (rc < 0)
+        perror("hsh: export");
+    return rc;
+}
+
+void hsh_var_unset(const char *name) {
+    size_t len = strlen(name);
+    pthread_mutex_lock(&hsh_var_lock);
+    if (hsh_var_init() == 0) {
+        struct hsh_var **pp = hsh_var_find(name, len, hsh_var_hash(name, len));
+        struct hsh_var *v = *pp;
+        if (v) {
+            if (v->slot >= 0)
+                hsh_env_del(v);
+            *pp = v->next;
+            hsh_var_count--;
+            free(v->entry);
+            free(v);
+        }
+    }
+    pthread_mutex_unlock(&hsh_var_lock);
+}
+
+static int hsh_var_cmp(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+void hsh_var_list(int exported) {
+    pthread_mutex_lock(&hsh_var_lock);
+    char **all = NULL;
+    size_t n = 0;
+    if (hsh_var_init() == 0 && (all = malloc((hsh_var_count + 1) * sizeof(*all)))) {
+        for (size_t i = 0; i < hsh_var_buckets; i++)
+            for (struct hsh_var *v = hsh_vars[i]; v; v = v->next)
+                if (!exported || v->slot >= 0)
+                    all[n++] = v->entry;
+        qsort(all, n, sizeof(*all), hsh_var_cmp);
+        for (size_t i = 0; i < n; i++)
+            printf("%s\n", all[i]);
+    }
+    pthread_mutex_unlock(&hsh_var_lock);
+    free(all);
+}
+
+void hsh_var_set_status(int status) {
+    __atomic_store_n(&hsh_var_status, status, __ATOMIC_RELAXED);
+}
+
+/* append s[0..n) to the growing buffer *buf */
+static int hsh_var_cat(char **buf, size_t *len, size_t *cap,
+                       const char *s, size_t n) {
+    if (*len + n + 1 > *cap) {
+        size_t c = (*len + n + 1) * 2;
+        char *p = realloc(*buf, c);
+        if (!p)
+            return -1;
+        *buf = p;
+        *cap = c;
+    }
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+    return 0;
+}
+
+char *hsh_var_expand(const char *word) {
+    const char *d = strchr(word, '$');
+    if (!d)
+        return NULL;
+
+    char *buf = NULL;
+    size_t len = 0, cap = 0;
+    int ok = hsh_var_cat(&buf, &len, &cap, word, (size_t)(d - word)) == 0;
+
+    pthread_mutex_lock(&hsh_var_lock);
+    ok = ok && hsh_var_init() == 0;
+    for (const char *p = d; ok && *p; ) {
+        if (*p != '$') {
+            const char *q = strchr(p, '$');
+            size_t n = q ? (size_t)(q - p) : strlen(p);
+            ok = hsh_var_cat(&buf, &len, &cap, p, n) == 0;
+            p += n;
+            continue;
+        }
+
+        const char *name = p + 1, *end;
+        if (*name == '?') {
+            char num[16];
+            int n = snprintf(num, sizeof(num), "%d",
+                             __atomic_load_n(&hsh_var_status, __ATOMIC_RELAXED));
+            ok = hsh_var_cat(&buf, &len, &cap, num, (size_t)n) == 0;
+            p = name + 1;
+            continue;
+        }
+        if (*name == '{') {
+            name++;
+            end = strchr(name, '}');
+            if (!end || !hsh_var_valid(name, (size_t)(end - name))) {
+                /* not a reference: keep the '$' */
+                ok = hsh_var_cat(&buf, &len, &cap, p, 1) == 0;
+                p++;
+                continue;
+            }
+            p = end + 1;
+        } else {
+            end = name;
+            while (*end && hsh_var_char(*end, end == name))
+                end++;
+            if (end == name) {
+                ok = hsh_var_cat(&buf, &len, &cap, p, 1) == 0;
+                p++;
+                continue;
+            }
+            p = end;
+        }
+
+        size_t n = (size_t)(end - name);
+        struct hsh_var *v = *hsh_var_find(name, n, hsh_var_hash(name, n));
+        if (v)
+            ok = hsh_var_cat(&buf, &len, &cap, v->entry + n + 1,
+                             strlen(v->entry + n + 1)) == 0;
+    }
+    pthread_mutex_unlock(&hsh_var_lock);
+
+    if (ok && !buf)
+        buf = strdup("");
+    if (!ok || !buf) {
+        perror("hsh: variable expansion");
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
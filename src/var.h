@@ -0,0 +1,35 @@
+#ifndef HSH_VAR_H
+#define HSH_VAR_H
+
+/* Shell variables: one hashed store for shell-only and exported names.
+ *
+ * The store owns environ. Exported variables keep their "NAME=VALUE"
+ * string at a fixed slot of that array, so set, export and unset patch
+ * one slot (unset moves the last slot into the hole) and a fork/exec
+ * hands children the live array as is, with no rebuild per spawn. It is
+ * filled from the inherited environment on first use. Callers may come
+ * from several hsh-lang threads; the store is locked inside.
+ */
+
+/* Set NAME to value; exported if export is set or it already was.
+ * -1 on an invalid name or out of memory. */
+int hsh_var_set(const char *name, const char *value, int export);
+
+/* mark NAME exported (a no-op if it is not set) */
+int hsh_var_export(const char *name);
+void hsh_var_unset(const char *name);
+
+/* print NAME=VALUE lines, sorted; only the exported ones with exported */
+void hsh_var_list(int exported);
+
+/* status of the last command, for $? */
+void hsh_var_set_status(int status);
+
+/* word with $NAME, ${NAME} and $? replaced (unset names give ""), in a
+ * malloc'd string; NULL when word has no '$' or out of memory */
+char *hsh_var_expand(const char *word);
+
+/* 1 if name is a valid variable name: [A-Za-z_][A-Za-z0-9_]* */
+int hsh_var_valid(const char *name, size_t len);
+
+#endif
@@ -0,0 +1,345 @@
+#define _GNU_SOURCE   /* statx */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "walk.h"
+
+#define HSH_WALK_BUF (64 * 1024)
+
+struct hsh_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+struct hsh_walk_job {
+    char *path;
+    int   fd;       /* already open (the root), else -1 */
+    int   depth;
+    void *data;
+};
+
+/* jobs[head..tail): the owner works at the tail, thieves at the head */
+struct hsh_walk_deque {
+    pthread_mutex_t      lock;
+    struct hsh_walk_job *jobs;
+    size_t               head, tail, cap;
+};
+
+struct hsh_walk {
+    const struct hsh_walk_ops *ops;
+    const char                *prefix;
+    int                        nthreads;
+    struct hsh_walk_deque     *q;
+    long                       pending;  /* queued or being read, atomic */
+    int                        stop;     /* atomic */
+    int                        errors;   /* atomic */
+    int                        idle;     /* under idle_lock */
+    pthread_mutex_t            idle_lock;
+    pthread_cond_t             idle_cond;
+};
+
+struct hsh_walk_worker {
+    struct hsh_walk *w;
+    int              id;
+    char            *buf;      /* getdents64 buffer */
+    char            *path;     /* child path being built */
+    size_t           pathcap;
+};
+
+int hsh_walk_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    n *= 2;
+    return n > HSH_WALK_MAX_THREADS ? HSH_WALK_MAX_THREADS : (int)n;
+}
+
+static int hsh_walk_push(struct hsh_walk *w, int self, struct hsh_walk_job job) {
+    struct hsh_walk_deque *q = &w->q[self];
+
+    /* counted before a thief can see it, so pending can't reach 0 while
+     * the job is still queued */
+    __atomic_add_fetch(&w->pending, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&q->lock);
+    if (q->tail == q->cap) {
+        if (q->head > 0) {
+            memmove(q->jobs, q->jobs + q->head,
+                    (q->tail - q->head) * sizeof(*q->jobs));
+            q->tail -= q->head;
+            q->head = 0;
+        } else {
+            size_t cap = q->cap ? q->cap * 2 : 64;
+            struct hsh_walk_job *jobs = realloc(q->jobs, cap * sizeof(*jobs));
+            if (!jobs) {
+                pthread_mutex_unlock(&q->lock);
+                __atomic_sub_fetch(&w->pending, 1, __ATOMIC_RELAXED);
+                return -1;
+            }
+            q->jobs = jobs;
+            q->cap = cap;
+        }
+    }
+    q->jobs[q->tail++] = job;
+    pthread_mutex_unlock(&q->lock);
+
+    if (__atomic_load_n(&w->idle, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&w->idle_lock);
+        pthread_cond_signal(&w->idle_cond);
+        pthread_mutex_unlock(&w->idle_lock);
+    }
+    return 0;
+}
+
+static int hsh_walk_take(struct hsh_walk *w, int self, struct hsh_walk_job *job) {
+    /* own deque, newest first */
+    struct hsh_walk_deque *q = &w->q[self];
+    pthread_mutex_lock(&q->lock);
+    if (q->tail > q->head) {
+        *job = q->jobs[--q->tail];
+        pthread_mutex_unlock(&q->lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    /* steal the oldest (nearest the root: the most work behind it) */
+    for (int k = 1; k < w->nthreads; k++) {
+        q = &w->q[(self + k) % w->nthreads];
+        pthread_mutex_lock(&q->lock);
+        if (q->tail > q->head) {
+            *job = q->jobs[q->head++];
+            pthread_mutex_unlock(&q->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&q->lock);
+    }
+    return 0;
+}
+
+static void hsh_walk_error(struct hsh_walk *w, const char *path, int err) {
+    fprintf(stderr, "%s: %s: %s\n", w->prefix, path, strerror(err));
+    __atomic_add_fetch(&w->errors, 1, __ATOMIC_RELAXED);
+}
+
+static const char *hsh_walk_child(struct hsh_walk_worker *wk, const char *dir,
+                                  size_t dirlen, const char *name, size_t *len) {
+    size_t namelen = strlen(name);
+    int slash = dirlen > 0 && dir[dirlen - 1] != '/';
+
+    *len = dirlen + slash + namelen;
+    if (*len + 1 > wk->pathcap) {
+        size_t cap = (*len + 1) * 2;
+        char *p = realloc(wk->path, cap);
+        if (!p)
+            return NULL;
+        wk->path = p;
+        wk->pathcap = cap;
+    }
+    memcpy(wk->path, dir, dirlen);
+    if (slash)
+        wk->path[dirlen] = '/';
+    memcpy(wk->path + dirlen + slash, name, namelen + 1);
+    return wk->path;
+}
+
+static void hsh_walk_dir(struct hsh_walk_worker *wk, struct hsh_walk_job *job) {
+    struct hsh_walk *w = wk->w;
+    const struct hsh_walk_ops *ops = w->ops;
+    size_t dirlen = strlen(job->path);
+
+    int fd = job->fd >= 0 ? job->fd
+           : open(job->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        hsh_walk_error(w, job->path, errno);
+        goto leave;
+    }
+
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, wk->buf, HSH_WALK_BUF);
+        if (n < 0) {
+            hsh_walk_error(w, job->path, errno);
+            break;
+        }
+        if (n == 0)
+            break;
+
+        for (long off = 0; off < n; ) {
+            struct hsh_dirent64 *d = (struct hsh_dirent64 *)(wk->buf + off);
+            off += d->d_reclen;
+
+            const char *name = d->d_name;
+            if (name[0] == '.' &&
+                (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            struct hsh_walk_ent e;
+            e.dirfd = fd;
+            e.name = name;
+            e.path = hsh_walk_child(wk, job->path, dirlen, name, &e.pathlen);
+            e.type = d->d_type;
+            e.depth = job->depth + 1;
+            e.dir_data = job->data;
+            e.child_data = NULL;
+            e.worker = wk->id;
+            if (!e.path) {
+                hsh_walk_error(w, job->path, ENOMEM);
+                continue;
+            }
+
+            if (e.type == DT_UNKNOWN) {
+                struct statx stx;
+                if (statx(fd, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE, &stx) == 0)
+                    e.type = IFTODT(stx.stx_mode);
+            }
+
+            int r = ops->visit ? ops->visit(&e, ops->arg) : HSH_WALK_CONTINUE;
+            if (r == HSH_WALK_STOP) {
+                __atomic_store_n(&w->stop, 1, __ATOMIC_RELAXED);
+                close(fd);
+                return;
+            }
+
+            if (e.type == DT_DIR && r != HSH_WALK_SKIP) {
+                struct hsh_walk_job sub = { strdup(e.path), -1, e.depth,
+                                            e.child_data };
+                if (!sub.path || hsh_walk_push(w, wk->id, sub) < 0) {
+                    free(sub.path);
+                    hsh_walk_error(w, e.path, ENOMEM);
+                    if (ops->leave)
+                        ops->leave(e.path, e.child_data, ops->arg);
+                }
+            }
+        }
+    }
+    close(fd);
+
+leave:
+    if (ops->leave)
+        ops->leave(job->path, job->data, ops->arg);
+}
+
+static void *hsh_walk_worker_run(void *arg) {
+    struct hsh_walk_worker *wk = arg;
+    struct hsh_walk *w = wk->w;
+    struct hsh_walk_job job;
+
+    while (!__atomic_load_n(&w->stop, __ATOMIC_RELAXED)) {
+        if (hsh_walk_take(w, wk->id, &job)) {
+            hsh_walk_dir(wk, &job);
+            free(job.path);
+            if (__atomic_sub_fetch(&w->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+                pthread_mutex_lock(&w->idle_lock);
+                pthread_cond_broadcast(&w->idle_cond);
+                pthread_mutex_unlock(&w->idle_lock);
+            }
+            continue;
+        }
+
+        /* nothing to take: done, or wait for someone to push */
+        pthread_mutex_lock(&w->idle_lock);
+        if (__atomic_load_n(&w->pending, __ATOMIC_ACQUIRE) == 0) {
+            pthread_mutex_unlock(&w->idle_lock);
+            break;
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 1000000;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        __atomic_add_fetch(&w->idle, 1, __ATOMIC_RELAXED);
+        pthread_cond_timedwait(&w->idle_cond, &w->idle_lock, &ts);
+        __atomic_sub_fetch(&w->idle, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&w->idle_lock);
+    }
+    return NULL;
+}
+
+int hsh_walk(const char *root, void *root_data,
+             const struct hsh_walk_ops *ops, const char *prefix) {
+    int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s: %s\n", prefix, root, strerror(errno));
+        return -1;
+    }
+
+    struct hsh_walk w;
+    memset(&w, 0, sizeof(w));
+    w.ops = ops;
+    w.prefix = prefix;
+    w.nthreads = ops->threads > 0 ? ops->threads : hsh_walk_threads();
+    if (w.nthreads > HSH_WALK_MAX_THREADS)
+        w.nthreads = HSH_WALK_MAX_THREADS;
+    pthread_mutex_init(&w.idle_lock, NULL);
+    pthread_cond_init(&w.idle_cond, NULL);
+
+    w.q = calloc((size_t)w.nthreads, sizeof(*w.q));
+    struct hsh_walk_worker *wk = calloc((size_t)w.nthreads, sizeof(*wk));
+    struct hsh_walk_job first = { strdup(root), fd, 0, root_data };
+    if (!w.q || !wk || !first.path) {
+        perror(prefix);
+        close(fd);
+        free(first.path);
+        free(w.q);
+        free(wk);
+        return -1;
+    }
+    for (int i = 0; i < w.nthreads; i++) {
+        pthread_mutex_init(&w.q[i].lock, NULL);
+        wk[i].w = &w;
+        wk[i].id = i;
+    }
+    hsh_walk_push(&w, 0, first);
+
+    /* the caller is worker 0 */
+    pthread_t tids[HSH_WALK_MAX_THREADS];
+    int started = 1;
+    for (int i = 0; i < w.nthreads; i++) {
+        wk[i].buf = malloc(HSH_WALK_BUF);
+        if (!wk[i].buf)
+            break;
+        if (i > 0) {
+            if (pthread_create(&tids[i], NULL, hsh_walk_worker_run, &wk[i]) != 0)
+                break;
+            started++;
+        }
+    }
+    if (wk[0].buf)
+        hsh_walk_worker_run(&wk[0]);
+    else
+        hsh_walk_error(&w, root, ENOMEM);
+    for (int i = 1; i < started; i++)
+        pthread_join(tids[i], NULL);
+
+    /* after HSH_WALK_STOP: directories never read */
+    for (int i = 0; i < w.nthreads; i++) {
+        struct hsh_walk_deque *q = &w.q[i];
+        for (size_t j = q->head; j < q->tail; j++) {
+            if (q->jobs[j].fd >= 0)
+                close(q->jobs[j].fd);
+            free(q->jobs[j].path);
+        }
+        free(q->jobs);
+        pthread_mutex_destroy(&q->lock);
+        free(wk[i].buf);
+        free(wk[i].path);
+    }
+    free(w.q);
+    free(wk);
+    pthread_mutex_destroy(&w.idle_lock);
+    pthread_cond_destroy(&w.idle_cond);
+    return w.errors;
+}
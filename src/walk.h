@@ -0,0 +1,55 @@
+#ifndef HSH_WALK_H
+#define HSH_WALK_H
+
+#include <stddef.h>
+
+/* Parallel directory walk for the fs natives (du, find, ...).
+ *
+ * Directories are read with getdents64(2) by a pool of threads. Each
+ * thread keeps its own deque of directories still to read: it takes the
+ * newest from its own (depth first, warm dentries) and, when that runs
+ * dry, steals the oldest from another thread's. Symlinks are never
+ * followed.
+ */
+
+#define HSH_WALK_MAX_THREADS 64
+
+/* visit() results */
+#define HSH_WALK_CONTINUE 0
+#define HSH_WALK_SKIP     1   /* don't descend into this directory */
+#define HSH_WALK_STOP     2   /* end the walk */
+
+struct hsh_walk_ent {
+    int           dirfd;       /* open parent directory, for *at() calls */
+    const char   *name;
+    const char   *path;        /* root-relative path, as given + "/name" */
+    size_t        pathlen;
+    unsigned char type;        /* DT_*; DT_UNKNOWN is resolved with statx */
+    int           depth;       /* 1 for the root's entries */
+    void         *dir_data;    /* the parent directory's data */
+    void         *child_data;  /* a DT_DIR's visit sets its dir_data here */
+    int           worker;      /* 0 .. threads - 1 */
+};
+
+struct hsh_walk_ops {
+    /* every entry below the root, from any thread */
+    int  (*visit)(struct hsh_walk_ent *e, void *arg);
+    /* a directory's entries have all been visited (its subdirectories
+     * may still be queued); also for the root */
+    void (*leave)(const char *path, void *dir_data, void *arg);
+    void  *arg;
+    int    threads;            /* 0 = hsh_walk_threads() */
+};
+
+/* default pool size: twice the online CPUs (directory reads block on
+ * I/O), at most HSH_WALK_MAX_THREADS */
+int hsh_walk_threads(void);
+
+/* Walk everything below root. Unreadable directories are reported on
+ * stderr as "prefix: path: error" and skipped.
+ * Returns the number of such errors, or -1 if root can't be opened.
+ */
+int hsh_walk(const char *root, void *root_data,
+             const struct hsh_walk_ops *ops, const char *prefix);
+
+#endif